@@ -0,0 +1,39 @@
+#version 450
+
+// vertex shader for VertexEncoding::QuantizedHalf and QuantizedSnorm16 meshes
+// positions are dequantized by the model matrix, normals are octahedral encoded
+
+// updated once per frame 
+layout(set = 0, binding = 0) uniform FrameConstants {
+    mat4 view;
+    mat4 proj;
+};
+
+// updated once per drawcall
+layout(set = 3, binding = 0) uniform Drawcall {
+    mat4 model;
+};
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec2 inNormal;
+layout(location = 2) in vec3 inColor;
+layout(location = 3) in vec2 inTexCoord;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexCoord;
+
+vec3 octahedralDecode(vec2 e)
+{
+    vec3 v = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-v.z, 0.0);
+    v.xy += mix(vec2(t), vec2(-t), greaterThanEqual(v.xy, vec2(0.0)));
+    return normalize(v);
+}
+
+void main() 
+{
+    const mat4 mvp = proj * view * model;
+    gl_Position = mvp * vec4(inPosition, 1.0);
+    fragColor = (mvp * vec4(octahedralDecode(inNormal), 1.0)).xyz;
+    fragTexCoord = inTexCoord;
+}
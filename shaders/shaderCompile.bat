@@ -1,2 +1,3 @@
 glslc.exe base.frag -o frag.spv
-glslc.exe base.vert -o vert.spv
\ No newline at end of file
+glslc.exe base.vert -o vert.spv
+glslc.exe baseQuantized.vert -o vertQuantized.spv
\ No newline at end of file
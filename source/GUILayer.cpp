@@ -192,9 +192,12 @@ void GUILayer::render(vk::CommandBuffer commandBuffer, uint index, vk::Extent2D
 
 void GUILayer::handleSwapchainRecreation(VulkanContext& vkContext)
 {
+	// the frames in flight may still use the old ones
+	vkContext.deviceContext.deletionQueue.push(std::move(renderPass));
 	renderPass = createDefaultRenderPassMSAAImgui(vkContext.deviceContext, vkContext.swapchain.format, vkContext.msaaSamples);
 
-	destroyFrameBuffers();
+	vkContext.deviceContext.deletionQueue.push(std::move(framebuffers));
+	framebuffers.clear();
 	createFramebuffers(vkContext);
 }
 
@@ -21,17 +21,6 @@ void Material::create(vkh::DeviceContext& deviceContext, vkh::GraphicsPipeline&
 			}
 		}
 	}
-	
-	vma::AllocationCreateInfo allocInfo;
-	allocInfo.usage = vma::MemoryUsage::eCpuToGpu;
-	
-	vk::BufferCreateInfo bufferCreateInfo;
-	bufferCreateInfo.usage = vk::BufferUsageFlagBits::eUniformBuffer;
-	// @Review alignement
-	bufferCreateInfo.size = getUniformBufferSize();
-	bufferCreateInfo.sharingMode = vk::SharingMode::eExclusive;
-	uniformBuffer.create(deviceContext, bufferCreateInfo, allocInfo);
-
 }
 
 size_t Material::getUniformBufferSize() const noexcept
@@ -120,43 +109,33 @@ void Material::updateMember(void* bufferData, size_t& offset, vkh::ShaderReflect
 }
 
 //@Improve 
-void Material::updateBuffer()
+void Material::updateBuffer(vkh::FrameRingBuffer& frameRingBuffer)
 {
-	void* bufferData = uniformBuffer.map();
+	auto const block = frameRingBuffer.allocate(getUniformBufferSize());
 	size_t offset = 0;
 	for (auto const& p : parameters)
 	{
-		updateMember(bufferData, offset, p);
+		updateMember(block.data, offset, p);
 	}
-	uniformBuffer.unmap();
+	dynamicOffset = block.offset;
 }
 
-void Material::bind(vk::CommandBuffer cmdBuffer, uint32 index)
+void Material::bind(vk::CommandBuffer cmdBuffer)
 {
-	cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *graphicsPipeline->pipelineLayout, 0, 1, &descriptorSets[index], 0, nullptr);
+	cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *graphicsPipeline->pipelineLayout, vkh::DescriptorSetIndex::Material, 1, &descriptorSet, 1, &dynamicOffset);
 }
 
-void Material::updateDescriptorSets()
+void Material::updateDescriptorSets(vkh::FrameRingBuffer const& frameRingBuffer)
 {
-	vk::DescriptorBufferInfo bufferInfo{};
-	bufferInfo.buffer = uniformBuffer.buffer;
-	bufferInfo.offset = 0;
-	bufferInfo.range = VK_WHOLE_SIZE;
-
-	std::vector<vk::WriteDescriptorSet> descriptorWrites;
-	descriptorWrites.reserve(descriptorSets.size());
-	
-	for (auto const& set : descriptorSets)
-	{
-		vk::WriteDescriptorSet descriptorWrite;
-		descriptorWrite.dstSet = set;
-		descriptorWrite.dstBinding = 0;
-		descriptorWrite.dstArrayElement = 0;
-		descriptorWrite.descriptorType = vk::DescriptorType::eUniformBuffer;
-		descriptorWrite.descriptorCount = 1;
-		descriptorWrite.pBufferInfo = &bufferInfo;
-		descriptorWrites.push_back(descriptorWrite);
-	}
+	vk::DescriptorBufferInfo const bufferInfo = frameRingBuffer.getDescriptorInfo(getUniformBufferSize());
+
+	vk::WriteDescriptorSet descriptorWrite;
+	descriptorWrite.dstSet = descriptorSet;
+	descriptorWrite.dstBinding = 0;
+	descriptorWrite.dstArrayElement = 0;
+	descriptorWrite.descriptorType = vk::DescriptorType::eUniformBufferDynamic;
+	descriptorWrite.descriptorCount = 1;
+	descriptorWrite.pBufferInfo = &bufferInfo;
 	
-	graphicsPipeline->deviceContext->device.updateDescriptorSets(std::size(descriptorWrites), descriptorWrites.data(), 0, nullptr);
+	graphicsPipeline->deviceContext->device.updateDescriptorSets(1, &descriptorWrite, 0, nullptr);
 }
@@ -4,7 +4,7 @@
 #include <vulkan/vulkan.hpp>
 
 #include "ice.hpp"
-#include "vkhBuffer.hpp"
+#include "vkhFrameRingBuffer.hpp"
 #include "vkhShader.hpp"
 
 namespace vkh {
@@ -21,16 +21,19 @@ struct Material
 	void imguiEditor();
 	
 	void updateMember(void* bufferData, size_t& offset, vkh::ShaderReflector::ReflectedDescriptorSet::Member const& mem);
-	void updateBuffer();
+	// push the parameters to the frame ring buffer, once per frame before bind
+	void updateBuffer(vkh::FrameRingBuffer& frameRingBuffer);
 	
-	void bind(vk::CommandBuffer cmdBuffer, uint32 index);
+	void bind(vk::CommandBuffer cmdBuffer);
 	
-	void updateDescriptorSets();
+	// point descriptorSet to the frame ring buffer, the block is selected by the dynamic offset at bind
+	void updateDescriptorSets(vkh::FrameRingBuffer const& frameRingBuffer);
 	
 	vkh::GraphicsPipeline* graphicsPipeline;
 
 	std::vector<vkh::ShaderReflector::ReflectedDescriptorSet::Member> parameters;
 	
-	std::vector<vk::DescriptorSet> descriptorSets;
-	vkh::Buffer uniformBuffer;
+	vk::DescriptorSet descriptorSet;
+	// offset of this frame parameters in the frame ring buffer
+	uint32 dynamicOffset = 0;
 };
@@ -0,0 +1,542 @@
+#include "assetStreamer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <stb/stb_image.h>
+
+#include "meshBounds.hpp"
+#include "mipGenerator.hpp"
+#include "textureFile.hpp"
+#include "vkhDeviceContext.hpp"
+#include "vkhUploadManager.hpp"
+#include "vkhUtility.hpp"
+
+static LoadedMesh makePlaceholderCube()
+{
+	LoadedMesh cube;
+	for (uint32 i = 0; i < 8; i++)
+	{
+		LoadedMesh::Vertex vertex{};
+		vertex.pos = glm::vec3(i & 1 ? 0.5f : -0.5f, i & 2 ? 0.5f : -0.5f, i & 4 ? 0.5f : -0.5f);
+		vertex.normal = glm::normalize(vertex.pos);
+		vertex.color = glm::vec3(1.0f);
+		cube.vertices.push_back(vertex);
+	}
+
+	// two counter clockwise triangles per face
+	cube.indices = {
+		0, 2, 1,  1, 2, 3,
+		4, 5, 6,  5, 7, 6,
+		0, 1, 4,  1, 5, 4,
+		2, 6, 3,  3, 6, 7,
+		0, 4, 2,  2, 4, 6,
+		1, 3, 5,  3, 7, 5,
+	};
+	computeMeshBounds(cube);
+	return cube;
+}
+
+static vkh::Texture::CreateInfo makeTextureInfo(uint32 width, uint32 height, vk::Format format, uint32 mipLevels)
+{
+	vkh::Texture::CreateInfo textureInfo;
+	textureInfo.format = format;
+	textureInfo.tiling = vk::ImageTiling::eOptimal;
+	textureInfo.mipLevels = mipLevels;
+	textureInfo.width = width;
+	textureInfo.height = height;
+	return textureInfo;
+}
+
+static vk::Extent3D getImageExtent(std::filesystem::path const& imagePath)
+{
+	int width, height, channels;
+	if (!stbi_info(imagePath.string().c_str(), &width, &height, &channels))
+		throw std::runtime_error("failed to load texture image " + imagePath.string());
+	return { static_cast<uint32>(width), static_cast<uint32>(height), 1 };
+}
+
+static vk::DeviceSize getFullChainSize(vk::Format format, vk::Extent3D extent)
+{
+	return vkh::getMipChainSize(format, extent, 0, vkh::getMipLevelCount(extent.width, extent.height));
+}
+
+// bytes importTextureCached holds besides its result while it encodes an image: the decoded image and its RGBA mip chain
+// none when the import cache exists, it is then most likely up to date
+static vk::DeviceSize getImportBytes(std::filesystem::path const& imagePath, vk::Extent3D extent)
+{
+	if (std::filesystem::exists(getImportCachePath(imagePath)))
+		return 0;
+	return vkh::getMipLevelSize(vk::Format::eR8G8B8A8Unorm, extent, 0) + getFullChainSize(vk::Format::eR8G8B8A8Unorm, extent);
+}
+
+AssetStreamer::~AssetStreamer()
+{
+	destroy();
+}
+
+void AssetStreamer::create(vkh::DeviceContext& ctx, CreateInfo const& info)
+{
+	deviceContext = &ctx;
+	uploadBudget = info.uploadBudget;
+	decodedBudget = info.decodedBudget;
+	decodedBytes = 0;
+	// before the workers start, they read the tail size
+	residency.create(info.streaming);
+
+	placeholderMesh.emplace(ctx, makePlaceholderCube());
+
+	// magenta and black checker
+	uint8 checker[] = {
+		255, 0, 255, 255,  0, 0, 0, 255,
+		0, 0, 0, 255,  255, 0, 255, 255,
+	};
+	vkh::Texture::CreateInfo placeholderInfo = makeTextureInfo(2, 2, vk::Format::eR8G8B8A8Srgb, 1);
+	placeholderInfo.data = checker;
+	placeholderTexture.create(ctx, placeholderInfo);
+
+	// the render thread keeps a core for itself
+	uint32 threadCount = info.threadCount;
+	if (threadCount == 0)
+		threadCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+
+	stopping = false;
+	for (uint32 i = 0; i < threadCount; i++)
+		workers.emplace_back(&AssetStreamer::workerLoop, this);
+}
+
+void AssetStreamer::destroy()
+{
+	{
+		std::lock_guard lock(mutex);
+		stopping = true;
+		jobs.clear();
+	}
+	jobAvailable.notify_all();
+	decodedBytesReleased.notify_all();
+
+	for (auto& worker : workers)
+		worker.join();
+	workers.clear();
+
+	decoded.clear();
+	decodedBytes = 0;
+	meshes.clear();
+	textures.clear();
+	pendingCount = 0;
+	residency.clear();
+	residencySlots.clear();
+	placeholderMesh.reset();
+	placeholderTexture.destroy();
+}
+
+MeshHandle AssetStreamer::loadMesh(std::filesystem::path const& objPath, MeshImportOptions const& options)
+{
+	uint32 const index = static_cast<uint32>(meshes.size());
+	meshes.emplace_back();
+
+	pushJob({ DecodedAsset::Type::Mesh, index, objPath, [objPath, options](DecodedAsset& asset)
+	{
+		asset.meshCache = loadObjCached(objPath, options);
+	} });
+
+	return { index };
+}
+
+TextureHandle AssetStreamer::loadTexture(std::filesystem::path const& imagePath, vk::Format format)
+{
+	uint32 const index = static_cast<uint32>(textures.size());
+	textures.emplace_back();
+
+	pushJob(makeTextureJob(index, imagePath, format));
+
+	return { index };
+}
+
+TextureHandle AssetStreamer::streamTexture(std::filesystem::path const& path, vk::Format format)
+{
+	uint32 const index = static_cast<uint32>(textures.size());
+	textures.emplace_back();
+
+	pushJob({ DecodedAsset::Type::Texture, index, path, [this, path, format](DecodedAsset& asset)
+	{
+		// only the headers are read, imported images are streamed from their import cache
+		bool const container = isTextureContainer(path);
+		if (!container)
+		{
+			// the first stream of an image imports it, the decoded image and both of its chains are held meanwhile
+			vk::Extent3D const extent = getImageExtent(path);
+			vk::DeviceSize importSize = getImportBytes(path, extent);
+			if (importSize > 0)
+			{
+				importSize += getFullChainSize(format, extent);
+				reserveDecodedBytes(importSize);
+				asset.reservedBytes = importSize;
+			}
+		}
+		TextureFile const header = container ? loadTextureFile(path, UINT32_MAX) : importTextureCached(path, format, UINT32_MAX);
+		if (asset.reservedBytes > 0)
+		{
+			releaseDecodedBytes(asset.reservedBytes);
+			asset.reservedBytes = 0;
+		}
+		asset.streamed = true;
+		asset.streamPath = container ? path : getImportCachePath(path);
+		decodeTextureLevels(asset, asset.streamPath, residency.getTailLevel(header.width, header.height, header.mipLevels));
+	} });
+
+	return { index };
+}
+
+void AssetStreamer::requestMipLevel(TextureHandle handle, uint32 level)
+{
+	TextureSlot const& slot = textures[handle.index];
+	if (slot.residencyId != TextureSlot::notStreamed)
+		residency.request(slot.residencyId, level);
+}
+
+void AssetStreamer::requestTexelDensity(TextureHandle handle, float uvWorldSize, float distance, float projectionScale)
+{
+	TextureSlot const& slot = textures[handle.index];
+	if (slot.residencyId != TextureSlot::notStreamed)
+		residency.request(slot.residencyId, computeMipLevel(slot.width, slot.height, uvWorldSize, distance, projectionScale));
+}
+
+uint32 AssetStreamer::update()
+{
+	uint32 finished = 0;
+	vk::DeviceSize uploaded = 0;
+
+	while (uploaded < uploadBudget)
+	{
+		DecodedAsset asset;
+		{
+			std::lock_guard lock(mutex);
+			if (decoded.empty())
+				break;
+			asset = std::move(decoded.front());
+			decoded.pop_front();
+		}
+
+		AssetState state = AssetState::Failed;
+		if (!asset.failed)
+		{
+			try
+			{
+				if (asset.type == DecodedAsset::Type::Mesh)
+				{
+					MeshView const view = asset.meshCache.getView();
+					meshes[asset.index].mesh.emplace(*deviceContext, view);
+					uploaded += view.vertices.size_bytes() + view.indices.size_bytes();
+				}
+				else if (asset.type == DecodedAsset::Type::Texture)
+				{
+					TextureSlot& slot = textures[asset.index];
+					uploaded += asset.staging.size;
+					slot.texture.create(*deviceContext, makeTextureInfo(asset.width, asset.height, asset.format, asset.mipLevels), std::move(asset.staging));
+					if (asset.streamed)
+					{
+						slot.residencyId = residency.add(asset.format, asset.sourceWidth, asset.sourceHeight, asset.sourceMipLevels);
+						slot.streamPath = std::move(asset.streamPath);
+						slot.width = asset.sourceWidth;
+						slot.height = asset.sourceHeight;
+						residencySlots.push_back(asset.index);
+					}
+				}
+				else
+				{
+					TextureSlot& slot = textures[asset.index];
+					uploaded += asset.staging.size;
+					vkh::Texture texture;
+					texture.create(*deviceContext, makeTextureInfo(asset.width, asset.height, asset.format, asset.mipLevels), std::move(asset.staging));
+					// frames in flight may still sample the previous levels
+					deviceContext->deletionQueue.push(std::move(slot.texture));
+					slot.texture = std::move(texture);
+					residency.onResident(slot.residencyId);
+				}
+				state = AssetState::Ready;
+			}
+			catch (std::exception const& e)
+			{
+				state = AssetState::Failed;
+				asset.error = e.what();
+			}
+		}
+
+		if (state == AssetState::Failed)
+		{
+			char const* const typeName = asset.type == DecodedAsset::Type::Mesh ? "mesh" : asset.type == DecodedAsset::Type::Texture ? "texture" : "texture levels";
+			printf("[asset streamer] failed to load %s %s: %s\n", typeName, asset.path.string().c_str(), asset.error.c_str());
+		}
+
+		if (asset.type == DecodedAsset::Type::Mesh)
+			meshes[asset.index].state = state;
+		else if (asset.type == DecodedAsset::Type::Texture)
+			textures[asset.index].state = state;
+		// the texture keeps its current levels
+		else if (state == AssetState::Failed)
+			residency.onChangeFailed(textures[asset.index].residencyId);
+
+		// the decoded data is in staging memory or dropped
+		if (asset.reservedBytes > 0)
+			releaseDecodedBytes(asset.reservedBytes);
+
+		pendingCount--;
+		finished++;
+	}
+
+	for (auto const& change : residency.update())
+	{
+		uint32 const index = residencySlots[change.texture];
+		uint32 const residentLevel = residency.getResidentLevel(change.texture);
+		// coarser levels are already resident, they are copied on the GPU instead of being read again
+		if (change.firstLevel > residentLevel && deviceContext->uploadManager)
+		{
+			TextureSlot& slot = textures[index];
+			try
+			{
+				vkh::Texture texture;
+				texture.create(*deviceContext, slot.texture, change.firstLevel - residentLevel);
+				// the copy is submitted before the frame, which also keeps the previous levels until it completes
+				deviceContext->deletionQueue.push(std::move(slot.texture));
+				slot.texture = std::move(texture);
+				residency.onResident(change.texture);
+			}
+			catch (std::exception const& e)
+			{
+				printf("[asset streamer] failed to reduce texture %s: %s\n", slot.streamPath.string().c_str(), e.what());
+				residency.onChangeFailed(change.texture);
+			}
+			continue;
+		}
+
+		pushJob({ DecodedAsset::Type::TextureLevels, index, textures[index].streamPath, [this, path = textures[index].streamPath, firstLevel = change.firstLevel](DecodedAsset& asset)
+		{
+			decodeTextureLevels(asset, path, firstLevel);
+		} });
+	}
+
+	return finished;
+}
+
+AssetStreamer::Job AssetStreamer::makeTextureJob(uint32 index, std::filesystem::path const& imagePath, vk::Format format)
+{
+	return { DecodedAsset::Type::Texture, index, imagePath, [this, imagePath, format](DecodedAsset& asset)
+	{
+		bool const container = isTextureContainer(imagePath);
+
+		// reserve the bytes held at once before decoding, headers are enough to know them:
+		// the decoded levels, the chain generated on the CPU if any and the staging copy of one of them
+		vk::DeviceSize decodedSize = 0;
+		if (container)
+		{
+			TextureFile const header = loadTextureFile(imagePath, UINT32_MAX);
+			vk::Extent3D const extent{ header.width, header.height, 1 };
+			vk::DeviceSize const levelsSize = vkh::getMipChainSize(header.format, extent, 0, header.mipLevels);
+			bool const generateMips = header.mipLevels == 1 && !vkh::isBlockCompressed(header.format) && !canBlitMips(header.format);
+			vk::DeviceSize const chainSize = generateMips ? getFullChainSize(header.format, extent) : 0;
+			decodedSize = levelsSize + chainSize + (generateMips ? chainSize : levelsSize);
+		}
+		else if (vkh::isBlockCompressed(format))
+		{
+			vk::Extent3D const extent = getImageExtent(imagePath);
+			decodedSize = getImportBytes(imagePath, extent) + 2 * getFullChainSize(format, extent);
+		}
+		else
+		{
+			vk::Extent3D const extent = getImageExtent(imagePath);
+			vk::DeviceSize const imageSize = vkh::getMipLevelSize(format, extent, 0);
+			vk::DeviceSize const chainSize = canBlitMips(format) ? 0 : getFullChainSize(format, extent);
+			decodedSize = imageSize + chainSize + (chainSize > 0 ? chainSize : imageSize);
+		}
+		reserveDecodedBytes(decodedSize);
+		asset.reservedBytes = decodedSize;
+
+		// the decoder allocates its own output, it is copied once in mapped staging memory that the upload reads from
+		// levels that cannot be blitted on upload are generated here, off the render thread
+		auto const stage = [&](std::span<uint8 const> data, bool hasMipChain)
+		{
+			std::vector<uint8> mipChain;
+			if (asset.mipLevels > 1 && !hasMipChain && !canBlitMips(asset.format))
+			{
+				mipChain = generateMipChain(data, asset.width, asset.height, asset.format, asset.mipLevels);
+				data = mipChain;
+			}
+
+			asset.staging = allocateStaging(data.size_bytes());
+			memcpy(asset.staging.getMapped(), data.data(), data.size_bytes());
+		};
+
+		if (container || vkh::isBlockCompressed(format))
+		{
+			TextureFile const file = container ? loadTextureFile(imagePath) : importTextureCached(imagePath, format);
+			asset.width = file.width;
+			asset.height = file.height;
+			asset.format = file.format;
+			// a lone uncompressed level gets its chain generated
+			bool const generateMips = file.mipLevels == 1 && !vkh::isBlockCompressed(file.format);
+			asset.mipLevels = generateMips ? vkh::getMipLevelCount(file.width, file.height) : file.mipLevels;
+			stage(file.data, !generateMips);
+			return;
+		}
+
+		int width, height, channels;
+		stbi_uc* pixels = stbi_load(imagePath.string().c_str(), &width, &height, &channels, STBI_rgb_alpha);
+		if (!pixels)
+			throw std::runtime_error("failed to load texture image " + imagePath.string());
+
+		asset.width = static_cast<uint32>(width);
+		asset.height = static_cast<uint32>(height);
+		asset.format = format;
+		asset.mipLevels = vkh::getMipLevelCount(asset.width, asset.height);
+		try
+		{
+			stage({ pixels, static_cast<size_t>(width) * height * 4 }, false);
+		}
+		catch (...)
+		{
+			stbi_image_free(pixels);
+			throw;
+		}
+		stbi_image_free(pixels);
+	} };
+}
+
+void AssetStreamer::decodeTextureLevels(DecodedAsset& asset, std::filesystem::path const& path, uint32 firstLevel)
+{
+	// the levels read from the file and their staging copy
+	TextureFile const header = loadTextureFile(path, UINT32_MAX);
+	vk::DeviceSize const levelsSize = vkh::getMipChainSize(header.format, { header.width, header.height, 1 }, std::min(firstLevel, header.mipLevels), header.mipLevels);
+	reserveDecodedBytes(2 * levelsSize);
+	asset.reservedBytes = 2 * levelsSize;
+
+	// the file is mapped, the levels before firstLevel are never read
+	TextureFile const file = loadTextureFile(path, firstLevel);
+	if (file.firstLevel == file.mipLevels)
+		throw std::runtime_error("texture file " + path.string() + " has no level " + std::to_string(firstLevel));
+
+	vk::Extent3D const extent = vkh::getMipExtent({ file.width, file.height, 1 }, file.firstLevel);
+	asset.width = extent.width;
+	asset.height = extent.height;
+	asset.format = file.format;
+	asset.mipLevels = file.mipLevels - file.firstLevel;
+	asset.sourceWidth = file.width;
+	asset.sourceHeight = file.height;
+	asset.sourceMipLevels = file.mipLevels;
+
+	asset.staging = allocateStaging(file.data.size());
+	memcpy(asset.staging.getMapped(), file.data.data(), file.data.size());
+}
+
+bool AssetStreamer::canBlitMips(vk::Format format) const
+{
+	return deviceContext->uploadManager && vkh::supportsLinearBlit(deviceContext->physicalDevice, format);
+}
+
+AssetState AssetStreamer::getState(MeshHandle handle) const
+{
+	return meshes[handle.index].state;
+}
+
+AssetState AssetStreamer::getState(TextureHandle handle) const
+{
+	return textures[handle.index].state;
+}
+
+Mesh& AssetStreamer::getMesh(MeshHandle handle)
+{
+	auto& slot = meshes[handle.index];
+	return slot.state == AssetState::Ready ? *slot.mesh : *placeholderMesh;
+}
+
+vkh::Texture& AssetStreamer::getTexture(TextureHandle handle)
+{
+	auto& slot = textures[handle.index];
+	return slot.state == AssetState::Ready ? slot.texture : placeholderTexture;
+}
+
+bool AssetStreamer::isIdle() const
+{
+	return pendingCount == 0;
+}
+
+void AssetStreamer::pushJob(Job job)
+{
+	assert(!workers.empty());
+
+	pendingCount++;
+	{
+		std::lock_guard lock(mutex);
+		jobs.push_back(std::move(job));
+	}
+	jobAvailable.notify_one();
+}
+
+void AssetStreamer::workerLoop()
+{
+	while (true)
+	{
+		Job job;
+		{
+			std::unique_lock lock(mutex);
+			jobAvailable.wait(lock, [this]() { return stopping || !jobs.empty(); });
+			if (stopping)
+				return;
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+
+		DecodedAsset asset;
+		asset.type = job.type;
+		asset.index = job.index;
+		asset.path = job.path;
+		try
+		{
+			job.decode(asset);
+		}
+		catch (std::exception const& e)
+		{
+			asset.failed = true;
+			asset.error = e.what();
+		}
+
+		std::lock_guard lock(mutex);
+		decoded.push_back(std::move(asset));
+	}
+}
+
+void AssetStreamer::reserveDecodedBytes(vk::DeviceSize size)
+{
+	std::unique_lock lock(mutex);
+	decodedBytesReleased.wait(lock, [this, size]() { return stopping || decodedBytes == 0 || decodedBytes + size <= decodedBudget; });
+	if (stopping)
+		throw std::runtime_error("asset streamer stopped");
+	decodedBytes += size;
+}
+
+void AssetStreamer::releaseDecodedBytes(vk::DeviceSize size)
+{
+	{
+		std::lock_guard lock(mutex);
+		decodedBytes -= size;
+	}
+	decodedBytesReleased.notify_all();
+}
+
+vkh::Buffer AssetStreamer::allocateStaging(vk::DeviceSize size)
+{
+	if (deviceContext->uploadManager)
+		return deviceContext->uploadManager->allocateStaging(size);
+
+	vk::BufferCreateInfo stagingInfo;
+	stagingInfo.usage = vk::BufferUsageFlagBits::eTransferSrc;
+	stagingInfo.size = size;
+	stagingInfo.sharingMode = vk::SharingMode::eExclusive;
+
+	vkh::Buffer staging;
+	staging.create(*deviceContext, stagingInfo, vkh::BufferLocation::HostMapped);
+	return staging;
+}
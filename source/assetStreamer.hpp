@@ -0,0 +1,192 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "ice.hpp"
+#include "mesh.hpp"
+#include "meshCache.hpp"
+#include "textureResidency.hpp"
+#include "vkhTexture.hpp"
+
+namespace vkh {
+	struct DeviceContext;
+}
+
+enum class AssetState : uint8
+{
+	Loading,
+	Ready,
+	// the placeholder stays bound
+	Failed,
+};
+
+struct MeshHandle
+{
+	uint32 index;
+};
+
+struct TextureHandle
+{
+	uint32 index;
+};
+
+// Load meshes and textures in the background, load calls return immediately with a handle
+// Parsing and decoding run on worker threads, GPU resources are created by update on the render thread.
+// Until an asset is ready its handle resolves to a placeholder: a unit cube or a checker texture.
+// Streamed textures start with their low mips, finer levels are loaded from the file when requested and dropped again under
+// the streaming budget (see TextureResidency), a residency change swaps the texture for one with the new levels.
+class AssetStreamer
+{
+public:
+	struct CreateInfo
+	{
+		// 0 = hardware concurrency - 1
+		uint32 threadCount = 0;
+		// bytes uploaded by a single update call, at least one asset is uploaded per call
+		vk::DeviceSize uploadBudget = 64 << 20;
+		// decoded texture bytes waiting for their upload, workers stall before decoding more, a single larger texture goes alone
+		// keep it at most UploadManager::CreateInfo::decodeStagingSize, the staging of decoded textures then fits in its pool
+		vk::DeviceSize decodedBudget = 512 << 20;
+		// residency of the textures of streamTexture
+		TextureResidency::CreateInfo streaming;
+	};
+
+	AssetStreamer() = default;
+	ICE_NON_DISPATCHABLE_CLASS(AssetStreamer)
+	~AssetStreamer();
+
+	void create(vkh::DeviceContext& ctx, CreateInfo const& info = {});
+	// pending loads are dropped
+	void destroy();
+
+	[[nodiscard]] MeshHandle loadMesh(std::filesystem::path const& objPath, MeshImportOptions const& options = {});
+	// images are decoded to RGBA8, or compressed with their mip chain when format is a BC format (see importTextureCached)
+	// KTX2 and DDS files keep their own format and levels
+	[[nodiscard]] TextureHandle loadTexture(std::filesystem::path const& imagePath, vk::Format format = vk::Format::eR8G8B8A8Srgb);
+	// path is a KTX2 or DDS file with its mip chain, or an image imported to the BC format (see importTextureCached)
+	// only the tail of the chain is loaded, finer levels follow the requests
+	[[nodiscard]] TextureHandle streamTexture(std::filesystem::path const& path, vk::Format format = vk::Format::eBc7SrgbBlock);
+	// finest level needed by a use of a streamed texture this frame, e.g. from GPU feedback, ignored for other textures
+	void requestMipLevel(TextureHandle handle, uint32 level);
+	// requestMipLevel from the screen-space texel density of a surface, see computeMipLevel
+	void requestTexelDensity(TextureHandle handle, float uvWorldSize, float distance, float projectionScale);
+
+	// create GPU resources of decoded assets and plan the residency of streamed textures from the requests since the last call
+	// return the number of assets that finished loading (ready or failed) or changed residency, their descriptors are stale
+	uint32 update();
+
+	[[nodiscard]] AssetState getState(MeshHandle handle) const;
+	[[nodiscard]] AssetState getState(TextureHandle handle) const;
+	// placeholder until the asset is ready
+	[[nodiscard]] Mesh& getMesh(MeshHandle handle);
+	[[nodiscard]] vkh::Texture& getTexture(TextureHandle handle);
+
+	// true when every load has finished, residency changes included
+	[[nodiscard]] bool isIdle() const;
+
+private:
+	struct MeshSlot
+	{
+		AssetState state = AssetState::Loading;
+		std::optional<Mesh> mesh;
+	};
+
+	struct TextureSlot
+	{
+		static uint32 constexpr notStreamed = UINT32_MAX;
+
+		AssetState state = AssetState::Loading;
+		vkh::Texture texture;
+
+		// streamed textures, set once their tail is loaded
+		uint32 residencyId = notStreamed;
+		std::filesystem::path streamPath;
+		uint32 width = 0, height = 0;
+	};
+
+	// output of a worker, consumed by update
+	struct DecodedAsset
+	{
+		// TextureLevels replaces the texture of a streamed slot
+		enum class Type : uint8 { Mesh, Texture, TextureLevels };
+		
+		Type type = Type::Mesh;
+		uint32 index = 0;
+		bool failed = false;
+		// what() of the exception that failed the asset and the file of its job, logged by update
+		std::string error;
+		std::filesystem::path path;
+
+		MeshCache meshCache;
+
+		// tightly packed levels written by the worker, consumed by the texture without a copy
+		vkh::Buffer staging;
+		uint32 width = 0, height = 0;
+		vk::Format format = vk::Format::eUndefined;
+		uint32 mipLevels = 1;
+		// counted in the decoded budget until the asset is uploaded
+		vk::DeviceSize reservedBytes = 0;
+
+		// streamed textures, staging holds the last levels of a sourceWidth x sourceHeight texture
+		bool streamed = false;
+		std::filesystem::path streamPath;
+		uint32 sourceWidth = 0, sourceHeight = 0, sourceMipLevels = 0;
+	};
+
+	struct Job
+	{
+		DecodedAsset::Type type;
+		uint32 index;
+		// file the job loads, for error reports
+		std::filesystem::path path;
+		// run on a worker, fill the decoded asset or throw
+		std::function<void(DecodedAsset&)> decode;
+	};
+
+	[[nodiscard]] Job makeTextureJob(uint32 index, std::filesystem::path const& imagePath, vk::Format format);
+	// run on a worker, stage the levels from firstLevel of a texture file, reserved in the decoded budget
+	void decodeTextureLevels(DecodedAsset& asset, std::filesystem::path const& path, uint32 firstLevel);
+	void pushJob(Job job);
+	void workerLoop();
+	// block the worker until size fits in the decoded budget, throw when the streamer stops
+	void reserveDecodedBytes(vk::DeviceSize size);
+	void releaseDecodedBytes(vk::DeviceSize size);
+	// the upload generates the missing levels of format instead of the worker
+	[[nodiscard]] bool canBlitMips(vk::Format format) const;
+	// mapped staging buffer for a worker to write texture data in, thread safe
+	[[nodiscard]] vkh::Buffer allocateStaging(vk::DeviceSize size);
+
+	vkh::DeviceContext* deviceContext = nullptr;
+	vk::DeviceSize uploadBudget = 0;
+
+	std::optional<Mesh> placeholderMesh;
+	vkh::Texture placeholderTexture;
+
+	// only touched by the render thread, deques keep references stable
+	std::deque<MeshSlot> meshes;
+	std::deque<TextureSlot> textures;
+	uint32 pendingCount = 0;
+
+	TextureResidency residency;
+	// texture slot of each residency id
+	std::vector<uint32> residencySlots;
+
+	std::mutex mutex;
+	std::condition_variable jobAvailable;
+	std::deque<Job> jobs;
+	std::deque<DecodedAsset> decoded;
+	std::condition_variable decodedBytesReleased;
+	vk::DeviceSize decodedBytes = 0;
+	vk::DeviceSize decodedBudget = 0;
+	bool stopping = false;
+	std::vector<std::thread> workers;
+};
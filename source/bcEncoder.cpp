@@ -0,0 +1,424 @@
+#include "bcEncoder.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include "utility.hpp"
+#include "vkhUtility.hpp"
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define ICE_BC_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	enum class BcKind : uint8
+	{
+		None,
+		Bc1,
+		Bc3,
+		Bc5,
+		Bc7,
+	};
+
+	BcKind getBcKind(vk::Format format) noexcept
+	{
+		switch (format)
+		{
+		case vk::Format::eBc1RgbUnormBlock:
+		case vk::Format::eBc1RgbSrgbBlock:
+		case vk::Format::eBc1RgbaUnormBlock:
+		case vk::Format::eBc1RgbaSrgbBlock:
+			return BcKind::Bc1;
+		case vk::Format::eBc3UnormBlock:
+		case vk::Format::eBc3SrgbBlock:
+			return BcKind::Bc3;
+		case vk::Format::eBc5UnormBlock:
+			return BcKind::Bc5;
+		case vk::Format::eBc7UnormBlock:
+		case vk::Format::eBc7SrgbBlock:
+			return BcKind::Bc7;
+		default:
+			return BcKind::None;
+		}
+	}
+
+	// 4x4 RGBA8 texels in row order
+	struct Block
+	{
+		alignas(16) uint8 texels[64];
+
+		[[nodiscard]] uint8 const* texel(uint32 i) const noexcept
+		{
+			return texels + 4 * i;
+		}
+	};
+
+	using Color = int[4];
+
+	// BC7 mode 6 interpolation weights of the 4 bit indices
+	int constexpr bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+	void loadBlock(uint8 const* rgba, uint32 width, uint32 height, uint32 blockX, uint32 blockY, Block& block)
+	{
+		uint32 const x = blockX * 4;
+		uint32 const y = blockY * 4;
+		if (x + 4 <= width && y + 4 <= height)
+		{
+			for (uint32 row = 0; row < 4; row++)
+				memcpy(block.texels + 16 * row, rgba + (size_t(y + row) * width + x) * 4, 16);
+			return;
+		}
+
+		for (uint32 row = 0; row < 4; row++)
+		{
+			size_t const sy = std::min(y + row, height - 1);
+			for (uint32 column = 0; column < 4; column++)
+			{
+				size_t const sx = std::min(x + column, width - 1);
+				memcpy(block.texels + 16 * row + 4 * column, rgba + (sy * width + sx) * 4, 4);
+			}
+		}
+	}
+
+	void getBounds(Block const& block, uint8 (&minColor)[4], uint8 (&maxColor)[4])
+	{
+#if ICE_BC_SSE
+		__m128i const r0 = _mm_load_si128(reinterpret_cast<__m128i const*>(block.texels));
+		__m128i const r1 = _mm_load_si128(reinterpret_cast<__m128i const*>(block.texels + 16));
+		__m128i const r2 = _mm_load_si128(reinterpret_cast<__m128i const*>(block.texels + 32));
+		__m128i const r3 = _mm_load_si128(reinterpret_cast<__m128i const*>(block.texels + 48));
+		__m128i mn = _mm_min_epu8(_mm_min_epu8(r0, r1), _mm_min_epu8(r2, r3));
+		__m128i mx = _mm_max_epu8(_mm_max_epu8(r0, r1), _mm_max_epu8(r2, r3));
+		// reduce the 4 texels of a row
+		mn = _mm_min_epu8(mn, _mm_shuffle_epi32(mn, _MM_SHUFFLE(2, 3, 0, 1)));
+		mn = _mm_min_epu8(mn, _mm_shuffle_epi32(mn, _MM_SHUFFLE(1, 0, 3, 2)));
+		mx = _mm_max_epu8(mx, _mm_shuffle_epi32(mx, _MM_SHUFFLE(2, 3, 0, 1)));
+		mx = _mm_max_epu8(mx, _mm_shuffle_epi32(mx, _MM_SHUFFLE(1, 0, 3, 2)));
+		int32 const packedMin = _mm_cvtsi128_si32(mn);
+		int32 const packedMax = _mm_cvtsi128_si32(mx);
+		memcpy(minColor, &packedMin, 4);
+		memcpy(maxColor, &packedMax, 4);
+#else
+		std::fill(std::begin(minColor), std::end(minColor), uint8(255));
+		std::fill(std::begin(maxColor), std::end(maxColor), uint8(0));
+		for (uint32 i = 0; i < 16; i++)
+		{
+			for (uint32 c = 0; c < 4; c++)
+			{
+				minColor[c] = std::min(minColor[c], block.texel(i)[c]);
+				maxColor[c] = std::max(maxColor[c], block.texel(i)[c]);
+			}
+		}
+#endif
+	}
+
+	// bounding box endpoints, a channel is flipped when it decreases along the channel of largest range
+	void selectEndpoints(Block const& block, uint32 channels, bool inset, Color& e0, Color& e1)
+	{
+		uint8 minColor[4], maxColor[4];
+		getBounds(block, minColor, maxColor);
+
+		uint32 axis = 0;
+		int mean[4] = {};
+		for (uint32 c = 0; c < channels; c++)
+		{
+			e0[c] = minColor[c];
+			e1[c] = maxColor[c];
+			// the box is shrunk by a 16th of its range, the extremes are rare compared to the inner colors
+			if (inset)
+			{
+				int const margin = (e1[c] - e0[c]) >> 4;
+				e0[c] += margin;
+				e1[c] -= margin;
+			}
+			if (maxColor[c] - minColor[c] > maxColor[axis] - minColor[axis])
+				axis = c;
+			for (uint32 i = 0; i < 16; i++)
+				mean[c] += block.texel(i)[c];
+		}
+
+		for (uint32 c = 0; c < channels; c++)
+		{
+			if (c == axis)
+				continue;
+			int covariance = 0;
+			for (uint32 i = 0; i < 16; i++)
+				covariance += (16 * block.texel(i)[axis] - mean[axis]) * (16 * block.texel(i)[c] - mean[c]);
+			if (covariance < 0)
+				std::swap(e0[c], e1[c]);
+		}
+	}
+
+	template<uint32 Channels>
+	uint32 findNearest(uint8 const* texel, Color const* palette, uint32 paletteSize)
+	{
+		uint32 best = 0;
+		int bestError = INT32_MAX;
+		for (uint32 i = 0; i < paletteSize; i++)
+		{
+			int error = 0;
+			for (uint32 c = 0; c < Channels; c++)
+			{
+				int const d = texel[c] - palette[i][c];
+				error += d * d;
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				best = i;
+			}
+		}
+		return best;
+	}
+
+	uint16 toRgb565(Color const& color)
+	{
+		auto quantize = [](int value, int bits) { return (value * ((1 << bits) - 1) + 127) / 255; };
+		return static_cast<uint16>(quantize(color[0], 5) << 11 | quantize(color[1], 6) << 5 | quantize(color[2], 5));
+	}
+
+	void fromRgb565(uint16 value, Color& color)
+	{
+		int const r = value >> 11, g = (value >> 5) & 63, b = value & 31;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+		color[3] = 255;
+	}
+
+	// opaque 4 color mode, 8 bytes
+	void encodeBc1(Block const& block, uint8* out)
+	{
+		Color e0, e1;
+		selectEndpoints(block, 3, true, e0, e1);
+
+		uint16 c0 = toRgb565(e1);
+		uint16 c1 = toRgb565(e0);
+		// c0 > c1 selects the 4 color mode
+		if (c0 < c1)
+			std::swap(c0, c1);
+
+		uint32 indices = 0;
+		if (c0 != c1)
+		{
+			Color palette[4];
+			fromRgb565(c0, palette[0]);
+			fromRgb565(c1, palette[1]);
+			for (uint32 c = 0; c < 3; c++)
+			{
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+			for (uint32 i = 0; i < 16; i++)
+				indices |= findNearest<3>(block.texel(i), palette, 4) << (2 * i);
+		}
+
+		memcpy(out, &c0, 2);
+		memcpy(out + 2, &c1, 2);
+		memcpy(out + 4, &indices, 4);
+	}
+
+	// single channel in the 8 value mode, 8 bytes
+	void encodeBc4(Block const& block, uint32 channel, uint8* out)
+	{
+		int lo = 255, hi = 0;
+		for (uint32 i = 0; i < 16; i++)
+		{
+			lo = std::min<int>(lo, block.texel(i)[channel]);
+			hi = std::max<int>(hi, block.texel(i)[channel]);
+		}
+
+		// the first endpoint must be the largest for the 8 value mode
+		uint64 bits = uint64(hi) | uint64(lo) << 8;
+		if (hi != lo)
+		{
+			int palette[8] = { hi, lo };
+			for (int i = 2; i < 8; i++)
+				palette[i] = ((8 - i) * hi + (i - 1) * lo + 3) / 7;
+
+			for (uint32 i = 0; i < 16; i++)
+			{
+				int const value = block.texel(i)[channel];
+				uint64 best = 0;
+				int bestError = INT32_MAX;
+				for (uint32 j = 0; j < 8; j++)
+				{
+					int const error = std::abs(value - palette[j]);
+					if (error < bestError)
+					{
+						bestError = error;
+						best = j;
+					}
+				}
+				bits |= best << (16 + 3 * i);
+			}
+		}
+
+		memcpy(out, &bits, 8);
+	}
+
+	struct BitWriter
+	{
+		uint64 bits[2] = {};
+		uint32 position = 0;
+
+		void write(uint64 value, uint32 count)
+		{
+			uint32 const word = position / 64;
+			uint32 const shift = position % 64;
+			bits[word] |= value << shift;
+			if (shift + count > 64)
+				bits[word + 1] |= value >> (64 - shift);
+			position += count;
+		}
+	};
+
+	// mode 6: one subset, RGBA 7 bit endpoints with a p bit each and 4 bit indices, 16 bytes
+	void encodeBc7(Block const& block, uint8* out)
+	{
+		Color endpoints[2];
+		selectEndpoints(block, 4, false, endpoints[0], endpoints[1]);
+
+		// the p bit is the shared low bit of an endpoint, keep the one closest to the endpoint
+		int quantized[2][4];
+		uint32 pBits[2];
+		Color reconstructed[2];
+		for (uint32 e = 0; e < 2; e++)
+		{
+			int bestError = INT32_MAX;
+			for (uint32 p = 0; p < 2; p++)
+			{
+				int q[4];
+				int error = 0;
+				for (uint32 c = 0; c < 4; c++)
+				{
+					q[c] = std::clamp((endpoints[e][c] - static_cast<int>(p) + 1) >> 1, 0, 127);
+					int const d = ((q[c] << 1) | static_cast<int>(p)) - endpoints[e][c];
+					error += d * d;
+				}
+				if (error < bestError)
+				{
+					bestError = error;
+					pBits[e] = p;
+					std::copy(std::begin(q), std::end(q), quantized[e]);
+				}
+			}
+			for (uint32 c = 0; c < 4; c++)
+				reconstructed[e][c] = (quantized[e][c] << 1) | static_cast<int>(pBits[e]);
+		}
+
+		Color palette[16];
+		for (uint32 i = 0; i < 16; i++)
+		{
+			for (uint32 c = 0; c < 4; c++)
+				palette[i][c] = ((64 - bc7Weights[i]) * reconstructed[0][c] + bc7Weights[i] * reconstructed[1][c] + 32) >> 6;
+		}
+
+		uint32 indices[16];
+		for (uint32 i = 0; i < 16; i++)
+			indices[i] = findNearest<4>(block.texel(i), palette, 16);
+
+		// the anchor index is stored without its high bit, swapping the endpoints mirrors the weights
+		if (indices[0] >= 8)
+		{
+			std::swap(quantized[0], quantized[1]);
+			std::swap(pBits[0], pBits[1]);
+			for (auto& index : indices)
+				index = 15 - index;
+		}
+
+		BitWriter writer;
+		writer.write(1 << 6, 7);
+		for (uint32 c = 0; c < 4; c++)
+		{
+			writer.write(quantized[0][c], 7);
+			writer.write(quantized[1][c], 7);
+		}
+		writer.write(pBits[0], 1);
+		writer.write(pBits[1], 1);
+		writer.write(indices[0], 3);
+		for (uint32 i = 1; i < 16; i++)
+			writer.write(indices[i], 4);
+		assert(writer.position == 128);
+
+		memcpy(out, writer.bits, 16);
+	}
+
+	void encodeBlock(BcKind kind, Block const& block, uint8* out)
+	{
+		switch (kind)
+		{
+		case BcKind::Bc1:
+			encodeBc1(block, out);
+			break;
+		case BcKind::Bc3:
+			encodeBc4(block, 3, out);
+			encodeBc1(block, out + 8);
+			break;
+		case BcKind::Bc5:
+			encodeBc4(block, 0, out);
+			encodeBc4(block, 1, out + 8);
+			break;
+		case BcKind::Bc7:
+			encodeBc7(block, out);
+			break;
+		default:
+			assert(false);
+		}
+	}
+}
+
+bool canEncodeBc(vk::Format format) noexcept
+{
+	return getBcKind(format) != BcKind::None;
+}
+
+std::vector<uint8> encodeBc(std::span<uint8 const> rgba, uint32 width, uint32 height, vk::Format format)
+{
+	BcKind const kind = getBcKind(format);
+	if (kind == BcKind::None)
+		throw std::runtime_error("unsupported block compression format");
+	assert(rgba.size_bytes() >= size_t(width) * height * 4);
+
+	uint32 const blocksX = (width + 3) / 4;
+	uint32 const blocksY = (height + 3) / 4;
+	size_t const blockSize = vkh::getFormatBlock(format).size;
+	std::vector<uint8> encoded(size_t(blocksX) * blocksY * blockSize);
+
+	parallelFor(blocksY, [&](size_t blockY)
+	{
+		Block block;
+		uint8* out = encoded.data() + blockY * blocksX * blockSize;
+		for (uint32 blockX = 0; blockX < blocksX; blockX++, out += blockSize)
+		{
+			loadBlock(rgba.data(), width, height, blockX, static_cast<uint32>(blockY), block);
+			encodeBlock(kind, block, out);
+		}
+	});
+
+	return encoded;
+}
+
+std::vector<uint8> encodeBcMipChain(std::span<uint8 const> rgbaChain, uint32 width, uint32 height, uint32 levelCount, vk::Format format)
+{
+	vk::Extent3D const extent{ width, height, 1 };
+
+	std::vector<uint8> encoded;
+	size_t offset = 0;
+	for (uint32 level = 0; level < levelCount; level++)
+	{
+		vk::Extent3D const levelExtent = vkh::getMipExtent(extent, level);
+		size_t const levelSize = vkh::getMipLevelSize(vk::Format::eR8G8B8A8Unorm, extent, level);
+		assert(offset + levelSize <= rgbaChain.size_bytes());
+
+		mergeVectors(encoded, encodeBc(rgbaChain.subspan(offset, levelSize), levelExtent.width, levelExtent.height, format));
+		offset += levelSize;
+	}
+	return encoded;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "ice.hpp"
+
+// CPU block compression of RGBA8 images to BC1, BC3, BC5 and BC7, unorm or sRGB
+// Single pass encoders fast enough for import time: bounding box endpoints oriented along the block's color axis and an
+// exhaustive search of the palette indices. BC1 is opaque, BC5 keeps red and green, BC7 only uses mode 6.
+// Block rows are encoded in parallel, partial blocks at the edges replicate the last row and column.
+
+// bump when the encoders or the mip filter change their output, cached imports of older versions are rebuilt
+inline constexpr uint32 bcEncoderVersion = 1;
+
+[[nodiscard]] bool canEncodeBc(vk::Format format) noexcept;
+
+// encode one level of tightly packed RGBA8 texels, throw on unsupported formats
+std::vector<uint8> encodeBc(std::span<uint8 const> rgba, uint32 width, uint32 height, vk::Format format);
+// encode levelCount tightly packed RGBA8 levels, see generateMipChain
+std::vector<uint8> encodeBcMipChain(std::span<uint8 const> rgbaChain, uint32 width, uint32 height, uint32 levelCount, vk::Format format);
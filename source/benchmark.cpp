@@ -0,0 +1,333 @@
+#include "benchmark.hpp"
+
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "mesh.hpp"
+#include "meshlet.hpp"
+#include "meshOptimizer.hpp"
+#include "meshSimplifier.hpp"
+#include "objImporter.hpp"
+
+namespace
+{
+	template<typename F>
+	double measureSeconds(F&& func)
+	{
+		auto const start = std::chrono::steady_clock::now();
+		func();
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	size_t parseCount(std::span<char const* const> args, size_t index, size_t defaultValue)
+	{
+		if (index >= args.size())
+			return defaultValue;
+
+		size_t value = 0;
+		char const* const end = args[index] + strlen(args[index]);
+		auto const [ptr, ec] = std::from_chars(args[index], end, value);
+		if (ec != std::errc() || ptr != end || value == 0)
+			throw std::runtime_error(std::string("invalid count ") + args[index]);
+		return value;
+	}
+
+	// Buffered text output, the synthetic files are several GB
+	class TextWriter
+	{
+	public:
+		explicit TextWriter(std::filesystem::path const& path) : out(path, std::ios::binary | std::ios::trunc)
+		{
+			if (!out.is_open())
+				throw std::runtime_error("failed to open file " + path.string());
+			buffer.reserve(bufferSize + 256);
+		}
+
+		~TextWriter()
+		{
+			flush();
+		}
+
+		void put(char const* text)
+		{
+			buffer += text;
+		}
+
+		void put(float value)
+		{
+			char digits[32];
+			auto const [ptr, ec] = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::fixed, 5);
+			buffer.append(digits, ptr);
+		}
+
+		void put(size_t value)
+		{
+			char digits[32];
+			auto const [ptr, ec] = std::to_chars(digits, digits + sizeof(digits), value);
+			buffer.append(digits, ptr);
+		}
+
+		void endLine()
+		{
+			buffer += '\n';
+			if (buffer.size() >= bufferSize)
+				flush();
+		}
+
+		void flush()
+		{
+			out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+			buffer.clear();
+		}
+
+	private:
+		static size_t constexpr bufferSize = 1 << 22;
+
+		std::ofstream out;
+		std::string buffer;
+	};
+
+	// Square height field of at least triangleCount triangles, like a scanned surface every corner
+	// references a shared position, uv and normal so the importers have to deduplicate most of them
+	void writeSyntheticObj(std::filesystem::path const& path, size_t triangleCount)
+	{
+		size_t const side = static_cast<size_t>(std::ceil(std::sqrt(triangleCount / 2.0)));
+		size_t const rowSize = side + 1;
+
+		TextWriter writer(path);
+		for (size_t y = 0; y <= side; y++)
+		{
+			for (size_t x = 0; x <= side; x++)
+			{
+				float const u = static_cast<float>(x) / side;
+				float const v = static_cast<float>(y) / side;
+				float const height = 0.02f * std::sin(u * 40.0f) * std::cos(v * 30.0f);
+				writer.put("v "); writer.put(u); writer.put(" "); writer.put(height); writer.put(" "); writer.put(v); writer.endLine();
+				writer.put("vt "); writer.put(u); writer.put(" "); writer.put(v); writer.endLine();
+				glm::vec3 const normal = glm::normalize(glm::vec3(-0.8f * std::cos(u * 40.0f) * std::cos(v * 30.0f), 1.0f, 0.6f * std::sin(u * 40.0f) * std::sin(v * 30.0f)));
+				writer.put("vn "); writer.put(normal.x); writer.put(" "); writer.put(normal.y); writer.put(" "); writer.put(normal.z); writer.endLine();
+			}
+		}
+
+		auto const putCorner = [&](size_t x, size_t y)
+		{
+			size_t const index = y * rowSize + x + 1;
+			writer.put(" "); writer.put(index); writer.put("/"); writer.put(index); writer.put("/"); writer.put(index);
+		};
+		for (size_t y = 0; y < side; y++)
+		{
+			for (size_t x = 0; x < side; x++)
+			{
+				writer.put("f"); putCorner(x, y); putCorner(x, y + 1); putCorner(x + 1, y); writer.endLine();
+				writer.put("f"); putCorner(x + 1, y); putCorner(x, y + 1); putCorner(x + 1, y + 1); writer.endLine();
+			}
+		}
+	}
+
+	// Face corners of the same height field, as an importer walks them before deduplication
+	void buildSyntheticCorners(size_t triangleCount, std::vector<LoadedMesh::Vertex>& vertices, std::vector<uint32>& corners)
+	{
+		size_t const side = static_cast<size_t>(std::ceil(std::sqrt(triangleCount / 2.0)));
+		size_t const rowSize = side + 1;
+
+		vertices.clear();
+		vertices.reserve(rowSize * rowSize);
+		for (size_t y = 0; y <= side; y++)
+		{
+			for (size_t x = 0; x <= side; x++)
+			{
+				float const u = static_cast<float>(x) / side;
+				float const v = static_cast<float>(y) / side;
+				float const height = 0.02f * std::sin(u * 40.0f) * std::cos(v * 30.0f);
+				glm::vec3 const normal = glm::normalize(glm::vec3(-0.8f * std::cos(u * 40.0f) * std::cos(v * 30.0f), 1.0f, 0.6f * std::sin(u * 40.0f) * std::sin(v * 30.0f)));
+				vertices.push_back({ { u, height, v }, normal, glm::vec3(1.0f), { u, v } });
+			}
+		}
+
+		corners.clear();
+		corners.reserve(side * side * 6);
+		for (size_t y = 0; y < side; y++)
+		{
+			for (size_t x = 0; x < side; x++)
+			{
+				uint32 const i = static_cast<uint32>(y * rowSize + x);
+				uint32 const row = static_cast<uint32>(rowSize);
+				corners.insert(corners.end(), { i, i + row, i + 1, i + 1, i + row, i + row + 1 });
+			}
+		}
+	}
+
+	// removes the generated file however the benchmark ends
+	struct TemporaryFile
+	{
+		explicit TemporaryFile(std::filesystem::path path_) : path(std::move(path_))
+		{
+		}
+
+		TemporaryFile(TemporaryFile&& rhs) noexcept : path(std::move(rhs.path))
+		{
+			rhs.path.clear();
+		}
+
+		~TemporaryFile()
+		{
+			std::error_code ec;
+			if (!path.empty())
+				std::filesystem::remove(path, ec);
+		}
+
+		std::filesystem::path path;
+	};
+
+	int benchmarkObj(std::span<char const* const> args)
+	{
+		size_t const triangleCount = parseCount(args, 0, 10'000'000);
+		TemporaryFile const objFile{ std::filesystem::temp_directory_path() / "iceBenchmark.obj" };
+
+		double const writeTime = measureSeconds([&]() { writeSyntheticObj(objFile.path, triangleCount); });
+		double const fileSize = static_cast<double>(std::filesystem::file_size(objFile.path));
+		printf("[bench] generated %s: %.0f MB in %.2f s\n", objFile.path.string().c_str(), fileSize / (1 << 20), writeTime);
+
+		// tinyobj first, the parallel importer then reads a file the system already cached
+		LoadedMesh reference;
+		double const tinyobjTime = measureSeconds([&]() { reference = loadObj(objFile.path); });
+		printf("[bench] loadObj: %.2f s, %.1f MB/s, %zu triangles, %zu vertices\n",
+			tinyobjTime, fileSize / (1 << 20) / tinyobjTime, reference.indices.size() / 3, reference.vertices.size());
+
+		LoadedMesh parallel;
+		double const parallelTime = measureSeconds([&]() { parallel = loadObjParallel(objFile.path); });
+		printf("[bench] loadObjParallel: %.2f s, %.1f MB/s, %zu triangles, %zu vertices\n",
+			parallelTime, fileSize / (1 << 20) / parallelTime, parallel.indices.size() / 3, parallel.vertices.size());
+
+		bool const same = parallel.indices == reference.indices && parallel.vertices == reference.vertices;
+		printf("[bench] speedup %.2fx, meshes %s\n", tinyobjTime / parallelTime, same ? "match" : "differ");
+		return same ? 0 : 1;
+	}
+
+	int benchmarkDedup(std::span<char const* const> args)
+	{
+		size_t const triangleCount = parseCount(args, 0, 10'000'000);
+
+		std::vector<LoadedMesh::Vertex> source;
+		std::vector<uint32> corners;
+		buildSyntheticCorners(triangleCount, source, corners);
+
+		std::vector<LoadedMesh::Vertex> vertices;
+		std::vector<uint32> indices(corners.size());
+		VertexDedupTable table(vertices, corners.size());
+		double const time = measureSeconds([&]()
+		{
+			for (size_t i = 0; i < corners.size(); i++)
+				indices[i] = table.insert(source[corners[i]]);
+		});
+
+		VertexDedupTable::Stats const& stats = table.stats;
+		printf("[bench] dedup: %zu corners to %zu vertices in %.3f s, %.1f M vertices/s\n",
+			corners.size(), vertices.size(), time, stats.lookups / time * 1e-6);
+		printf("[bench] collision rate %.2f%%, %.3f extra probes per lookup\n",
+			100.0 * stats.collisions / stats.lookups, static_cast<double>(stats.extraProbes) / stats.lookups);
+
+		// vertices are appended in first use order, every corner must still find its own
+		bool same = vertices.size() == source.size();
+		for (size_t i = 0; same && i < corners.size(); i++)
+			same = vertices[indices[i]] == source[corners[i]];
+		if (!same)
+			printf("[bench] deduplication does not match the source vertices\n");
+		return same ? 0 : 1;
+	}
+
+	int benchmarkLod(std::span<char const* const> args)
+	{
+		// the given files, else the shipped assets, else generated height fields
+		std::vector<std::filesystem::path> objPaths(args.begin(), args.end());
+		std::error_code ec;
+		if (objPaths.empty() && std::filesystem::is_directory("assets", ec))
+		{
+			for (auto const& entry : std::filesystem::directory_iterator("assets"))
+			{
+				if (entry.path().extension() == ".obj")
+					objPaths.push_back(entry.path());
+			}
+		}
+
+		std::vector<TemporaryFile> generatedFiles;
+		if (objPaths.empty())
+		{
+			for (size_t const triangleCount : { 50'000, 200'000, 800'000 })
+			{
+				auto const& file = generatedFiles.emplace_back(std::filesystem::temp_directory_path() / ("iceBenchmark" + std::to_string(triangleCount) + ".obj"));
+				writeSyntheticObj(file.path, triangleCount);
+				objPaths.push_back(file.path);
+			}
+		}
+
+		// same preparation as an import, levels are simplified from the optimized and clustered first level
+		std::vector<LoadedMesh> meshes;
+		for (auto const& objPath : objPaths)
+		{
+			LoadedMesh& mesh = meshes.emplace_back(loadObjParallel(objPath));
+			optimizeMesh(mesh);
+			buildMeshlets(mesh);
+		}
+
+		double const time = measureSeconds([&]() { generateLods(meshes); });
+		
+		size_t triangleCount = 0;
+		for (auto const& mesh : meshes)
+			triangleCount += mesh.lods[0].indexCount / 3;
+		printf("[bench] generateLods: %zu meshes, %zu triangles in %.3f s, %.1f M triangles/s\n",
+			meshes.size(), triangleCount, time, triangleCount / time * 1e-6);
+
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			printf("[bench] %s\n", objPaths[i].string().c_str());
+			for (size_t lod = 0; lod < meshes[i].lods.size(); lod++)
+			{
+				MeshLod const& level = meshes[i].lods[lod];
+				printf("[bench]   lod %zu: %u triangles, error %g\n", lod, level.indexCount / 3, level.error);
+			}
+		}
+		return 0;
+	}
+}
+
+int runBenchmark(std::span<char const* const> args)
+{
+	struct Benchmark
+	{
+		char const* name;
+		int (*run)(std::span<char const* const> args);
+	};
+	static Benchmark constexpr benchmarks[] = {
+		{ "obj", benchmarkObj },
+		{ "dedup", benchmarkDedup },
+		{ "lod", benchmarkLod },
+	};
+
+	try
+	{
+		for (auto const& benchmark : benchmarks)
+		{
+			if (!args.empty() && strcmp(args[0], benchmark.name) == 0)
+				return benchmark.run(args.subspan(1));
+		}
+	}
+	catch (std::exception const& e)
+	{
+		printf("[bench] %s\n", e.what());
+		return 1;
+	}
+
+	printf("[bench] usage: --bench <benchmark> [arguments], benchmarks:");
+	for (auto const& benchmark : benchmarks)
+		printf(" %s", benchmark.name);
+	printf("\n");
+	return 1;
+}
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <span>
+
+// Command line benchmarks of the import pipeline, run with IceRenderer --bench <name> [arguments]
+//   obj [triangles]    synthetic OBJ (10M triangles by default) imported by loadObj and loadObjParallel
+//   dedup [triangles]  collision rate and throughput of VertexDedupTable on the corners of the same surface
+//   lod [obj files]    generateLods on the files, assets/*.obj or generated height fields by default
+// Return the process exit code
+int runBenchmark(std::span<char const* const> args);
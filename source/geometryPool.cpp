@@ -0,0 +1,214 @@
+#include "geometryPool.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <stdexcept>
+
+#include "vkhDeviceContext.hpp"
+
+namespace
+{
+	// returns the ranges of a freed allocation when the deletion queue destroys it
+	class RangeRelease
+	{
+	public:
+		RangeRelease(std::shared_ptr<GeometryRanges> ranges_, GeometryAllocation const& allocation) :
+			ranges(std::move(ranges_)), firstVertex(allocation.firstVertex), vertexCount(allocation.vertexCount), firstIndex(allocation.firstIndex), indexCount(allocation.indexCount)
+		{
+		}
+		RangeRelease(RangeRelease&&) noexcept = default;
+
+		~RangeRelease()
+		{
+			if (!ranges)
+				return;
+			ranges->vertices.free(firstVertex, std::max(vertexCount, 1u));
+			ranges->indices.free(firstIndex, std::max(indexCount, 1u));
+		}
+
+	private:
+		std::shared_ptr<GeometryRanges> ranges;
+		uint32 firstVertex, vertexCount;
+		uint32 firstIndex, indexCount;
+	};
+}
+
+RangeAllocator::RangeAllocator(uint32 capacity)
+{
+	if (capacity > 0)
+		freeRanges.emplace(0, capacity);
+}
+
+std::optional<uint32> RangeAllocator::allocate(uint32 count)
+{
+	assert(count > 0);
+
+	for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it)
+	{
+		if (it->second < count)
+			continue;
+
+		uint32 const offset = it->first;
+		uint32 const remaining = it->second - count;
+		freeRanges.erase(it);
+		if (remaining > 0)
+			freeRanges.emplace(offset + count, remaining);
+		return offset;
+	}
+
+	return std::nullopt;
+}
+
+void RangeAllocator::free(uint32 offset, uint32 count)
+{
+	assert(count > 0);
+
+	auto next = freeRanges.lower_bound(offset);
+	assert(next == freeRanges.end() || offset + count <= next->first);
+
+	if (next != freeRanges.begin())
+	{
+		auto const prev = std::prev(next);
+		assert(prev->first + prev->second <= offset);
+		if (prev->first + prev->second == offset)
+		{
+			offset = prev->first;
+			count += prev->second;
+			freeRanges.erase(prev);
+		}
+	}
+
+	if (next != freeRanges.end() && offset + count == next->first)
+	{
+		count += next->second;
+		freeRanges.erase(next);
+	}
+
+	freeRanges.emplace(offset, count);
+}
+
+uint32 RangeAllocator::getFreeCount() const noexcept
+{
+	uint32 count = 0;
+	for (auto const& [offset, rangeCount] : freeRanges)
+		count += rangeCount;
+	return count;
+}
+
+GeometryAllocation::GeometryAllocation(GeometryAllocation&& rhs) noexcept :
+	pool(rhs.pool), firstVertex(rhs.firstVertex), vertexCount(rhs.vertexCount), firstIndex(rhs.firstIndex), indexCount(rhs.indexCount)
+{
+	rhs.pool = nullptr;
+}
+
+GeometryAllocation& GeometryAllocation::operator=(GeometryAllocation&& rhs) noexcept
+{
+	release();
+	pool = rhs.pool;
+	firstVertex = rhs.firstVertex;
+	vertexCount = rhs.vertexCount;
+	firstIndex = rhs.firstIndex;
+	indexCount = rhs.indexCount;
+	rhs.pool = nullptr;
+	return *this;
+}
+
+GeometryAllocation::~GeometryAllocation()
+{
+	release();
+}
+
+void GeometryAllocation::release()
+{
+	if (pool)
+		pool->free(*this);
+}
+
+void GeometryPool::create(vkh::DeviceContext& ctx, CreateInfo const& info)
+{
+	deviceContext = &ctx;
+	encoding = info.encoding;
+	indexType = info.indexType;
+	vertexStride = getVertexStride(encoding);
+	indexSize = indexType == vk::IndexType::eUint16 ? sizeof(uint16) : sizeof(uint32);
+
+	{
+		vk::BufferCreateInfo vertexBufferInfo;
+		vertexBufferInfo.usage = vk::BufferUsageFlagBits::eVertexBuffer;
+		vertexBufferInfo.size = static_cast<vk::DeviceSize>(info.vertexCapacity) * vertexStride;
+		vertexBufferInfo.sharingMode = vk::SharingMode::eExclusive;
+
+		vertexBuffer.create(ctx, vertexBufferInfo, vkh::BufferLocation::DeviceLocal);
+	}
+	{
+		vk::BufferCreateInfo indexBufferInfo;
+		indexBufferInfo.usage = vk::BufferUsageFlagBits::eIndexBuffer;
+		indexBufferInfo.size = static_cast<vk::DeviceSize>(info.indexCapacity) * indexSize;
+		indexBufferInfo.sharingMode = vk::SharingMode::eExclusive;
+
+		indexBuffer.create(ctx, indexBufferInfo, vkh::BufferLocation::DeviceLocal);
+	}
+
+	ranges = std::make_shared<GeometryRanges>();
+	ranges->vertices = RangeAllocator(info.vertexCapacity);
+	ranges->indices = RangeAllocator(info.indexCapacity);
+}
+
+void GeometryPool::destroy()
+{
+	vertexBuffer.destroy();
+	indexBuffer.destroy();
+	// pending releases keep the ranges alive
+	ranges.reset();
+}
+
+GeometryAllocation GeometryPool::allocate(std::span<uint8 const> vertexData, std::span<uint8 const> indexData)
+{
+	assert(vertexData.size() % vertexStride == 0 && indexData.size() % indexSize == 0);
+
+	GeometryAllocation allocation;
+	allocation.vertexCount = static_cast<uint32>(vertexData.size() / vertexStride);
+	allocation.indexCount = static_cast<uint32>(indexData.size() / indexSize);
+
+	// empty ranges still get an offset so the allocation can be freed like any other
+	auto const firstVertex = ranges->vertices.allocate(std::max(allocation.vertexCount, 1u));
+	if (!firstVertex)
+		throw std::runtime_error("geometry pool is out of vertex space");
+
+	auto const firstIndex = ranges->indices.allocate(std::max(allocation.indexCount, 1u));
+	if (!firstIndex)
+	{
+		// never uploaded, nothing can draw from it
+		ranges->vertices.free(*firstVertex, std::max(allocation.vertexCount, 1u));
+		throw std::runtime_error("geometry pool is out of index space");
+	}
+
+	allocation.pool = this;
+	allocation.firstVertex = *firstVertex;
+	allocation.firstIndex = *firstIndex;
+
+	if (!vertexData.empty())
+		vertexBuffer.upload(vertexData, static_cast<vk::DeviceSize>(allocation.firstVertex) * vertexStride);
+	if (!indexData.empty())
+		indexBuffer.upload(indexData, static_cast<vk::DeviceSize>(allocation.firstIndex) * indexSize);
+
+	return allocation;
+}
+
+void GeometryPool::free(GeometryAllocation& allocation)
+{
+	assert(allocation.pool == this);
+
+	deviceContext->deletionQueue.push(RangeRelease(ranges, allocation));
+	allocation.pool = nullptr;
+}
+
+void GeometryPool::bind(vk::CommandBuffer cmdBuff) const
+{
+	vk::DeviceSize offsets[] = { 0 };
+	vk::Buffer vertexBuffers[] = { vertexBuffer.buffer };
+
+	cmdBuff.bindVertexBuffers(0, 1, vertexBuffers, offsets);
+	cmdBuff.bindIndexBuffer(indexBuffer.buffer, 0, indexType);
+}
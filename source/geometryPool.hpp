@@ -0,0 +1,104 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vulkan/vulkan.hpp>
+
+#include "ice.hpp"
+#include "vertexEncoding.hpp"
+#include "vkhBuffer.hpp"
+
+namespace vkh {
+	struct DeviceContext;
+}
+
+class GeometryPool;
+
+// First fit free list over [0, capacity), adjacent free ranges are merged back when released
+class RangeAllocator
+{
+public:
+	RangeAllocator() = default;
+	explicit RangeAllocator(uint32 capacity);
+
+	[[nodiscard]] std::optional<uint32> allocate(uint32 count);
+	void free(uint32 offset, uint32 count);
+
+	[[nodiscard]] uint32 getFreeCount() const noexcept;
+
+private:
+	// offset -> count
+	std::map<uint32, uint32> freeRanges;
+};
+
+// Free ranges of a GeometryPool, shared with the releases waiting in the deletion queue which may outlive the pool
+struct GeometryRanges
+{
+	RangeAllocator vertices;
+	RangeAllocator indices;
+};
+
+// Vertices and indices of a mesh in a GeometryPool, released on destruction once the frames drawing them completed
+struct GeometryAllocation
+{
+	GeometryAllocation() = default;
+	GeometryAllocation(GeometryAllocation&&) noexcept;
+	GeometryAllocation& operator=(GeometryAllocation&&) noexcept;
+	~GeometryAllocation();
+
+	ICE_NON_COPYABLE_CLASS(GeometryAllocation)
+
+	void release();
+
+	GeometryPool* pool = nullptr;
+	uint32 firstVertex = 0;
+	uint32 vertexCount = 0;
+	// in pool indices, added to firstIndex of draws
+	uint32 firstIndex = 0;
+	uint32 indexCount = 0;
+};
+
+// One large vertex buffer and one large index buffer shared by many meshes
+// Meshes only store offsets in it, so a whole scene is drawn with a single bind and firstIndex/vertexOffset per draw.
+class GeometryPool
+{
+public:
+	struct CreateInfo
+	{
+		uint32 vertexCapacity;
+		uint32 indexCapacity;
+		// every mesh of the pool uses the same vertex layout
+		VertexEncoding encoding = VertexEncoding::Float32;
+		// with 16 bit indices large meshes are split in ranges, see buildIndexStream
+		// meshes with a triangle spanning 65536 vertices or more cannot be split and are rejected, use eUint32 for them
+		vk::IndexType indexType = vk::IndexType::eUint16;
+	};
+
+	GeometryPool() = default;
+	ICE_NON_DISPATCHABLE_CLASS(GeometryPool)
+
+	void create(vkh::DeviceContext& ctx, CreateInfo const& info);
+	void destroy();
+
+	// upload encoded vertices and indices of indexType, throw if the pool is full
+	[[nodiscard]] GeometryAllocation allocate(std::span<uint8 const> vertexData, std::span<uint8 const> indexData);
+	// the ranges go through the deletion queue, frames in flight may still draw from them
+	void free(GeometryAllocation& allocation);
+
+	// bind once before drawing meshes of the pool
+	void bind(vk::CommandBuffer cmdBuff) const;
+
+	VertexEncoding encoding;
+	vk::IndexType indexType;
+	uint32 vertexStride;
+	uint32 indexSize;
+
+	vkh::Buffer vertexBuffer;
+	vkh::Buffer indexBuffer;
+
+private:
+	vkh::DeviceContext* deviceContext = nullptr;
+	std::shared_ptr<GeometryRanges> ranges;
+};
@@ -1,8 +1,9 @@
+#include <cstring>
 #include <GLFW/glfw3.h>
 
-#include <stb/stb_image.h>
-
 #include "vulkanContext.hpp"
+#include "assetStreamer.hpp"
+#include "benchmark.hpp"
 #include "mesh.hpp"
 #include "material.hpp"
 #include "GUILayer.hpp"
@@ -17,8 +18,12 @@ static void framebufferResizeCallback(GLFWwindow* window, int width, int height)
 	vkContext.resized = true;
 }
 
-int main()
+int main(int argc, char** argv)
 {
+	// benchmarks run without window nor device
+	if (argc > 1 && strcmp(argv[1], "--bench") == 0)
+		return runBenchmark({ argv + 2, static_cast<size_t>(argc - 2) });
+	
 	glfwInit();
 	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
 	GLFWwindow* window = glfwCreateWindow(800, 600, "Vulkan window", nullptr, nullptr);
@@ -34,48 +39,15 @@ int main()
 		gui.handleSwapchainRecreation(context);
 	};
 
-	Mesh mesh(context.deviceContext, loadObj("assets/cube.obj"));
-
-	int texWidth, texHeight, texChannels;
-	stbi_uc* pixels = stbi_load("assets/texture.jpg", &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-
-	if (!pixels)
-		throw std::runtime_error("failed to load texture image!");
+	AssetStreamer streamer;
+	streamer.create(context.deviceContext);
 	
-	vk::DeviceSize const imageSize = texWidth * texHeight * 4;
-
-	vkh::Texture text;
-	vkh::Texture::CreateInfo textureInfo;
-	textureInfo.format = vk::Format::eR8G8B8A8Srgb;
-	textureInfo.tiling = vk::ImageTiling::eOptimal;
-	textureInfo.mipLevels = 1; // static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
-	textureInfo.data = std::span(pixels, imageSize);
-	textureInfo.width = texWidth;
-	textureInfo.height = texHeight;
-	text.create(context.deviceContext, textureInfo);
-	text.image.transitionLayout(vk::ImageLayout::eShaderReadOnlyOptimal);
-
-	stbi_image_free(pixels);
-
-	pixels = stbi_load("assets/grass.png", &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
-
-	if (!pixels)
-		throw std::runtime_error("failed to load texture image!");
-
-	vk::DeviceSize const imageSize2 = texWidth * texHeight * 4;
-
-	vkh::Texture text2;
-	vkh::Texture::CreateInfo textureInfo2;
-	textureInfo2.format = vk::Format::eR8G8B8A8Srgb;
-	textureInfo2.tiling = vk::ImageTiling::eOptimal;
-	textureInfo2.mipLevels = 1; // static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
-	textureInfo2.data = std::span(pixels, imageSize2);
-	textureInfo2.width = texWidth;
-	textureInfo2.height = texHeight;
-	text2.create(context.deviceContext, textureInfo2);
-	text2.image.transitionLayout(vk::ImageLayout::eShaderReadOnlyOptimal);
-
-	stbi_image_free(pixels);
+	MeshHandle const meshHandle = streamer.loadMesh("assets/cube.obj");
+	std::filesystem::path const texturePaths[] = { "assets/texture.jpg", "assets/grass.png" };
+	// only the low mips are loaded up front, finer ones follow the distance to the mesh
+	std::vector<TextureHandle> textureHandles;
+	for (auto const& texturePath : texturePaths)
+		textureHandles.push_back(streamer.streamTexture(texturePath, vk::Format::eBc7SrgbBlock));
 	
 	struct FrameConstants
 	{
@@ -87,91 +59,66 @@ int main()
 	frameConstants.proj = glm::perspective(glm::radians(60.0f), 800.0f / 600.0f, 0.1f, 10.0f);
 	frameConstants.proj[1][1] *= -1;
 
-	vkh::Buffer frameConstantsBuffer;
-	{
-		vma::AllocationCreateInfo allocInfo;
-		allocInfo.usage = vma::MemoryUsage::eCpuToGpu;
-		vk::BufferCreateInfo bufferCreateInfo;
-		bufferCreateInfo.usage = vk::BufferUsageFlagBits::eUniformBuffer;
-		bufferCreateInfo.size = sizeof(FrameConstants);
-		bufferCreateInfo.sharingMode = vk::SharingMode::eExclusive;
-		frameConstantsBuffer.create(context.deviceContext, bufferCreateInfo, allocInfo);
-		frameConstantsBuffer.writeStruct(frameConstants);
-	}
-
-	auto frameSets = context.defaultPipeline.createDescriptorSets(*context.descriptorPool, vkh::PipelineConstants, context.maxFramesInFlight);
+	// transient uniforms live in the frame ring buffer, sets are written once and selected with dynamic offsets
+	vk::DescriptorSet const frameSet = context.defaultPipeline.createDescriptorSets(*context.descriptorPool, vkh::PipelineConstants, 1)[0];
+	vk::DescriptorSet const modelSet = context.defaultPipeline.createDescriptorSets(*context.descriptorPool, vkh::DrawCall, 1)[0];
 	auto textureSets = context.defaultPipeline.createDescriptorSets(*context.descriptorPool, vkh::Textures, context.maxFramesInFlight);
-	auto modelSets = context.defaultPipeline.createDescriptorSets(*context.descriptorPool, vkh::DrawCall, context.maxFramesInFlight);
-
-	for (auto& set : modelSets)
 	{
-		vk::DescriptorBufferInfo bufferInfo{};
-		bufferInfo.buffer = mesh.modelBuffer.buffer;
-		bufferInfo.offset = 0;
-		bufferInfo.range = sizeof(glm::mat4);
+		vk::DescriptorBufferInfo bufferInfos[2];
+		bufferInfos[0] = context.frameRingBuffer.getDescriptorInfo(sizeof(FrameConstants));
+		bufferInfos[1] = context.frameRingBuffer.getDescriptorInfo(sizeof(glm::mat4));
 
-		vk::WriteDescriptorSet descriptorWrites[1];
-		descriptorWrites[0].dstSet = set;
+		vk::WriteDescriptorSet descriptorWrites[2];
+		descriptorWrites[0].dstSet = frameSet;
 		descriptorWrites[0].dstBinding = 0;
 		descriptorWrites[0].dstArrayElement = 0;
-		descriptorWrites[0].descriptorType = vk::DescriptorType::eUniformBuffer;
+		descriptorWrites[0].descriptorType = vk::DescriptorType::eUniformBufferDynamic;
 		descriptorWrites[0].descriptorCount = 1;
-		descriptorWrites[0].pBufferInfo = &bufferInfo;
+		descriptorWrites[0].pBufferInfo = &bufferInfos[0];
+
+		descriptorWrites[1].dstSet = modelSet;
+		descriptorWrites[1].dstBinding = 0;
+		descriptorWrites[1].dstArrayElement = 0;
+		descriptorWrites[1].descriptorType = vk::DescriptorType::eUniformBufferDynamic;
+		descriptorWrites[1].descriptorCount = 1;
+		descriptorWrites[1].pBufferInfo = &bufferInfos[1];
 
 		context.deviceContext.device.updateDescriptorSets(std::size(descriptorWrites), descriptorWrites, 0, nullptr);
 	}
 
 	size_t constexpr maxTextures = 64;
 
-	vk::DescriptorImageInfo imageInfo{};
-	imageInfo.sampler = *text.sampler;
-	imageInfo.imageView = *text.imageView;
-	imageInfo.imageLayout = text.image.getLayout();
-
-	vk::DescriptorImageInfo imageInfo2{};
-	imageInfo2.sampler = *text2.sampler;
-	imageInfo2.imageView = *text2.imageView;
-	imageInfo2.imageLayout = text2.image.getLayout();
-	
-	std::vector<vk::DescriptorImageInfo> imageInfos(maxTextures, imageInfo);
-	imageInfos[1] = imageInfo2;
-	
-	for (auto& set : textureSets)
+	// placeholders are bound until assets are loaded, sets are rewritten once their frame is not in flight anymore
+	auto const writeAssetDescriptors = [&](uint32 frame)
 	{
-		vk::WriteDescriptorSet descriptorWrites[1];
-		descriptorWrites[0].dstSet = set;
-		descriptorWrites[0].dstBinding = 0;
-		descriptorWrites[0].dstArrayElement = 0;
-		descriptorWrites[0].descriptorType = vk::DescriptorType::eCombinedImageSampler;
-		descriptorWrites[0].descriptorCount = imageInfos.size();
-		descriptorWrites[0].pImageInfo = imageInfos.data();
-
-		context.deviceContext.device.updateDescriptorSets(std::size(descriptorWrites), descriptorWrites, 0, nullptr);
-	}
+		std::vector<vk::DescriptorImageInfo> imageInfos(maxTextures);
+		for (size_t i = 0; i < maxTextures; i++)
+		{
+			vkh::Texture& texture = streamer.getTexture(textureHandles[i < textureHandles.size() ? i : 0]);
+			imageInfos[i].sampler = *texture.sampler;
+			imageInfos[i].imageView = *texture.imageView;
+			imageInfos[i].imageLayout = texture.image.getLayout();
+		}
+
+		vk::WriteDescriptorSet descriptorWrite;
+		descriptorWrite.dstSet = textureSets[frame];
+		descriptorWrite.dstBinding = 0;
+		descriptorWrite.dstArrayElement = 0;
+		descriptorWrite.descriptorType = vk::DescriptorType::eCombinedImageSampler;
+		descriptorWrite.descriptorCount = imageInfos.size();
+		descriptorWrite.pImageInfo = imageInfos.data();
+
+		context.deviceContext.device.updateDescriptorSets(1, &descriptorWrite, 0, nullptr);
+	};
 	
-	for (auto& set : frameSets)	
-	{
-		vk::DescriptorBufferInfo bufferInfo{};
-		bufferInfo.buffer = frameConstantsBuffer.buffer;
-		bufferInfo.offset = 0;
-		bufferInfo.range = sizeof(FrameConstants);
-
-		vk::WriteDescriptorSet descriptorWrites[1];
-		descriptorWrites[0].dstSet = set;
-		descriptorWrites[0].dstBinding = 0;
-		descriptorWrites[0].dstArrayElement = 0;
-		descriptorWrites[0].descriptorType = vk::DescriptorType::eUniformBuffer;
-		descriptorWrites[0].descriptorCount = 1;
-		descriptorWrites[0].pBufferInfo = &bufferInfo;
-
-		context.deviceContext.device.updateDescriptorSets(std::size(descriptorWrites), descriptorWrites, 0, nullptr);
-	}
+	std::vector<bool> staleAssetDescriptors(context.maxFramesInFlight, false);
+	for (uint32 frame = 0; frame < context.maxFramesInFlight; frame++)
+		writeAssetDescriptors(frame);
 
 	Material mtrl;
 	mtrl.create(context.deviceContext, context.defaultPipeline);
-	mtrl.descriptorSets = context.defaultPipeline.createDescriptorSets(*context.descriptorPool, vkh::Material, context.maxFramesInFlight);
-	mtrl.updateBuffer();
-	mtrl.updateDescriptorSets();
+	mtrl.descriptorSet = context.defaultPipeline.createDescriptorSets(*context.descriptorPool, vkh::Material, 1)[0];
+	mtrl.updateDescriptorSets(context.frameRingBuffer);
 	
 	vk::ClearValue clearsValues[2];
 	clearsValues[0].color = vk::ClearColorValue{ std::array<float, 4>{0.0f, 0.0f, 0.0f, 1.0f} };
@@ -184,13 +131,36 @@ int main()
 		if (!context.startFrame())
 			continue;
 		
+		if (streamer.update() > 0)
+			std::fill(staleAssetDescriptors.begin(), staleAssetDescriptors.end(), true);
+		if (staleAssetDescriptors[context.currentFrame])
+		{
+			writeAssetDescriptors(context.currentFrame);
+			staleAssetDescriptors[context.currentFrame] = false;
+		}
+		
 		gui.startFrame();
 		auto cmdBuffer = context.commandBuffers.begin(context.currentFrame);
 
 		ImGui::ColorEdit3("ClearValue", (float*)&clearsValues[0].color, ImGuiColorEditFlags_PickerHueWheel);
 
 		mtrl.imguiEditor();
-		mtrl.updateBuffer();
+
+		Mesh& mesh = streamer.getMesh(meshHandle);
+
+		// the UVs of the mesh span its bounds once, the density is estimated at the nearest point of its bounding sphere
+		{
+			glm::vec3 const extent = mesh.bounds.aabbMax - mesh.bounds.aabbMin;
+			float const uvWorldSize = std::max({ extent.x, extent.y, extent.z });
+			glm::vec4 const viewCenter = frameConstants.view * mesh.modelMatrix * glm::vec4(mesh.bounds.sphereCenter, 1.0f);
+			float const distance = -viewCenter.z - mesh.bounds.sphereRadius;
+			float const projectionScale = std::abs(frameConstants.proj[1][1]) * context.swapchain.extent.height * 0.5f;
+			for (TextureHandle const handle : textureHandles)
+				streamer.requestTexelDensity(handle, uvWorldSize, distance, projectionScale);
+		}
+		uint32 const frameOffset = context.frameRingBuffer.push(frameConstants);
+		uint32 const modelOffset = context.frameRingBuffer.push(mesh.modelMatrix);
+		mtrl.updateBuffer(context.frameRingBuffer);
 
 		vk::RenderPassBeginInfo renderPassInfo{};
 		renderPassInfo.renderPass = *context.defaultRenderPass;
@@ -200,20 +170,30 @@ int main()
 		renderPassInfo.clearValueCount = std::size(clearsValues);
 		renderPassInfo.pClearValues = clearsValues;
 		
-		cmdBuffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eInline);
-		
-			cmdBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, *context.defaultPipeline.pipeline);
-
-			vk::DescriptorSet sets0[] = { frameSets[context.currentFrame] };
-			vk::DescriptorSet sets1[] = { textureSets[context.currentFrame] };
-			vk::DescriptorSet sets2[] = { mtrl.descriptorSets[context.currentFrame] };
-			vk::DescriptorSet sets3[] = { modelSets[context.currentFrame] };
-		
-			cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *context.defaultPipeline.pipelineLayout, 0, std::size(sets0), sets0, 0, nullptr);
-			cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *context.defaultPipeline.pipelineLayout, 1, std::size(sets1), sets1, 0, nullptr);
-			cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *context.defaultPipeline.pipelineLayout, 2, std::size(sets2), sets2, 0, nullptr);
-			cmdBuffer.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *context.defaultPipeline.pipelineLayout, 3, std::size(sets3), sets3, 0, nullptr);
-			mesh.draw(cmdBuffer, context.currentFrame);
+		cmdBuffer.beginRenderPass(renderPassInfo, vk::SubpassContents::eSecondaryCommandBuffers);
+
+			vk::CommandBufferInheritanceInfo inheritanceInfo;
+			inheritanceInfo.renderPass = *context.defaultRenderPass;
+			inheritanceInfo.subpass = 0;
+			inheritanceInfo.framebuffer = *context.framebuffers[context.currentFrame];
+
+			Mesh* const drawList[] = { &mesh };
+			uint32 const modelOffsets[] = { modelOffset };
+			vk::DescriptorSet const sets1[] = { textureSets[context.currentFrame] };
+
+			context.parallelRecorder.record(cmdBuffer, context.currentFrame, inheritanceInfo, std::size(drawList), [&](vk::CommandBuffer secondary, uint32 first, uint32 count)
+			{
+				// secondary command buffers inherit no state, each slice binds everything
+				secondary.bindPipeline(vk::PipelineBindPoint::eGraphics, *context.defaultPipeline.pipeline);
+				secondary.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *context.defaultPipeline.pipelineLayout, vkh::PipelineConstants, 1, &frameSet, 1, &frameOffset);
+				secondary.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *context.defaultPipeline.pipelineLayout, vkh::Textures, std::size(sets1), sets1, 0, nullptr);
+				mtrl.bind(secondary);
+				for (uint32 i = first; i < first + count; i++)
+				{
+					secondary.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, *context.defaultPipeline.pipelineLayout, vkh::DrawCall, 1, &modelSet, 1, &modelOffsets[i]);
+					drawList[i]->draw(secondary, context.currentFrame);
+				}
+			});
 
 		cmdBuffer.endRenderPass();
 		
@@ -225,6 +205,7 @@ int main()
 	
 	// wait idle before destroying gui
 	context.deviceContext.device.waitIdle();
+	streamer.destroy();
 	gui.destroy();
 	glfwTerminate();
 	return 0;
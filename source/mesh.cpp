@@ -1,14 +1,108 @@
 #include "mesh.hpp"
 
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
 #include <tiny/tiny_obj_loader.h>
 
+#include "Material.hpp"
+#include "meshBounds.hpp"
 #include "utility.hpp"
 #include "vkhDeviceContext.hpp"
 
+static size_t nextPowerOfTwo(size_t n)
+{
+	size_t p = 1;
+	while (p < n)
+		p <<= 1;
+	return p;
+}
+
+// -0 becomes +0 and every NaN the same quiet NaN, so equal values are equal bytes
+static LoadedMesh::Vertex canonicalize(LoadedMesh::Vertex vertex)
+{
+	static_assert(sizeof(LoadedMesh::Vertex) % sizeof(float) == 0, "vertices are made of floats only");
+	float* const components = reinterpret_cast<float*>(&vertex);
+	for (size_t i = 0; i < sizeof(vertex) / sizeof(float); i++)
+	{
+		if (components[i] == 0.0f)
+			components[i] = 0.0f;
+		else if (std::isnan(components[i]))
+			components[i] = std::numeric_limits<float>::quiet_NaN();
+	}
+	return vertex;
+}
+
+VertexDedupTable::VertexDedupTable(std::vector<LoadedMesh::Vertex>& vertices_, size_t expectedCount) : vertices(vertices_)
+{
+	// keep the load factor under 3/4 even if every vertex is unique
+	slots.resize(nextPowerOfTwo(std::max<size_t>(expectedCount + expectedCount / 3, 16)), Slot{ emptySlot, 0 });
+	mask = slots.size() - 1;
+	vertices.reserve(vertices.size() + expectedCount);
+}
+
+uint32 VertexDedupTable::insert(LoadedMesh::Vertex const& vertex_)
+{
+	LoadedMesh::Vertex const vertex = canonicalize(vertex_);
+	uint64 const hash = hashBytes(&vertex, sizeof(vertex));
+	uint32 const tag = static_cast<uint32>(hash >> 32);
+	stats.lookups++;
+
+	size_t probes = 0;
+	for (size_t i = hash & mask;; i = (i + 1) & mask, probes++)
+	{
+		Slot& slot = slots[i];
+		if (slot.index == emptySlot)
+		{
+			if (probes > 0)
+				stats.collisions++;
+			stats.extraProbes += probes;
+			
+			uint32 const index = static_cast<uint32>(vertices.size());
+			slot = { index, tag };
+			vertices.push_back(vertex);
+
+			if (vertices.size() * 4 > slots.size() * 3)
+				grow();
+			return index;
+		}
+		
+		if (slot.hashTag == tag && memcmp(&vertices[slot.index], &vertex, sizeof(vertex)) == 0)
+		{
+			if (probes > 0)
+				stats.collisions++;
+			stats.extraProbes += probes;
+			return slot.index;
+		}
+	}
+}
+
+void VertexDedupTable::grow()
+{
+	std::vector<Slot> oldSlots(slots.size() * 2, Slot{ emptySlot, 0 });
+	std::swap(slots, oldSlots);
+	mask = slots.size() - 1;
+
+	for (Slot const& slot : oldSlots)
+	{
+		if (slot.index == emptySlot)
+			continue;
+		
+		size_t i = hashBytes(&vertices[slot.index], sizeof(LoadedMesh::Vertex)) & mask;
+		while (slots[i].index != emptySlot)
+			i = (i + 1) & mask;
+		slots[i] = slot;
+	}
+}
+
 LoadedMesh loadObj(std::filesystem::path const& objPath)
 {
 	tinyobj::ObjReaderConfig reader_config;
-	reader_config.mtl_search_path = "./"; // Path to material files
+	// material files are relative to the obj
+	reader_config.mtl_search_path = objPath.parent_path().string() + "/";
 	tinyobj::ObjReader reader;
 	
 	if (!reader.ParseFromFile(objPath.string(), reader_config)) 
@@ -22,8 +116,15 @@ LoadedMesh loadObj(std::filesystem::path const& objPath)
 	auto const& shapes = reader.GetShapes();
 	auto const& materials = reader.GetMaterials();
 	
-	std::unordered_map<LoadedMesh::Vertex, uint32> uniqueVertices = {};
+	size_t indexCount = 0;
+	for (auto const& shape : shapes)
+		indexCount += shape.mesh.indices.size();
+	
 	LoadedMesh loadedMesh;
+	loadedMesh.indices.reserve(indexCount);
+	VertexDedupTable uniqueVertices(loadedMesh.vertices, indexCount);
+	std::vector<uint32> triangleMaterials;
+	triangleMaterials.reserve(indexCount / 3);
 	// Loop over shapes
 	for (size_t s = 0; s < shapes.size(); s++)
 	{
@@ -77,71 +178,292 @@ LoadedMesh loadObj(std::filesystem::path const& objPath)
 				vertex.color.g = green;
 				vertex.color.b = blue;
 				
-				if (uniqueVertices.count(vertex) == 0) {
-					uniqueVertices[vertex] = static_cast<uint32>(loadedMesh.vertices.size());
-					loadedMesh.vertices.push_back(vertex);
-				}
-				loadedMesh.indices.push_back(uniqueVertices[vertex]);
+				loadedMesh.indices.push_back(uniqueVertices.insert(vertex));
 			}
 			
 			index_offset += fv;
 
-			// per-face material
-			shapes[s].mesh.material_ids[f];
+			// per-face material, faces are triangulated by tinyobj
+			triangleMaterials.push_back(static_cast<uint32>(shapes[s].mesh.material_ids[f]));
 		}
 	}
+
+	sortByMaterial(loadedMesh, triangleMaterials);
+	computeMeshBounds(loadedMesh);
 	return loadedMesh;
 }
 
-Mesh::Mesh(vkh::DeviceContext& ctx, LoadedMesh const& mesh)
+std::vector<Submesh> getBaseSubmeshes(LoadedMesh const& mesh)
 {
+	if (mesh.submeshes.empty())
+	{
+		uint32 const indexCount = static_cast<uint32>(mesh.lods.empty() ? mesh.indices.size() : mesh.lods[0].indexCount);
+		return { { 0, indexCount, Submesh::noMaterial, mesh.bounds } };
+	}
+	
+	auto const base = getLodSubmeshes(mesh.submeshes, mesh.lods.size(), 0);
+	return { base.begin(), base.end() };
+}
+
+std::span<Submesh const> getLodSubmeshes(std::span<Submesh const> submeshes, size_t lodCount, uint32 lod)
+{
+	size_t const perLod = submeshes.size() / std::max<size_t>(lodCount, 1);
+	return submeshes.subspan(lod * perLod, perLod);
+}
+
+void sortByMaterial(LoadedMesh& mesh, std::span<uint32 const> triangleMaterials)
+{
+	assert(triangleMaterials.size() * 3 == mesh.indices.size());
+	
+	std::vector<uint32> materialIds(triangleMaterials.begin(), triangleMaterials.end());
+	std::sort(materialIds.begin(), materialIds.end());
+	materialIds.erase(std::unique(materialIds.begin(), materialIds.end()), materialIds.end());
+
+	// counting sort, keeps the triangle order inside a material
+	std::vector<uint32> offsets(materialIds.size() + 1, 0);
+	std::vector<uint32> buckets(triangleMaterials.size());
+	for (size_t t = 0; t < triangleMaterials.size(); t++)
+	{
+		buckets[t] = static_cast<uint32>(std::lower_bound(materialIds.begin(), materialIds.end(), triangleMaterials[t]) - materialIds.begin());
+		offsets[buckets[t] + 1] += 3;
+	}
+	for (size_t m = 0; m < materialIds.size(); m++)
+		offsets[m + 1] += offsets[m];
+
+	mesh.submeshes.clear();
+	for (size_t m = 0; m < materialIds.size(); m++)
+		mesh.submeshes.push_back({ offsets[m], offsets[m + 1] - offsets[m], materialIds[m], {} });
+
+	if (materialIds.size() <= 1)
+		return;
+	
+	std::vector<uint32> sorted(mesh.indices.size());
+	for (size_t t = 0; t < triangleMaterials.size(); t++)
+	{
+		uint32& offset = offsets[buckets[t]];
+		std::copy_n(&mesh.indices[t * 3], 3, &sorted[offset]);
+		offset += 3;
+	}
+	mesh.indices = std::move(sorted);
+}
+
+IndexStream buildIndexStream(std::span<uint32 const> indices, size_t vertexCount, std::optional<vk::IndexType> forcedType)
+{
+	uint32 constexpr maxRangeVertices = 1u << 16;
+	// a split is not worth it when the ranges get smaller than this
+	uint32 constexpr minAverageRangeIndices = 1u << 15;
+
+	IndexStream stream;
+	uint32 const indexCount = static_cast<uint32>(indices.size());
+
+	auto const keepUint32 = [&]()
+	{
+		auto const bytes = toByteSpan(indices);
+		stream.data.assign(bytes.begin(), bytes.end());
+		stream.type = vk::IndexType::eUint32;
+		stream.ranges = { { 0, indexCount, 0 } };
+		return stream;
+	};
+
+	if (forcedType == vk::IndexType::eUint32)
+		return keepUint32();
+
+	if (vertexCount <= maxRangeVertices || indexCount == 0)
+	{
+		stream.ranges.push_back({ 0, indexCount, 0 });
+	}
+	else
+	{
+		// greedily grow ranges of whole triangles while their vertex window fits 16 bits
+		uint32 rangeBegin = 0, rangeMin = UINT32_MAX, rangeMax = 0;
+		for (uint32 i = 0; i + 2 < indexCount; i += 3)
+		{
+			uint32 const triMin = std::min({ indices[i], indices[i + 1], indices[i + 2] });
+			uint32 const triMax = std::max({ indices[i], indices[i + 1], indices[i + 2] });
+			// no range can hold this triangle
+			if (triMax - triMin >= maxRangeVertices)
+			{
+				if (forcedType == vk::IndexType::eUint16)
+					throw std::runtime_error("a triangle spans more than 65536 vertices, its indices cannot be narrowed to 16 bits");
+				return keepUint32();
+			}
+
+			uint32 const newMin = std::min(rangeMin, triMin);
+			uint32 const newMax = std::max(rangeMax, triMax);
+			
+			if (newMax - newMin >= maxRangeVertices)
+			{
+				if (i > rangeBegin)
+					stream.ranges.push_back({ rangeBegin, i - rangeBegin, static_cast<int32>(rangeMin) });
+				rangeBegin = i;
+				rangeMin = triMin;
+				rangeMax = triMax;
+			}
+			else
+			{
+				rangeMin = newMin;
+				rangeMax = newMax;
+			}
+		}
+		
+		if (rangeBegin < indexCount)
+			stream.ranges.push_back({ rangeBegin, indexCount - rangeBegin, static_cast<int32>(rangeMin) });
+
+		if (!forcedType && indexCount / stream.ranges.size() < minAverageRangeIndices)
+			return keepUint32();
+	}
+
+	stream.type = vk::IndexType::eUint16;
+	stream.data.resize(indices.size() * sizeof(uint16));
+	uint16* const dst = reinterpret_cast<uint16*>(stream.data.data());
+	for (auto const& range : stream.ranges)
+	{
+		for (uint32 i = range.firstIndex; i < range.firstIndex + range.indexCount; i++)
+			dst[i] = static_cast<uint16>(indices[i] - range.vertexOffset);
+	}
+	
+	return stream;
+}
+
+Mesh::Mesh(vkh::DeviceContext& ctx, LoadedMesh const& mesh, VertexEncoding encoding) : Mesh(ctx, MeshView{ mesh.vertices, mesh.indices, mesh.submeshes, mesh.meshlets, mesh.lods, mesh.bounds }, encoding)
+{
+}
+
+Mesh::Mesh(vkh::DeviceContext& ctx, MeshView const& mesh, VertexEncoding encoding) : Mesh(ctx, mesh, encoding, nullptr)
+{
+}
+
+Mesh::Mesh(vkh::DeviceContext& ctx, MeshView const& mesh, GeometryPool& pool) : Mesh(ctx, mesh, pool.encoding, &pool)
+{
+}
+
+Mesh::Mesh(vkh::DeviceContext& ctx, MeshView const& mesh, VertexEncoding encoding, GeometryPool* pool) : vertexEncoding(encoding), submeshes(mesh.submeshes.begin(), mesh.submeshes.end()), meshlets(mesh.meshlets.begin(), mesh.meshlets.end()), lods(mesh.lods.begin(), mesh.lods.end()), bounds(mesh.bounds)
+{
+	// float vertices are uploaded straight from the view
+	EncodedVertices encoded;
+	std::span<uint8 const> vertexData = toByteSpan(mesh.vertices);
+	if (encoding != VertexEncoding::Float32)
+	{
+		encoded = encodeVertices(mesh.vertices, encoding);
+		vertexData = encoded.data;
+	}
+
+	IndexStream indexStream = buildIndexStream(mesh.indices, mesh.vertices.size(), pool ? std::optional(pool->indexType) : std::nullopt);
+	indexType = indexStream.type;
+	indexRanges = std::move(indexStream.ranges);
+	indicesCount = mesh.indices.size();
+	
+	if (pool)
+	{
+		geometry = pool->allocate(vertexData, indexStream.data);
+	}
+	else
 	{
 		vk::BufferCreateInfo vertexBufferInfo;
 		vertexBufferInfo.usage = vk::BufferUsageFlagBits::eVertexBuffer;
-		vertexBufferInfo.size = mesh.vertices.size() * sizeof(mesh.vertices[0]);
+		vertexBufferInfo.size = vertexData.size();
 		vertexBufferInfo.sharingMode = vk::SharingMode::eExclusive;
 
-		vma::AllocationCreateInfo allocInfo;
-		allocInfo.usage = vma::MemoryUsage::eCpuToGpu;
-		vertexBuffer.create(ctx, vertexBufferInfo, allocInfo);
-		vertexBuffer.writeData(toSpan<uint8>(mesh.vertices));
-	}
-	{
+		vertexBuffer.create(ctx, vertexBufferInfo, vkh::BufferLocation::DeviceLocal, vertexData);
+		
 		vk::BufferCreateInfo indexBufferInfo;
 		indexBufferInfo.usage = vk::BufferUsageFlagBits::eIndexBuffer;
-		indexBufferInfo.size = mesh.indices.size() * sizeof(mesh.indices[0]);
+		indexBufferInfo.size = indexStream.data.size();
 		indexBufferInfo.sharingMode = vk::SharingMode::eExclusive;
 
-		vma::AllocationCreateInfo allocInfo;
-		allocInfo.usage = vma::MemoryUsage::eCpuToGpu;
-		indexBuffer.create(ctx, indexBufferInfo, allocInfo);
-		indexBuffer.writeData(toSpan<uint8>(mesh.indices));
-		indicesCount = mesh.indices.size();
+		indexBuffer.create(ctx, indexBufferInfo, vkh::BufferLocation::DeviceLocal, indexStream.data);
 	}
+	
+	// @TODO
+	modelMatrix = glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+	// quantized positions are decoded by the model matrix
+	modelMatrix = modelMatrix * encoded.dequantization;
+}
+
+void Mesh::draw(vk::CommandBuffer cmdBuff, uint32 index)
+{
+	if (!lods.empty())
 	{
-		vk::BufferCreateInfo uniformBufferInfo;
-		uniformBufferInfo.usage = vk::BufferUsageFlagBits::eUniformBuffer;
-		uniformBufferInfo.size = sizeof(glm::mat4);
-		uniformBufferInfo.sharingMode = vk::SharingMode::eExclusive;
+		drawLod(cmdBuff, 0);
+		return;
+	}
+	
+	bindBuffers(cmdBuff);
+	for (auto const& range : indexRanges)
+		cmdBuff.drawIndexed(range.indexCount, 1, geometry.firstIndex + range.firstIndex, static_cast<int32>(geometry.firstVertex) + range.vertexOffset, 0);
+}
 
-		vma::AllocationCreateInfo allocInfo;
-		allocInfo.usage = vma::MemoryUsage::eCpuToGpu;
-		modelBuffer.create(ctx, uniformBufferInfo, allocInfo);
+void Mesh::drawLod(vk::CommandBuffer cmdBuff, uint32 lod)
+{
+	assert(lod < lods.size());
+	IndexRange const range{ lods[lod].firstIndex, lods[lod].indexCount, 0 };
+	drawRanges(cmdBuff, { &range, 1 });
+}
+
+void Mesh::drawRanges(vk::CommandBuffer cmdBuff, std::span<IndexRange const> ranges)
+{
+	bindBuffers(cmdBuff);
+	for (auto const& range : ranges)
+		drawIndexRange(cmdBuff, range);
+}
+
+void Mesh::drawSubmeshes(vk::CommandBuffer cmdBuff, std::span<Material* const> materials, uint32 lod)
+{
+	assert(!materials.empty());
+	assert(lods.empty() ? lod == 0 : lod < lods.size());
+	
+	bindBuffers(cmdBuff);
+	
+	if (submeshes.empty())
+	{
+		materials[0]->bind(cmdBuff);
+		uint32 const indexCount = static_cast<uint32>(lods.empty() ? indicesCount : lods[lod].indexCount);
+		drawIndexRange(cmdBuff, { lods.empty() ? 0 : lods[lod].firstIndex, indexCount, 0 });
+		return;
+	}
+
+	// submeshes are sorted by material, only rebind when it changes
+	Material* boundMaterial = nullptr;
+	for (auto const& submesh : getLodSubmeshes(submeshes, lods.size(), lod))
+	{
+		if (submesh.indexCount == 0)
+			continue;
 		
-		// @TODO
-		glm::mat4 model = glm::rotate(glm::mat4(1.0f), glm::radians(90.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+		Material* const material = submesh.materialId < materials.size() ? materials[submesh.materialId] : materials[0];
+		if (material != boundMaterial)
+		{
+			material->bind(cmdBuff);
+			boundMaterial = material;
+		}
 		
-		modelBuffer.writeStruct(model);
+		drawIndexRange(cmdBuff, { submesh.firstIndex, submesh.indexCount, 0 });
 	}
-	
 }
 
-void Mesh::draw(vk::CommandBuffer cmdBuff, uint32 index)
+void Mesh::bindBuffers(vk::CommandBuffer cmdBuff)
 {
+	// pooled meshes share the buffers bound by GeometryPool::bind
+	if (geometry.pool)
+		return;
+	
 	vk::DeviceSize offsets[] = { 0 };
 	vk::Buffer vertexBuffers[] = { vertexBuffer.buffer };
 	
 	cmdBuff.bindVertexBuffers(0, 1, vertexBuffers, offsets);
-	cmdBuff.bindIndexBuffer(indexBuffer.buffer, 0, vk::IndexType::eUint32);
-	cmdBuff.drawIndexed(indicesCount, 1, 0, 0, 0);
+	cmdBuff.bindIndexBuffer(indexBuffer.buffer, 0, indexType);
+}
+
+void Mesh::drawIndexRange(vk::CommandBuffer cmdBuff, IndexRange const& range)
+{
+	// a range can span several 16 bit index ranges, each part is drawn with its own vertexOffset
+	uint32 const rangeEnd = range.firstIndex + range.indexCount;
+	auto it = std::upper_bound(indexRanges.begin(), indexRanges.end(), range.firstIndex,
+		[](uint32 index, IndexRange const& indexRange) { return index < indexRange.firstIndex; });
+	
+	for (it = std::prev(it); it != indexRanges.end() && it->firstIndex < rangeEnd; ++it)
+	{
+		uint32 const first = std::max(range.firstIndex, it->firstIndex);
+		uint32 const last = std::min(rangeEnd, it->firstIndex + it->indexCount);
+		cmdBuff.drawIndexed(last - first, 1, geometry.firstIndex + first, static_cast<int32>(geometry.firstVertex) + it->vertexOffset, 0);
+	}
 }
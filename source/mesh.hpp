@@ -1,20 +1,74 @@
 #pragma once
 
 #include <filesystem>
+#include <optional>
+#include <span>
+#include <vector>
 #include <glm/glm.hpp>
-
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
+#include <glm/gtc/matrix_transform.hpp>
 
 #include <vkhBuffer.hpp>
 #include <vkhCommandBuffers.hpp>
 
+#include "geometryPool.hpp"
 #include "renderObject.hpp"
+#include "vertexEncoding.hpp"
 
 namespace vkh {
 	struct DeviceContext;
 }
 
+struct Material;
+
+// Axis aligned box and bounding sphere in mesh space (see meshBounds.hpp)
+struct Bounds
+{
+	glm::vec3 aabbMin;
+	glm::vec3 aabbMax;
+	glm::vec3 sphereCenter;
+	float sphereRadius;
+};
+
+// Index range drawn with a single material
+struct Submesh
+{
+	static uint32 constexpr noMaterial = UINT32_MAX;
+	
+	uint32 firstIndex;
+	uint32 indexCount;
+	// index in the OBJ material list
+	uint32 materialId;
+	// levels of detail keep the bounds of their full resolution submesh
+	Bounds bounds;
+};
+
+// Cluster of triangles contiguous in the mesh index buffer, culled as a whole (see meshlet.hpp)
+struct Meshlet
+{
+	uint32 firstIndex;
+	uint32 indexCount;
+	// unique vertices referenced by the meshlet
+	uint32 vertexCount;
+	
+	// bounding sphere in mesh space
+	glm::vec3 center;
+	float radius;
+	
+	// normal cone, every triangle is back facing from eye when dot(center - eye, coneAxis) >= coneCutoff * length(center - eye) + radius
+	// coneCutoff is 1 when the cone is too wide to ever cull
+	glm::vec3 coneAxis;
+	float coneCutoff;
+};
+
+// Level of detail index range, every level shares the mesh vertex buffer (see meshSimplifier.hpp)
+struct MeshLod
+{
+	uint32 firstIndex;
+	uint32 indexCount;
+	// simplification error in mesh units, 0 for the full resolution level
+	float error;
+};
+
 struct LoadedMesh
 {
 	struct Vertex
@@ -29,36 +83,145 @@ struct LoadedMesh
 			return pos == other.pos && uv == other.uv && color == other.color && normal == other.normal;
 		}
 	};
+
+	static_assert(sizeof(Vertex) == sizeof(float) * 11, "Vertex must not contain padding, it is hashed as raw bytes");
 	
 	std::vector<Vertex> vertices;
 	std::vector<uint32> indices;
+	Bounds bounds{};
+	// sorted by material, when empty the mesh is a single submesh without material
+	// with lods, every level stores the same number of submeshes after the previous level ones (see getLodSubmeshes)
+	std::vector<Submesh> submeshes;
+	// optional, filled by buildMeshlets, they only cover the first level of detail
+	std::vector<Meshlet> meshlets;
+	// optional, filled by generateLods, when empty the whole index buffer is a single level
+	std::vector<MeshLod> lods;
 };
 
-// @TODO true hash function
-namespace std {
-	template<> struct hash<LoadedMesh::Vertex> {
-		size_t operator()(LoadedMesh::Vertex const& vertex) const {
-			return ((((
-					(hash<glm::vec3>()(vertex.pos) ^
-					(hash<glm::vec3>()(vertex.color) << 1)) >> 1) ^
-					(hash<glm::vec3>()(vertex.normal) << 2)) >> 2)) ^
-					(hash<glm::vec2>()(vertex.uv) << 1);
-		}
+// Non owning view over mesh geometry, the data can live in a LoadedMesh or in a mapped mesh cache file
+struct MeshView
+{
+	std::span<LoadedMesh::Vertex const> vertices;
+	std::span<uint32 const> indices;
+	std::span<Submesh const> submeshes;
+	std::span<Meshlet const> meshlets;
+	std::span<MeshLod const> lods;
+	Bounds bounds{};
+};
+
+// submeshes of the first level, a mesh without submesh table is a single submesh
+std::vector<Submesh> getBaseSubmeshes(LoadedMesh const& mesh);
+std::span<Submesh const> getLodSubmeshes(std::span<Submesh const> submeshes, size_t lodCount, uint32 lod);
+
+// Stable sort the triangles by material and fill mesh.submeshes, triangleMaterials holds one material id per triangle
+void sortByMaterial(LoadedMesh& mesh, std::span<uint32 const> triangleMaterials);
+
+// Range of an index stream drawn with a single drawIndexed call
+struct IndexRange
+{
+	uint32 firstIndex;
+	uint32 indexCount;
+	// added to the stored indices, lets 16 bit ranges address vertices past 65535
+	int32 vertexOffset;
+};
+
+struct IndexStream
+{
+	std::vector<uint8> data;
+	vk::IndexType type;
+	std::vector<IndexRange> ranges;
+};
+
+// Narrow indices to uint16 when the mesh allows it
+// Meshes with more than 65536 vertices are split in consecutive triangle ranges each spanning less than 65536 vertices,
+// this is only kept when ranges are large enough to be worth the extra draw calls, otherwise indices stay uint32.
+// Works best on meshes reordered by optimizeVertexFetch since their vertices are laid out in first use order.
+// forcedType skips the heuristic, e.g. to match the index type of a GeometryPool. A triangle whose own indices span
+// 65536 vertices or more keeps the indices uint32, or throws when uint16 is forced.
+IndexStream buildIndexStream(std::span<uint32 const> indices, size_t vertexCount, std::optional<vk::IndexType> forcedType = std::nullopt);
+
+// Quantized encodings are normalized to the vertices bounds, Float32 is a plain copy
+EncodedVertices encodeVertices(std::span<LoadedMesh::Vertex const> vertices, VertexEncoding encoding);
+
+// Flat open addressing table used to deduplicate vertices at import
+// Vertices are hashed and compared on their raw bytes once their floats are canonicalized (signed zeros and NaN payloads),
+// the table only stores indices into the vertex array it fills.
+class VertexDedupTable
+{
+public:
+	struct Stats
+	{
+		size_t lookups = 0;
+		// lookups that had to probe past their first slot
+		size_t collisions = 0;
+		// total number of slots visited past the first one
+		size_t extraProbes = 0;
+	};
+	
+	// expectedCount is the number of insert calls expected (usually the index count), the table never rehash below it
+	VertexDedupTable(std::vector<LoadedMesh::Vertex>& vertices, size_t expectedCount);
+
+	// return the index of vertex in the vertex array, appending it if it was not already present
+	uint32 insert(LoadedMesh::Vertex const& vertex);
+
+	Stats stats;
+	
+private:
+	struct Slot
+	{
+		uint32 index;
+		uint32 hashTag;
 	};
-}
+
+	static uint32 constexpr emptySlot = UINT32_MAX;
+
+	void grow();
+	
+	std::vector<LoadedMesh::Vertex>& vertices;
+	std::vector<Slot> slots;
+	size_t mask;
+};
 
 LoadedMesh loadObj(std::filesystem::path const& objPath);
 
 class Mesh : RenderObject
 {
 public:
-	Mesh(vkh::DeviceContext& ctx, LoadedMesh const& mesh);
+	// quantized encodings must be drawn with a pipeline created with the matching vertexAttributeFormats
+	Mesh(vkh::DeviceContext& ctx, LoadedMesh const& mesh, VertexEncoding encoding = VertexEncoding::Float32);
+	Mesh(vkh::DeviceContext& ctx, MeshView const& mesh, VertexEncoding encoding = VertexEncoding::Float32);
+	// geometry is suballocated in the pool and drawn with its encoding, draws do not bind buffers: call pool.bind first
+	Mesh(vkh::DeviceContext& ctx, MeshView const& mesh, GeometryPool& pool);
 
+	// draw the first level of detail
 	void draw(vk::CommandBuffer cmdBuff, uint32);
+	void drawLod(vk::CommandBuffer cmdBuff, uint32 lod);
+	// one draw per submesh bound with materials[materialId], submeshes without valid material use the first one
+	// materials must have pushed their parameters for the current frame
+	void drawSubmeshes(vk::CommandBuffer cmdBuff, std::span<Material* const> materials, uint32 lod = 0);
+	// draw parts of the index buffer, e.g. the output of cullMeshlets, range vertexOffsets are ignored
+	void drawRanges(vk::CommandBuffer cmdBuff, std::span<IndexRange const> ranges);
 
 	size_t indicesCount;
+	VertexEncoding vertexEncoding;
+	vk::IndexType indexType;
+	std::vector<IndexRange> indexRanges;
+	std::vector<Submesh> submeshes;
+	std::vector<Meshlet> meshlets;
+	std::vector<MeshLod> lods;
+	Bounds bounds;
 	
+	// empty when the mesh is in a GeometryPool
 	vkh::Buffer vertexBuffer;
 	vkh::Buffer indexBuffer;
-	vkh::Buffer modelBuffer;
+	// offsets added to every draw, zero without pool
+	GeometryAllocation geometry;
+	// pushed to the frame ring buffer by the renderer every frame
+	glm::mat4 modelMatrix{ 1.0f };
+
+private:
+	Mesh(vkh::DeviceContext& ctx, MeshView const& mesh, VertexEncoding encoding, GeometryPool* pool);
+	
+	void bindBuffers(vk::CommandBuffer cmdBuff);
+	void drawIndexRange(vk::CommandBuffer cmdBuff, IndexRange const& range);
 };
\ No newline at end of file
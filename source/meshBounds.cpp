@@ -0,0 +1,168 @@
+#include "meshBounds.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+#include <glm/gtc/type_ptr.hpp>
+
+#include "utility.hpp"
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define ICE_BOUNDS_SSE 1
+#include <xmmintrin.h>
+#endif
+
+namespace
+{
+	// vertices reduced by a single task
+	size_t constexpr chunkSize = 1 << 16;
+
+	struct Aabb
+	{
+		glm::vec3 min;
+		glm::vec3 max;
+	};
+	
+	// 4 floats are loaded from pos, the 4th one is the normal x and is ignored
+	static_assert(offsetof(LoadedMesh::Vertex, pos) == 0 && sizeof(LoadedMesh::Vertex) >= 4 * sizeof(float));
+}
+
+// getPos(i) return a pointer to the position of the i-th vertex
+template<typename GetPos>
+static Aabb reduceAabb(size_t begin, size_t end, GetPos const& getPos)
+{
+	assert(begin < end);
+	
+#if ICE_BOUNDS_SSE
+	__m128 vmin = _mm_loadu_ps(getPos(begin));
+	__m128 vmax = vmin;
+	
+	size_t i = begin;
+	for (; i + 4 <= end; i += 4)
+	{
+		__m128 const a = _mm_loadu_ps(getPos(i));
+		__m128 const b = _mm_loadu_ps(getPos(i + 1));
+		__m128 const c = _mm_loadu_ps(getPos(i + 2));
+		__m128 const d = _mm_loadu_ps(getPos(i + 3));
+		vmin = _mm_min_ps(vmin, _mm_min_ps(_mm_min_ps(a, b), _mm_min_ps(c, d)));
+		vmax = _mm_max_ps(vmax, _mm_max_ps(_mm_max_ps(a, b), _mm_max_ps(c, d)));
+	}
+	for (; i < end; i++)
+	{
+		__m128 const p = _mm_loadu_ps(getPos(i));
+		vmin = _mm_min_ps(vmin, p);
+		vmax = _mm_max_ps(vmax, p);
+	}
+
+	alignas(16) float boxMin[4], boxMax[4];
+	_mm_store_ps(boxMin, vmin);
+	_mm_store_ps(boxMax, vmax);
+	return { { boxMin[0], boxMin[1], boxMin[2] }, { boxMax[0], boxMax[1], boxMax[2] } };
+#else
+	Aabb box;
+	box.min = box.max = glm::make_vec3(getPos(begin));
+	for (size_t i = begin + 1; i < end; i++)
+	{
+		glm::vec3 const p = glm::make_vec3(getPos(i));
+		box.min = glm::min(box.min, p);
+		box.max = glm::max(box.max, p);
+	}
+	return box;
+#endif
+}
+
+template<typename GetPos>
+static float reduceMaxDistance2(size_t begin, size_t end, GetPos const& getPos, glm::vec3 center)
+{
+	float maxDistance2 = 0.0f;
+	size_t i = begin;
+	
+#if ICE_BOUNDS_SSE
+	__m128 const cx = _mm_set1_ps(center.x);
+	__m128 const cy = _mm_set1_ps(center.y);
+	__m128 const cz = _mm_set1_ps(center.z);
+	__m128 vmax = _mm_setzero_ps();
+	
+	for (; i + 4 <= end; i += 4)
+	{
+		// transpose 4 positions to x, y, z lanes
+		__m128 x = _mm_loadu_ps(getPos(i));
+		__m128 y = _mm_loadu_ps(getPos(i + 1));
+		__m128 z = _mm_loadu_ps(getPos(i + 2));
+		__m128 w = _mm_loadu_ps(getPos(i + 3));
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+
+		__m128 const dx = _mm_sub_ps(x, cx);
+		__m128 const dy = _mm_sub_ps(y, cy);
+		__m128 const dz = _mm_sub_ps(z, cz);
+		__m128 const distance2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+		vmax = _mm_max_ps(vmax, distance2);
+	}
+
+	alignas(16) float lanes[4];
+	_mm_store_ps(lanes, vmax);
+	maxDistance2 = std::max({ lanes[0], lanes[1], lanes[2], lanes[3] });
+#endif
+	
+	for (; i < end; i++)
+	{
+		glm::vec3 const d = glm::make_vec3(getPos(i)) - center;
+		maxDistance2 = std::max(maxDistance2, glm::dot(d, d));
+	}
+	return maxDistance2;
+}
+
+template<typename GetPos>
+static Bounds reduceBounds(size_t count, GetPos const& getPos)
+{
+	if (count == 0)
+		return {};
+	
+	size_t const chunkCount = (count + chunkSize - 1) / chunkSize;
+	auto const chunkEnd = [&](size_t c) { return std::min(count, (c + 1) * chunkSize); };
+	
+	std::vector<Aabb> boxes(chunkCount);
+	parallelFor(chunkCount, [&](size_t c)
+	{
+		boxes[c] = reduceAabb(c * chunkSize, chunkEnd(c), getPos);
+	});
+
+	Bounds bounds;
+	bounds.aabbMin = boxes[0].min;
+	bounds.aabbMax = boxes[0].max;
+	for (auto const& box : boxes)
+	{
+		bounds.aabbMin = glm::min(bounds.aabbMin, box.min);
+		bounds.aabbMax = glm::max(bounds.aabbMax, box.max);
+	}
+
+	// sphere centered on the box, a bit looser than a minimal one but exact to compute in a single pass
+	bounds.sphereCenter = (bounds.aabbMin + bounds.aabbMax) * 0.5f;
+	std::vector<float> distances2(chunkCount);
+	parallelFor(chunkCount, [&](size_t c)
+	{
+		distances2[c] = reduceMaxDistance2(c * chunkSize, chunkEnd(c), getPos, bounds.sphereCenter);
+	});
+	bounds.sphereRadius = std::sqrt(*std::max_element(distances2.begin(), distances2.end()));
+	
+	return bounds;
+}
+
+Bounds computeBounds(std::span<LoadedMesh::Vertex const> vertices)
+{
+	return reduceBounds(vertices.size(), [&](size_t i) { return &vertices[i].pos.x; });
+}
+
+Bounds computeBounds(std::span<LoadedMesh::Vertex const> vertices, std::span<uint32 const> indices)
+{
+	return reduceBounds(indices.size(), [&](size_t i) { return &vertices[indices[i]].pos.x; });
+}
+
+void computeMeshBounds(LoadedMesh& mesh)
+{
+	mesh.bounds = computeBounds(mesh.vertices);
+	for (auto& submesh : mesh.submeshes)
+		submesh.bounds = computeBounds(mesh.vertices, std::span(mesh.indices).subspan(submesh.firstIndex, submesh.indexCount));
+}
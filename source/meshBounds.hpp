@@ -0,0 +1,15 @@
+#pragma once
+
+#include <span>
+
+#include "ice.hpp"
+#include "mesh.hpp"
+
+// Bounds of every vertex, empty spans give zero bounds
+// Large vertex arrays are split across threads, positions are reduced 4 vertices at a time with SSE when available.
+Bounds computeBounds(std::span<LoadedMesh::Vertex const> vertices);
+// Bounds of the vertices referenced by indices
+Bounds computeBounds(std::span<LoadedMesh::Vertex const> vertices, std::span<uint32 const> indices);
+
+// Fill mesh.bounds and the bounds of every entry of mesh.submeshes
+void computeMeshBounds(LoadedMesh& mesh);
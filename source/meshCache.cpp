@@ -0,0 +1,255 @@
+#include "meshCache.hpp"
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string_view>
+#include <thread>
+
+#include "meshlet.hpp"
+#include "meshOptimizer.hpp"
+#include "meshSimplifier.hpp"
+#include "objImporter.hpp"
+
+static uint64 alignUp(uint64 value, uint64 alignment)
+{
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+MeshCache::MeshCache(MeshCache&& rhs) noexcept : file(std::move(rhs.file)), header(rhs.header), mesh(std::move(rhs.mesh))
+{
+	rhs.header = nullptr;
+}
+
+MeshCache& MeshCache::operator=(MeshCache&& rhs) noexcept
+{
+	file = std::move(rhs.file);
+	header = rhs.header;
+	mesh = std::move(rhs.mesh);
+	rhs.header = nullptr;
+	return *this;
+}
+
+bool MeshCache::open(std::filesystem::path const& cachePath, uint64 sourceHash)
+{
+	close();
+
+	std::error_code ec;
+	if (!std::filesystem::is_regular_file(cachePath, ec))
+		return false;
+
+	file.open(cachePath);
+	auto const data = file.data();
+
+	auto const invalid = [this]()
+	{
+		close();
+		return false;
+	};
+	
+	if (data.size() < sizeof(MeshCacheHeader))
+		return invalid();
+
+	auto const* h = reinterpret_cast<MeshCacheHeader const*>(data.data());
+	if (memcmp(h->magic, MeshCacheHeader::magicValue, sizeof(h->magic)) != 0
+		|| h->version != MeshCacheHeader::currentVersion
+		|| h->vertexSize != sizeof(LoadedMesh::Vertex)
+		|| h->sourceHash != sourceHash)
+		return invalid();
+
+	auto const sectionFits = [size = data.size()](uint64 offset, uint64 count, uint64 elementSize)
+	{
+		return offset <= size && count <= (size - offset) / elementSize;
+	};
+	
+	if (!sectionFits(h->submeshOffset, h->submeshCount, sizeof(Submesh))
+		|| !sectionFits(h->vertexOffset, h->vertexCount, sizeof(LoadedMesh::Vertex))
+		|| !sectionFits(h->indexOffset, h->indexCount, sizeof(uint32))
+		|| !sectionFits(h->meshletOffset, h->meshletCount, sizeof(Meshlet))
+		|| !sectionFits(h->lodOffset, h->lodCount, sizeof(MeshLod)))
+		return invalid();
+
+	header = h;
+	return true;
+}
+
+void MeshCache::keep(LoadedMesh&& loadedMesh)
+{
+	close();
+	mesh = std::make_unique<LoadedMesh>(std::move(loadedMesh));
+}
+
+void MeshCache::close()
+{
+	header = nullptr;
+	file.close();
+	mesh.reset();
+}
+
+bool MeshCache::isOpen() const noexcept
+{
+	return header != nullptr || mesh;
+}
+
+MeshView MeshCache::getView() const noexcept
+{
+	assert(isOpen());
+	if (mesh)
+		return { mesh->vertices, mesh->indices, mesh->submeshes, mesh->meshlets, mesh->lods, mesh->bounds };
+
+	char const* base = file.data().data();
+	return {
+		.vertices = { reinterpret_cast<LoadedMesh::Vertex const*>(base + header->vertexOffset), header->vertexCount },
+		.indices = { reinterpret_cast<uint32 const*>(base + header->indexOffset), header->indexCount },
+		.submeshes = { reinterpret_cast<Submesh const*>(base + header->submeshOffset), header->submeshCount },
+		.meshlets = { reinterpret_cast<Meshlet const*>(base + header->meshletOffset), header->meshletCount },
+		.lods = { reinterpret_cast<MeshLod const*>(base + header->lodOffset), header->lodCount },
+		.bounds = header->bounds
+	};
+}
+
+std::span<Submesh const> MeshCache::getSubmeshes() const noexcept
+{
+	assert(isOpen());
+	return getView().submeshes;
+}
+
+MeshCacheHeader const& MeshCache::getHeader() const noexcept
+{
+	assert(header);
+	return *header;
+}
+
+void writeMeshCache(std::filesystem::path const& cachePath, LoadedMesh const& mesh, uint64 sourceHash)
+{
+	MeshCacheHeader header{};
+	memcpy(header.magic, MeshCacheHeader::magicValue, sizeof(header.magic));
+	header.version = MeshCacheHeader::currentVersion;
+	header.sourceHash = sourceHash;
+	header.vertexSize = sizeof(LoadedMesh::Vertex);
+	header.submeshCount = static_cast<uint32>(mesh.submeshes.size());
+	header.vertexCount = mesh.vertices.size();
+	header.indexCount = mesh.indices.size();
+	header.meshletCount = mesh.meshlets.size();
+	header.lodCount = mesh.lods.size();
+	header.submeshOffset = alignUp(sizeof(MeshCacheHeader), 16);
+	header.vertexOffset = alignUp(header.submeshOffset + mesh.submeshes.size() * sizeof(Submesh), 16);
+	header.indexOffset = alignUp(header.vertexOffset + mesh.vertices.size() * sizeof(LoadedMesh::Vertex), 16);
+	header.meshletOffset = alignUp(header.indexOffset + mesh.indices.size() * sizeof(uint32), 16);
+	header.lodOffset = alignUp(header.meshletOffset + mesh.meshlets.size() * sizeof(Meshlet), 16);
+
+	header.bounds = mesh.bounds;
+
+	// write to a temporary file first so a crash never leaves a truncated cache behind
+	// named after the thread so concurrent writers of the same cache do not share it
+	std::filesystem::path tmpPath = cachePath;
+	tmpPath += "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp";
+	{
+		std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+		if (!out.is_open())
+			throw std::runtime_error("failed to open file " + tmpPath.string());
+
+		auto const writeAt = [&out](uint64 offset, void const* data, size_t size)
+		{
+			// pad up to the section offset
+			static char constexpr zeros[16] = {};
+			uint64 const pos = static_cast<uint64>(out.tellp());
+			out.write(zeros, static_cast<std::streamsize>(offset - pos));
+			out.write(static_cast<char const*>(data), static_cast<std::streamsize>(size));
+		};
+
+		writeAt(0, &header, sizeof(header));
+		writeAt(header.submeshOffset, mesh.submeshes.data(), mesh.submeshes.size() * sizeof(Submesh));
+		writeAt(header.vertexOffset, mesh.vertices.data(), mesh.vertices.size() * sizeof(LoadedMesh::Vertex));
+		writeAt(header.indexOffset, mesh.indices.data(), mesh.indices.size() * sizeof(uint32));
+		writeAt(header.meshletOffset, mesh.meshlets.data(), mesh.meshlets.size() * sizeof(Meshlet));
+		writeAt(header.lodOffset, mesh.lods.data(), mesh.lods.size() * sizeof(MeshLod));
+
+		if (!out)
+			throw std::runtime_error("failed to write mesh cache " + tmpPath.string());
+	}
+	std::error_code error;
+	std::filesystem::rename(tmpPath, cachePath, error);
+	if (error)
+	{
+		std::filesystem::remove(tmpPath, error);
+		throw std::runtime_error("failed to replace mesh cache " + cachePath.string());
+	}
+}
+
+uint64 hashFileContent(std::filesystem::path const& filePath, uint64 seed)
+{
+	MappedFile file;
+	file.open(filePath);
+	return hashBytes(file.data().data(), file.size(), seed);
+}
+
+// the obj bytes followed by every material library its mtllib lines name
+static uint64 hashObjSource(std::filesystem::path const& objPath, uint64 seed)
+{
+	MappedFile file;
+	file.open(objPath);
+	std::string_view const text(file.data().data(), file.size());
+	uint64 hash = hashBytes(text.data(), text.size(), seed);
+
+	for (size_t pos = text.find("mtllib"); pos != std::string_view::npos; pos = text.find("mtllib", pos + 6))
+	{
+		size_t const lineBegin = text.find_last_of('\n', pos) + 1;
+		if (text.find_first_not_of(" \t", lineBegin) != pos || pos + 6 >= text.size() || (text[pos + 6] != ' ' && text[pos + 6] != '\t'))
+			continue;
+
+		size_t const lineEnd = std::min(text.find('\n', pos), text.size());
+		for (size_t nameBegin = text.find_first_not_of(" \t\r", pos + 6); nameBegin < lineEnd;)
+		{
+			size_t const nameEnd = std::min(text.find_first_of(" \t\r\n", nameBegin), text.size());
+			std::filesystem::path const mtlPath = objPath.parent_path() / text.substr(nameBegin, nameEnd - nameBegin);
+			std::error_code ec;
+			if (std::filesystem::is_regular_file(mtlPath, ec))
+				hash = hashFileContent(mtlPath, hash);
+			nameBegin = text.find_first_not_of(" \t\r", nameEnd);
+		}
+	}
+	return hash;
+}
+
+MeshCache loadObjCached(std::filesystem::path const& objPath, MeshImportOptions const& options)
+{
+	std::filesystem::path cachePath = objPath;
+	cachePath.replace_extension(".icemesh");
+	
+	uint64 const optionsKey = (options.optimize ? 1 : 0) | (options.buildMeshlets ? 2 : 0) | (options.generateLods ? 4 : 0);
+	uint64 const sourceHash = hashObjSource(objPath, optionsKey | static_cast<uint64>(meshImporterVersion) << 32);
+
+	MeshCache cache;
+	if (cache.open(cachePath, sourceHash))
+		return cache;
+
+	LoadedMesh mesh = loadObjParallel(objPath);
+	if (options.optimize)
+	{
+		MeshOptimizationReport report;
+		optimizeMesh(mesh, &report);
+		printf("[mesh cache] optimized %s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", objPath.string().c_str(),
+			report.before.acmr, report.after.acmr, report.before.atvr, report.after.atvr);
+	}
+	// fixes the triangle order of the first level, the optimized order is used as a locality hint
+	if (options.buildMeshlets)
+		buildMeshlets(mesh);
+	if (options.generateLods)
+		generateLods(mesh);
+	
+	try
+	{
+		writeMeshCache(cachePath, mesh, sourceHash);
+		if (cache.open(cachePath, sourceHash))
+			return cache;
+	}
+	catch (std::exception const&)
+	{
+		// the cache only saves time, another import of the same mesh may be mapping it
+	}
+
+	cache.keep(std::move(mesh));
+	return cache;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <filesystem>
+#include <memory>
+#include <glm/glm.hpp>
+
+#include "ice.hpp"
+#include "mesh.hpp"
+#include "utility.hpp"
+
+// Binary mesh cache (.icemesh)
+// Stores a deduplicated LoadedMesh so it can be memory mapped on later runs instead of re-parsing the source OBJ.
+// Layout: header | submesh table | vertices | indices | meshlets | lods, every section is 16 bytes aligned.
+struct MeshCacheHeader
+{
+	static constexpr char magicValue[4] = { 'I', 'C', 'E', 'M' };
+	static constexpr uint32 currentVersion = 5;
+	
+	char magic[4];
+	uint32 version;
+	// content hash of the source asset, the cache is stale when it does not match
+	uint64 sourceHash;
+	uint32 vertexSize;
+	uint32 submeshCount;
+	uint64 vertexCount;
+	uint64 indexCount;
+	uint64 meshletCount;
+	uint64 lodCount;
+	uint64 submeshOffset;
+	uint64 vertexOffset;
+	uint64 indexOffset;
+	uint64 meshletOffset;
+	uint64 lodOffset;
+	Bounds bounds;
+};
+
+// Bump when the importer, optimizer, meshlet builder or simplifier output changes so cached meshes are rebuilt
+inline constexpr uint32 meshImporterVersion = 1;
+
+// Mapped .icemesh file, or the imported mesh itself when its cache could not be written
+// Views returned by it are valid as long as the MeshCache is alive
+class MeshCache
+{
+public:
+	MeshCache() = default;
+	MeshCache(MeshCache&&) noexcept;
+	MeshCache& operator=(MeshCache&&) noexcept;
+	
+	// return false if the file is missing, invalid, from another version or built from another source
+	[[nodiscard]] bool open(std::filesystem::path const& cachePath, uint64 sourceHash);
+	// hold the mesh in memory instead of a mapped file
+	void keep(LoadedMesh&& loadedMesh);
+	void close();
+
+	[[nodiscard]] bool isOpen() const noexcept;
+	
+	[[nodiscard]] MeshView getView() const noexcept;
+	[[nodiscard]] std::span<Submesh const> getSubmeshes() const noexcept;
+	// only valid for a mapped file
+	[[nodiscard]] MeshCacheHeader const& getHeader() const noexcept;
+	
+private:
+	MappedFile file;
+	MeshCacheHeader const* header = nullptr;
+	std::unique_ptr<LoadedMesh> mesh;
+};
+
+void writeMeshCache(std::filesystem::path const& cachePath, LoadedMesh const& mesh, uint64 sourceHash);
+
+uint64 hashFileContent(std::filesystem::path const& filePath, uint64 seed = 0);
+
+struct MeshImportOptions
+{
+	// reorder triangles and vertices for the post transform cache and vertex fetch, see meshOptimizer.hpp
+	bool optimize = true;
+	// split the mesh in culling clusters, see meshlet.hpp
+	bool buildMeshlets = true;
+	// simplified levels of detail sharing the vertex buffer, see meshSimplifier.hpp
+	bool generateLods = true;
+};
+
+// Map objPath's .icemesh cache, (re)building it from the OBJ first when it is missing or stale
+// Import options, the importer version and the material libraries are part of the cache key
+// The imported mesh is kept in memory when the cache cannot be written
+MeshCache loadObjCached(std::filesystem::path const& objPath, MeshImportOptions const& options = {});
@@ -0,0 +1,262 @@
+#include "meshOptimizer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace
+{
+	// Forsyth scoring parameters, the simulated LRU cache is larger than real hardware FIFO on purpose
+	uint32 constexpr simulatedCacheSize = 32;
+	float constexpr cacheDecayPower = 1.5f;
+	float constexpr lastTriangleScore = 0.75f;
+	float constexpr valenceBoostScale = 2.0f;
+	float constexpr valenceBoostPower = 0.5f;
+	uint32 constexpr valenceTableSize = 32;
+	// bound the candidate search around very high valence vertices (fans, degenerated scans)
+	uint32 constexpr maxCandidatesPerVertex = 64;
+	uint32 constexpr noTriangle = UINT32_MAX;
+
+	struct ScoreTables
+	{
+		ScoreTables()
+		{
+			for (uint32 i = 0; i < simulatedCacheSize; i++)
+			{
+				if (i < 3)
+				{
+					// the vertices of the last triangle are given a fixed score so the next one is not always a strip continuation
+					cache[i] = lastTriangleScore;
+				}
+				else
+				{
+					float const scaler = 1.0f / (simulatedCacheSize - 3);
+					cache[i] = std::pow(1.0f - (i - 3) * scaler, cacheDecayPower);
+				}
+			}
+
+			valence[0] = 0.0f;
+			for (uint32 i = 1; i < valenceTableSize; i++)
+				valence[i] = valenceBoostScale * std::pow(static_cast<float>(i), -valenceBoostPower);
+		}
+
+		std::array<float, simulatedCacheSize> cache;
+		std::array<float, valenceTableSize> valence;
+	};
+}
+
+static float vertexScore(ScoreTables const& tables, int32 cachePosition, uint32 remainingValence)
+{
+	// no triangle left to draw with this vertex
+	if (remainingValence == 0)
+		return -1.0f;
+
+	float score = cachePosition >= 0 ? tables.cache[cachePosition] : 0.0f;
+
+	if (remainingValence < valenceTableSize)
+		score += tables.valence[remainingValence];
+	else
+		score += valenceBoostScale * std::pow(static_cast<float>(remainingValence), -valenceBoostPower);
+
+	return score;
+}
+
+VertexCacheStats analyzeVertexCache(std::span<uint32 const> indices, size_t vertexCount, uint32 cacheSize)
+{
+	VertexCacheStats stats;
+	if (indices.empty() || vertexCount == 0)
+		return stats;
+
+	// a vertex is in the FIFO while fewer than cacheSize misses happened since it was loaded
+	std::vector<uint32> loadedAt(vertexCount, 0);
+	uint32 misses = 0;
+
+	for (uint32 const index : indices)
+	{
+		if (loadedAt[index] == 0 || misses - loadedAt[index] >= cacheSize)
+		{
+			loadedAt[index] = ++misses;
+		}
+	}
+
+	size_t const triangleCount = indices.size() / 3;
+	if (triangleCount > 0)
+		stats.acmr = static_cast<float>(misses) / static_cast<float>(triangleCount);
+	stats.atvr = static_cast<float>(misses) / static_cast<float>(vertexCount);
+	return stats;
+}
+
+void optimizeVertexCache(std::span<uint32> indices, size_t vertexCount)
+{
+	size_t const triangleCount = indices.size() / 3;
+	if (triangleCount == 0)
+		return;
+
+	static ScoreTables const tables;
+
+	// vertex -> triangles adjacency, remainingValence[v] first entries of a vertex range are the triangles not emitted yet
+	std::vector<uint32> adjacencyOffsets(vertexCount + 1, 0);
+	for (uint32 const index : indices)
+		adjacencyOffsets[index + 1]++;
+	for (size_t v = 0; v < vertexCount; v++)
+		adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+
+	std::vector<uint32> remainingValence(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		remainingValence[v] = adjacencyOffsets[v + 1] - adjacencyOffsets[v];
+
+	// adjacencySlots[i] is where the triangle of corner i is stored in the adjacency of indices[i]
+	std::vector<uint32> adjacency(indices.size());
+	std::vector<uint32> adjacencySlots(indices.size());
+	{
+		std::vector<uint32> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < indices.size(); i++)
+		{
+			adjacencySlots[i] = fill[indices[i]]++;
+			adjacency[adjacencySlots[i]] = static_cast<uint32>(i / 3);
+		}
+	}
+
+	std::vector<int32> cachePosition(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		vertexScores[v] = vertexScore(tables, -1, remainingValence[v]);
+
+	auto const triangleScore = [&](uint32 triangle)
+	{
+		uint32 const* tri = &indices[triangle * 3];
+		return vertexScores[tri[0]] + vertexScores[tri[1]] + vertexScores[tri[2]];
+	};
+
+	std::vector<bool> emitted(triangleCount, false);
+
+	uint32 bestTriangle = 0;
+	float bestScore = -1.0f;
+	for (uint32 t = 0; t < triangleCount; t++)
+	{
+		float const score = triangleScore(t);
+		if (score > bestScore)
+		{
+			bestScore = score;
+			bestTriangle = t;
+		}
+	}
+
+	std::vector<uint32> optimized;
+	optimized.reserve(triangleCount * 3);
+
+	std::array<uint32, simulatedCacheSize + 3> cache;
+	std::array<uint32, simulatedCacheSize + 3> newCache;
+	uint32 cacheCount = 0;
+	size_t scanCursor = 0;
+
+	for (size_t n = 0; n < triangleCount; n++)
+	{
+		if (bestTriangle == noTriangle)
+		{
+			// nothing adjacent to the cache is left, restart from the next triangle in input order
+			while (emitted[scanCursor])
+				scanCursor++;
+			bestTriangle = static_cast<uint32>(scanCursor);
+		}
+
+		uint32 const tri[3] = { indices[bestTriangle * 3 + 0], indices[bestTriangle * 3 + 1], indices[bestTriangle * 3 + 2] };
+		optimized.insert(optimized.end(), std::begin(tri), std::end(tri));
+		emitted[bestTriangle] = true;
+
+		uint32 newCacheCount = 0;
+		for (uint32 k = 0; k < 3; k++)
+		{
+			uint32 const v = tri[k];
+			
+			// swap the triangle with the last remaining one of the vertex
+			uint32 const slot = adjacencySlots[bestTriangle * 3 + k];
+			uint32 const lastSlot = adjacencyOffsets[v] + --remainingValence[v];
+			uint32 const movedTriangle = adjacency[lastSlot];
+			for (uint32 m = 0; m < 3; m++)
+			{
+				if (adjacencySlots[movedTriangle * 3 + m] == lastSlot)
+					adjacencySlots[movedTriangle * 3 + m] = slot;
+			}
+			std::swap(adjacency[slot], adjacency[lastSlot]);
+			adjacencySlots[bestTriangle * 3 + k] = lastSlot;
+
+			// degenerated triangles can reference the same vertex twice
+			if (std::find(newCache.begin(), newCache.begin() + newCacheCount, v) == newCache.begin() + newCacheCount)
+				newCache[newCacheCount++] = v;
+		}
+
+		for (uint32 i = 0; i < cacheCount; i++)
+		{
+			uint32 const v = cache[i];
+			if (v != tri[0] && v != tri[1] && v != tri[2])
+				newCache[newCacheCount++] = v;
+		}
+
+		// vertices pushed past the cache end are evicted and rescored as well
+		for (uint32 i = 0; i < newCacheCount; i++)
+		{
+			uint32 const v = newCache[i];
+			cachePosition[v] = i < simulatedCacheSize ? static_cast<int32>(i) : -1;
+			vertexScores[v] = vertexScore(tables, cachePosition[v], remainingValence[v]);
+		}
+
+		bestTriangle = noTriangle;
+		bestScore = -1.0f;
+		for (uint32 i = 0; i < newCacheCount; i++)
+		{
+			uint32 const v = newCache[i];
+			uint32 const* const begin = &adjacency[adjacencyOffsets[v]];
+			uint32 const candidateCount = std::min(remainingValence[v], maxCandidatesPerVertex);
+			for (uint32 const* t = begin; t != begin + candidateCount; t++)
+			{
+				float const score = triangleScore(*t);
+				if (score > bestScore)
+				{
+					bestScore = score;
+					bestTriangle = *t;
+				}
+			}
+		}
+
+		cacheCount = std::min(newCacheCount, simulatedCacheSize);
+		std::copy(newCache.begin(), newCache.begin() + cacheCount, cache.begin());
+	}
+
+	std::copy(optimized.begin(), optimized.end(), indices.begin());
+}
+
+void optimizeVertexFetch(LoadedMesh& mesh)
+{
+	uint32 constexpr unassigned = UINT32_MAX;
+	std::vector<uint32> remap(mesh.vertices.size(), unassigned);
+	std::vector<LoadedMesh::Vertex> vertices;
+	vertices.reserve(mesh.vertices.size());
+
+	for (uint32& index : mesh.indices)
+	{
+		if (remap[index] == unassigned)
+		{
+			remap[index] = static_cast<uint32>(vertices.size());
+			vertices.push_back(mesh.vertices[index]);
+		}
+		index = remap[index];
+	}
+
+	// unreferenced vertices are dropped
+	mesh.vertices = std::move(vertices);
+}
+
+void optimizeMesh(LoadedMesh& mesh, MeshOptimizationReport* report)
+{
+	if (report)
+		report->before = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+	// triangles never cross submeshes
+	for (auto const& submesh : getBaseSubmeshes(mesh))
+		optimizeVertexCache(std::span(mesh.indices).subspan(submesh.firstIndex, submesh.indexCount), mesh.vertices.size());
+	optimizeVertexFetch(mesh);
+
+	if (report)
+		report->after = analyzeVertexCache(mesh.indices, mesh.vertices.size());
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include "ice.hpp"
+#include "mesh.hpp"
+
+// Post transform vertex cache statistics of a triangle list, simulated with a FIFO cache
+struct VertexCacheStats
+{
+	// average cache miss ratio: transformed vertices per triangle, 0.5 is the ideal for large regular meshes
+	float acmr = 0.0f;
+	// average transform to vertex ratio: transformed vertices per unique vertex, 1.0 is the ideal
+	float atvr = 0.0f;
+};
+
+struct MeshOptimizationReport
+{
+	VertexCacheStats before;
+	VertexCacheStats after;
+};
+
+VertexCacheStats analyzeVertexCache(std::span<uint32 const> indices, size_t vertexCount, uint32 cacheSize = 16);
+
+// Reorder triangles for post transform cache locality (Tom Forsyth, Linear-Speed Vertex Cache Optimisation)
+// https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+void optimizeVertexCache(std::span<uint32> indices, size_t vertexCount);
+
+// Reorder vertices in the order they are first referenced by the index buffer and remap the indices
+// so vertex fetch walks memory linearly
+void optimizeVertexFetch(LoadedMesh& mesh);
+
+// optimizeVertexCache then optimizeVertexFetch, the cache statistics before and after are only computed when report is set
+void optimizeMesh(LoadedMesh& mesh, MeshOptimizationReport* report = nullptr);
@@ -0,0 +1,440 @@
+#include "meshSimplifier.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+#include "meshOptimizer.hpp"
+#include "utility.hpp"
+
+namespace
+{
+	// open borders are held in place by planes perpendicular to them, weighted against the surface planes
+	double constexpr borderWeight = 10.0;
+	// a collapse can rotate kept triangles by at most 60 degrees, rotations accumulate over passes
+	double constexpr minNormalCosine = 0.5;
+
+	struct Quadric
+	{
+		// symmetric 4x4 matrix, upper triangle
+		double a00 = 0.0, a01 = 0.0, a02 = 0.0, a03 = 0.0;
+		double a11 = 0.0, a12 = 0.0, a13 = 0.0;
+		double a22 = 0.0, a23 = 0.0;
+		double a33 = 0.0;
+		double weight = 0.0;
+
+		void addPlane(glm::dvec3 n, double d, double w)
+		{
+			a00 += w * n.x * n.x; a01 += w * n.x * n.y; a02 += w * n.x * n.z; a03 += w * n.x * d;
+			a11 += w * n.y * n.y; a12 += w * n.y * n.z; a13 += w * n.y * d;
+			a22 += w * n.z * n.z; a23 += w * n.z * d;
+			a33 += w * d * d;
+			weight += w;
+		}
+
+		Quadric& operator+=(Quadric const& q)
+		{
+			a00 += q.a00; a01 += q.a01; a02 += q.a02; a03 += q.a03;
+			a11 += q.a11; a12 += q.a12; a13 += q.a13;
+			a22 += q.a22; a23 += q.a23;
+			a33 += q.a33;
+			weight += q.weight;
+			return *this;
+		}
+
+		// weighted mean of the squared distances from p to the accumulated planes
+		double evaluate(glm::dvec3 p) const
+		{
+			double const r = a00 * p.x * p.x + 2.0 * a01 * p.x * p.y + 2.0 * a02 * p.x * p.z + 2.0 * a03 * p.x
+				+ a11 * p.y * p.y + 2.0 * a12 * p.y * p.z + 2.0 * a13 * p.y
+				+ a22 * p.z * p.z + 2.0 * a23 * p.z
+				+ a33;
+			return weight > 0.0 ? std::abs(r) / weight : 0.0;
+		}
+	};
+
+	// edge between two position groups, a < b
+	struct Edge
+	{
+		uint32 a;
+		uint32 b;
+		// triangles sharing the edge, 1 on open borders
+		uint32 triangleCount;
+		uint32 triangle;
+		double cost;
+	};
+}
+
+std::vector<uint32> buildPositionGroups(std::span<LoadedMesh::Vertex const> vertices)
+{
+	std::vector<uint32> order(vertices.size());
+	std::iota(order.begin(), order.end(), 0);
+	
+	// compared as raw bytes like the import deduplication
+	auto const comparePositions = [&](uint32 a, uint32 b)
+	{
+		return memcmp(&vertices[a].pos, &vertices[b].pos, sizeof(glm::vec3));
+	};
+	std::sort(order.begin(), order.end(), [&](uint32 a, uint32 b) { return comparePositions(a, b) < 0; });
+
+	std::vector<uint32> groups(vertices.size());
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		bool const sameAsPrevious = i > 0 && comparePositions(order[i], order[i - 1]) == 0;
+		groups[order[i]] = sameAsPrevious ? groups[order[i - 1]] : order[i];
+	}
+	return groups;
+}
+
+std::vector<uint32> simplifyMesh(std::span<LoadedMesh::Vertex const> vertices, std::span<uint32 const> indices, size_t targetIndexCount, float* error)
+{
+	return simplifyMesh(vertices, buildPositionGroups(vertices), indices, targetIndexCount, error);
+}
+
+std::vector<uint32> simplifyMesh(std::span<LoadedMesh::Vertex const> vertices, std::span<uint32 const> positionGroups, std::span<uint32 const> indices, size_t targetIndexCount, float* error)
+{
+	// work on the vertices referenced by indices only, renumbered in their order in the vertex buffer
+	// so the simplification of a submesh does not scale with the whole mesh
+	std::vector<uint32> usedVertices(indices.begin(), indices.end());
+	std::sort(usedVertices.begin(), usedVertices.end());
+	usedVertices.erase(std::unique(usedVertices.begin(), usedVertices.end()), usedVertices.end());
+	size_t const vertexCount = usedVertices.size();
+
+	std::vector<uint32> result(indices.size());
+	for (size_t i = 0; i < indices.size(); i++)
+		result[i] = static_cast<uint32>(std::lower_bound(usedVertices.begin(), usedVertices.end(), indices[i]) - usedVertices.begin());
+
+	// the first used vertex of a position group stands for the group
+	std::vector<uint32> groups(vertexCount);
+	{
+		std::vector<uint32> order(vertexCount);
+		std::iota(order.begin(), order.end(), 0);
+		std::sort(order.begin(), order.end(), [&](uint32 a, uint32 b) { return positionGroups[usedVertices[a]] < positionGroups[usedVertices[b]]; });
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			bool const sameAsPrevious = i > 0 && positionGroups[usedVertices[order[i]]] == positionGroups[usedVertices[order[i - 1]]];
+			groups[order[i]] = sameAsPrevious ? groups[order[i - 1]] : order[i];
+		}
+	}
+
+	double maxCost = 0.0;
+	auto const position = [&](uint32 group) { return glm::dvec3(vertices[usedVertices[group]].pos); };
+
+	std::vector<Edge> edges;
+	auto const buildEdges = [&]()
+	{
+		edges.clear();
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			for (uint32 k = 0; k < 3; k++)
+			{
+				uint32 const a = groups[result[i + k]];
+				uint32 const b = groups[result[i + (k + 1) % 3]];
+				edges.push_back({ std::min(a, b), std::max(a, b), 1, static_cast<uint32>(i / 3), 0.0 });
+			}
+		}
+		
+		std::sort(edges.begin(), edges.end(), [](Edge const& l, Edge const& r) { return l.a != r.a ? l.a < r.a : l.b < r.b; });
+		
+		size_t unique = 0;
+		for (size_t i = 0; i < edges.size(); i++)
+		{
+			if (unique > 0 && edges[unique - 1].a == edges[i].a && edges[unique - 1].b == edges[i].b)
+				edges[unique - 1].triangleCount++;
+			else
+				edges[unique++] = edges[i];
+		}
+		edges.resize(unique);
+	};
+
+	auto const triangleNormal = [&](uint32 triangle)
+	{
+		uint32 const* tri = &result[triangle * 3];
+		glm::dvec3 const p0 = position(groups[tri[0]]);
+		return glm::cross(position(groups[tri[1]]) - p0, position(groups[tri[2]]) - p0);
+	};
+
+	// quadrics of the input surface, collapses merge them
+	std::vector<Quadric> quadrics(vertexCount);
+	buildEdges();
+	for (uint32 t = 0; t < result.size() / 3; t++)
+	{
+		glm::dvec3 n = triangleNormal(t);
+		double const length = glm::length(n);
+		if (length == 0.0)
+			continue;
+
+		n /= length;
+		double const d = -glm::dot(n, position(groups[result[t * 3]]));
+		for (uint32 k = 0; k < 3; k++)
+			quadrics[groups[result[t * 3 + k]]].addPlane(n, d, length * 0.5);
+	}
+	for (auto const& edge : edges)
+	{
+		if (edge.triangleCount != 1)
+			continue;
+
+		glm::dvec3 const e = position(edge.b) - position(edge.a);
+		glm::dvec3 const perpendicular = glm::cross(e, triangleNormal(edge.triangle));
+		double const length = glm::length(perpendicular);
+		if (length == 0.0)
+			continue;
+
+		glm::dvec3 const n = perpendicular / length;
+		double const d = -glm::dot(n, position(edge.a));
+		quadrics[edge.a].addPlane(n, d, glm::dot(e, e) * borderWeight);
+		quadrics[edge.b].addPlane(n, d, glm::dot(e, e) * borderWeight);
+	}
+
+	std::vector<uint32> triangleOffsets(vertexCount + 1);
+	std::vector<uint32> groupTriangles;
+	std::vector<uint32> wedgeRemap(vertexCount);
+	std::vector<uint8> isBorder(vertexCount);
+	std::vector<uint8> isLocked(vertexCount);
+	std::vector<uint8> touched(vertexCount);
+	std::vector<std::pair<uint32, uint32>> wedgeMapping;
+
+	while (result.size() > targetIndexCount)
+	{
+		// group -> triangles
+		std::fill(triangleOffsets.begin(), triangleOffsets.end(), 0);
+		for (uint32 const index : result)
+			triangleOffsets[groups[index] + 1]++;
+		for (size_t g = 0; g < vertexCount; g++)
+			triangleOffsets[g + 1] += triangleOffsets[g];
+		groupTriangles.resize(result.size());
+		{
+			std::vector<uint32> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+			for (size_t i = 0; i < result.size(); i++)
+				groupTriangles[fill[groups[result[i]]]++] = static_cast<uint32>(i / 3);
+		}
+
+		// open borders can only collapse along themselves, non manifold vertices never move
+		std::fill(isBorder.begin(), isBorder.end(), 0);
+		std::fill(isLocked.begin(), isLocked.end(), 0);
+		for (auto const& edge : edges)
+		{
+			if (edge.triangleCount == 1)
+				isBorder[edge.a] = isBorder[edge.b] = 1;
+			else if (edge.triangleCount > 2)
+				isLocked[edge.a] = isLocked[edge.b] = 1;
+		}
+
+		for (auto& edge : edges)
+		{
+			Quadric q = quadrics[edge.a];
+			q += quadrics[edge.b];
+			edge.cost = std::min(q.evaluate(position(edge.a)), q.evaluate(position(edge.b)));
+		}
+		std::sort(edges.begin(), edges.end(), [](Edge const& l, Edge const& r) { return l.cost < r.cost; });
+
+		std::iota(wedgeRemap.begin(), wedgeRemap.end(), 0);
+		std::fill(touched.begin(), touched.end(), 0);
+
+		auto const tryCollapse = [&](uint32 src, uint32 dst, Edge const& edge)
+		{
+			if (isLocked[src] || (isBorder[src] && edge.triangleCount != 1))
+				return false;
+
+			// every wedge of src must map to a single wedge of dst it shares a triangle with, this keeps attribute seams intact
+			wedgeMapping.clear();
+			for (uint32 i = triangleOffsets[src]; i < triangleOffsets[src + 1]; i++)
+			{
+				uint32 const* tri = &result[groupTriangles[i] * 3];
+				uint32 srcWedge = UINT32_MAX, dstWedge = UINT32_MAX;
+				for (uint32 k = 0; k < 3; k++)
+				{
+					if (groups[tri[k]] == src)
+						srcWedge = tri[k];
+					else if (groups[tri[k]] == dst)
+						dstWedge = tri[k];
+				}
+				
+				auto const it = std::find_if(wedgeMapping.begin(), wedgeMapping.end(), [&](auto const& m) { return m.first == srcWedge; });
+				if (it == wedgeMapping.end())
+					wedgeMapping.push_back({ srcWedge, dstWedge });
+				else if (it->second == UINT32_MAX)
+					it->second = dstWedge;
+				else if (dstWedge != UINT32_MAX && it->second != dstWedge)
+					return false;
+			}
+			
+			for (auto const& [srcWedge, dstWedge] : wedgeMapping)
+			{
+				if (dstWedge == UINT32_MAX)
+					return false;
+			}
+
+			// triangles kept around src must not flip
+			glm::dvec3 const dstPosition = position(dst);
+			for (uint32 i = triangleOffsets[src]; i < triangleOffsets[src + 1]; i++)
+			{
+				uint32 const* tri = &result[groupTriangles[i] * 3];
+				glm::dvec3 p[3];
+				glm::dvec3 moved[3];
+				bool removed = false;
+				for (uint32 k = 0; k < 3; k++)
+				{
+					uint32 const g = groups[tri[k]];
+					removed |= g == dst;
+					p[k] = position(g);
+					moved[k] = g == src ? dstPosition : p[k];
+				}
+				if (removed)
+					continue;
+				
+				glm::dvec3 const before = glm::cross(p[1] - p[0], p[2] - p[0]);
+				glm::dvec3 const after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+				if (glm::dot(before, after) <= minNormalCosine * glm::length(before) * glm::length(after))
+					return false;
+			}
+
+			return true;
+		};
+
+		size_t const trianglesToRemove = (result.size() - targetIndexCount + 2) / 3;
+		size_t removedTriangles = 0;
+		
+		for (auto const& edge : edges)
+		{
+			if (removedTriangles >= trianglesToRemove)
+				break;
+			if (touched[edge.a] || touched[edge.b])
+				continue;
+
+			Quadric q = quadrics[edge.a];
+			q += quadrics[edge.b];
+			double const costAB = q.evaluate(position(edge.b));
+			double const costBA = q.evaluate(position(edge.a));
+			
+			// cheapest direction first
+			uint32 src = edge.a, dst = edge.b;
+			double cost = costAB;
+			if (costBA < costAB)
+			{
+				std::swap(src, dst);
+				cost = costBA;
+			}
+			
+			if (!tryCollapse(src, dst, edge))
+			{
+				std::swap(src, dst);
+				cost = std::max(costAB, costBA);
+				if (!tryCollapse(src, dst, edge))
+					continue;
+			}
+
+			for (auto const& [srcWedge, dstWedge] : wedgeMapping)
+				wedgeRemap[srcWedge] = dstWedge;
+			quadrics[dst] += quadrics[src];
+			maxCost = std::max(maxCost, cost);
+			removedTriangles += edge.triangleCount;
+
+			// the one ring of src changed shape, it must not be collapsed again in this pass
+			for (uint32 i = triangleOffsets[src]; i < triangleOffsets[src + 1]; i++)
+			{
+				uint32 const* tri = &result[groupTriangles[i] * 3];
+				touched[groups[tri[0]]] = touched[groups[tri[1]]] = touched[groups[tri[2]]] = 1;
+			}
+		}
+
+		if (removedTriangles == 0)
+			break;
+
+		// apply the collapses and drop the triangles that became degenerated
+		size_t kept = 0;
+		for (size_t i = 0; i < result.size(); i += 3)
+		{
+			uint32 const i0 = wedgeRemap[result[i + 0]];
+			uint32 const i1 = wedgeRemap[result[i + 1]];
+			uint32 const i2 = wedgeRemap[result[i + 2]];
+			if (groups[i0] == groups[i1] || groups[i1] == groups[i2] || groups[i0] == groups[i2])
+				continue;
+
+			result[kept++] = i0;
+			result[kept++] = i1;
+			result[kept++] = i2;
+		}
+		result.resize(kept);
+		buildEdges();
+	}
+
+	for (uint32& index : result)
+		index = usedVertices[index];
+
+	if (error)
+		*error = static_cast<float>(std::sqrt(maxCost));
+	return result;
+}
+
+void generateLods(LoadedMesh& mesh, LodOptions const& options)
+{
+	std::vector<Submesh> const baseSubmeshes = getBaseSubmeshes(mesh);
+	
+	// levels are always simplified from the full resolution one
+	if (!mesh.lods.empty())
+	{
+		mesh.indices.resize(mesh.lods[0].indexCount);
+		if (!mesh.submeshes.empty())
+			mesh.submeshes.resize(baseSubmeshes.size());
+	}
+	
+	std::vector<uint32> const baseIndices = mesh.indices;
+	std::vector<uint32> const positionGroups = buildPositionGroups(mesh.vertices);
+	mesh.lods.clear();
+	mesh.lods.push_back({ 0, static_cast<uint32>(baseIndices.size()), 0.0f });
+
+	float ratio = 1.0f;
+	for (uint32 lod = 1; lod < options.maxLodCount; lod++)
+	{
+		ratio *= options.reduction;
+
+		// submeshes are simplified separately, their boundaries are open borders and stay in place
+		std::vector<uint32> lodIndices;
+		std::vector<Submesh> lodSubmeshes;
+		float lodError = 0.0f;
+		for (auto const& submesh : baseSubmeshes)
+		{
+			size_t const targetTriangles = static_cast<size_t>(submesh.indexCount / 3 * ratio);
+			
+			float error = 0.0f;
+			std::vector<uint32> submeshIndices = simplifyMesh(mesh.vertices, positionGroups, std::span(baseIndices).subspan(submesh.firstIndex, submesh.indexCount), targetTriangles * 3, &error);
+			optimizeVertexCache(submeshIndices, mesh.vertices.size());
+			
+			lodSubmeshes.push_back({ static_cast<uint32>(mesh.indices.size() + lodIndices.size()), static_cast<uint32>(submeshIndices.size()), submesh.materialId, submesh.bounds });
+			lodIndices.insert(lodIndices.end(), submeshIndices.begin(), submeshIndices.end());
+			lodError = std::max(lodError, error);
+		}
+		
+		if (lodIndices.empty() || lodIndices.size() > mesh.lods.back().indexCount * options.minReduction)
+			break;
+
+		mesh.lods.push_back({ static_cast<uint32>(mesh.indices.size()), static_cast<uint32>(lodIndices.size()), lodError });
+		mesh.indices.insert(mesh.indices.end(), lodIndices.begin(), lodIndices.end());
+		if (!mesh.submeshes.empty())
+			mesh.submeshes.insert(mesh.submeshes.end(), lodSubmeshes.begin(), lodSubmeshes.end());
+	}
+}
+
+void generateLods(std::span<LoadedMesh> meshes, LodOptions const& options)
+{
+	parallelFor(meshes.size(), [&](size_t i)
+	{
+		generateLods(meshes[i], options);
+	});
+}
+
+uint32 selectLod(std::span<MeshLod const> lods, float distance, float projectionScale, float modelScale, float pixelThreshold)
+{
+	if (lods.empty())
+		return 0;
+
+	// errors grow with the level
+	float const pixelsPerUnit = projectionScale * modelScale / std::max(distance, std::numeric_limits<float>::epsilon());
+	uint32 lod = 0;
+	while (lod + 1 < lods.size() && lods[lod + 1].error * pixelsPerUnit <= pixelThreshold)
+		lod++;
+	return lod;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include "ice.hpp"
+#include "mesh.hpp"
+
+// Quadric error metric edge collapse simplification (Garland & Heckbert, Surface Simplification Using Quadric Error Metrics)
+// Vertices are only collapsed onto existing ones so the result indexes the same vertex buffer.
+// Vertices sharing a position are simplified together, attribute seams and open borders can only collapse along themselves.
+// Return the simplified indices, error receives the largest collapse error in mesh units.
+std::vector<uint32> simplifyMesh(std::span<LoadedMesh::Vertex const> vertices, std::span<uint32 const> indices, size_t targetIndexCount, float* error = nullptr);
+// same with the position groups of buildPositionGroups, computed once when several index ranges of a mesh are simplified
+std::vector<uint32> simplifyMesh(std::span<LoadedMesh::Vertex const> vertices, std::span<uint32 const> positionGroups, std::span<uint32 const> indices, size_t targetIndexCount, float* error = nullptr);
+
+// Vertices with the same position get the index of the first of them as group, they are moved together
+std::vector<uint32> buildPositionGroups(std::span<LoadedMesh::Vertex const> vertices);
+
+struct LodOptions
+{
+	// including the full resolution level
+	uint32 maxLodCount = 5;
+	// target triangle count of a level relative to the previous one
+	float reduction = 0.5f;
+	// stop when a level could not get under this ratio of the previous one
+	float minReduction = 0.85f;
+};
+
+// Append simplified levels of the first level of detail to mesh.indices and fill mesh.lods, submeshes are simplified separately
+// Must be called after buildMeshlets since it reorders the index buffer.
+void generateLods(LoadedMesh& mesh, LodOptions const& options = {});
+// meshes are processed in parallel
+void generateLods(std::span<LoadedMesh> meshes, LodOptions const& options = {});
+
+// Coarsest level whose error projected on screen stays under pixelThreshold
+// projectionScale is proj[1][1] * viewportHeight / 2, distance is the view depth of the mesh and lod errors are scaled by modelScale
+uint32 selectLod(std::span<MeshLod const> lods, float distance, float projectionScale, float modelScale = 1.0f, float pixelThreshold = 1.0f);
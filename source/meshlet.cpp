@@ -0,0 +1,302 @@
+#include "meshlet.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+	uint8 constexpr notInMeshlet = 0xff;
+	// bound the candidates pushed by very high valence vertices
+	uint32 constexpr maxCandidatesPerVertex = 64;
+	// wider normal cones would hardly ever cull anything
+	float constexpr minConeDot = 0.1f;
+
+	static_assert(maxMeshletVertices < notInMeshlet);
+}
+
+static void computeMeshletBounds(Meshlet& meshlet, LoadedMesh const& mesh, std::span<uint32 const> meshletIndices, std::span<uint32 const> meshletVertices)
+{
+	// Ritter bounding sphere
+	auto const farthestFrom = [&](glm::vec3 p)
+	{
+		glm::vec3 farthest = p;
+		float maxDist = -1.0f;
+		for (uint32 const v : meshletVertices)
+		{
+			float const dist = glm::dot(mesh.vertices[v].pos - p, mesh.vertices[v].pos - p);
+			if (dist > maxDist)
+			{
+				maxDist = dist;
+				farthest = mesh.vertices[v].pos;
+			}
+		}
+		return farthest;
+	};
+
+	glm::vec3 const a = farthestFrom(mesh.vertices[meshletVertices[0]].pos);
+	glm::vec3 const b = farthestFrom(a);
+	glm::vec3 center = (a + b) * 0.5f;
+	float radius = glm::length(b - a) * 0.5f;
+
+	for (uint32 const v : meshletVertices)
+	{
+		float const dist = glm::length(mesh.vertices[v].pos - center);
+		if (dist > radius)
+		{
+			float const newRadius = (radius + dist) * 0.5f;
+			center += (mesh.vertices[v].pos - center) * ((newRadius - radius) / dist);
+			radius = newRadius;
+		}
+	}
+	
+	meshlet.center = center;
+	meshlet.radius = radius;
+
+	// normal cone from the face normals, counter clockwise triangles are front facing
+	glm::vec3 axis(0.0f);
+	uint32 faceCount = 0;
+	std::array<glm::vec3, maxMeshletTriangles> normals;
+	for (size_t i = 0; i < meshletIndices.size(); i += 3)
+	{
+		glm::vec3 const p0 = mesh.vertices[meshletIndices[i + 0]].pos;
+		glm::vec3 const n = glm::cross(mesh.vertices[meshletIndices[i + 1]].pos - p0, mesh.vertices[meshletIndices[i + 2]].pos - p0);
+		float const length = glm::length(n);
+		// degenerated triangles are never rasterized
+		if (length == 0.0f)
+			continue;
+
+		normals[faceCount] = n / length;
+		axis += normals[faceCount];
+		faceCount++;
+	}
+	
+	float const axisLength = glm::length(axis);
+	meshlet.coneAxis = axisLength > 0.0f ? axis / axisLength : glm::vec3(0.0f, 0.0f, 1.0f);
+	meshlet.coneCutoff = 1.0f;
+	
+	if (faceCount == 0 || axisLength == 0.0f)
+		return;
+
+	float minDot = 1.0f;
+	for (uint32 i = 0; i < faceCount; i++)
+		minDot = std::min(minDot, glm::dot(normals[i], meshlet.coneAxis));
+
+	// sin of the cone half angle, the back face test is done against the view vector
+	if (minDot > minConeDot)
+		meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+void buildMeshlets(LoadedMesh& mesh)
+{
+	mesh.meshlets.clear();
+	
+	size_t const triangleCount = mesh.indices.size() / 3;
+	size_t const vertexCount = mesh.vertices.size();
+	if (triangleCount == 0)
+		return;
+
+	// vertex -> triangles adjacency
+	std::vector<uint32> adjacencyOffsets(vertexCount + 1, 0);
+	for (uint32 const index : mesh.indices)
+		adjacencyOffsets[index + 1]++;
+	for (size_t v = 0; v < vertexCount; v++)
+		adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+
+	std::vector<uint32> adjacency(mesh.indices.size());
+	{
+		std::vector<uint32> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < mesh.indices.size(); i++)
+			adjacency[fill[mesh.indices[i]]++] = static_cast<uint32>(i / 3);
+	}
+
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint8> localIndex(vertexCount, notInMeshlet);
+	
+	std::vector<uint32> reordered;
+	reordered.reserve(mesh.indices.size());
+
+	std::vector<uint32> meshletVertices;
+	meshletVertices.reserve(maxMeshletVertices);
+	std::vector<uint32> candidates;
+	glm::vec3 positionSum(0.0f);
+	size_t scanCursor = 0;
+	uint32 meshletBegin = 0;
+
+	auto const flushMeshlet = [&]()
+	{
+		Meshlet meshlet;
+		meshlet.firstIndex = meshletBegin;
+		meshlet.indexCount = static_cast<uint32>(reordered.size()) - meshletBegin;
+		meshlet.vertexCount = static_cast<uint32>(meshletVertices.size());
+		computeMeshletBounds(meshlet, mesh, std::span(reordered).subspan(meshletBegin), meshletVertices);
+		mesh.meshlets.push_back(meshlet);
+
+		for (uint32 const v : meshletVertices)
+			localIndex[v] = notInMeshlet;
+		meshletVertices.clear();
+		candidates.clear();
+		positionSum = glm::vec3(0.0f);
+		meshletBegin = static_cast<uint32>(reordered.size());
+	};
+
+	auto const newVertexCount = [&](uint32 triangle)
+	{
+		uint32 const* tri = &mesh.indices[triangle * 3];
+		uint32 count = 0;
+		for (uint32 k = 0; k < 3; k++)
+		{
+			// degenerated triangles can reference the same vertex twice
+			bool const duplicate = (k > 0 && tri[k] == tri[0]) || (k > 1 && tri[k] == tri[1]);
+			count += localIndex[tri[k]] == notInMeshlet && !duplicate;
+		}
+		return count;
+	};
+
+	// meshlets never cross submeshes so they can be drawn with their submesh material
+	for (auto const& submesh : getBaseSubmeshes(mesh))
+	{
+		uint32 const firstTriangle = submesh.firstIndex / 3;
+		uint32 const lastTriangle = firstTriangle + submesh.indexCount / 3;
+		scanCursor = firstTriangle;
+		
+		for (uint32 n = firstTriangle; n < lastTriangle; n++)
+		{
+			// prefer the adjacent triangle adding the fewest vertices, then the closest one to the meshlet centroid
+			uint32 bestTriangle = UINT32_MAX;
+			uint32 bestNewVertices = 4;
+			float bestDistance = std::numeric_limits<float>::max();
+			glm::vec3 const centroid = meshletVertices.empty() ? glm::vec3(0.0f) : positionSum / static_cast<float>(meshletVertices.size());
+
+			std::erase_if(candidates, [&](uint32 t) { return emitted[t]; });
+			for (uint32 const t : candidates)
+			{
+				uint32 const newVertices = newVertexCount(t);
+				if (meshletVertices.size() + newVertices > maxMeshletVertices || newVertices > bestNewVertices)
+					continue;
+
+				uint32 const* tri = &mesh.indices[t * 3];
+				glm::vec3 const triCenter = (mesh.vertices[tri[0]].pos + mesh.vertices[tri[1]].pos + mesh.vertices[tri[2]].pos) / 3.0f;
+				float const distance = glm::dot(triCenter - centroid, triCenter - centroid);
+				if (newVertices < bestNewVertices || distance < bestDistance)
+				{
+					bestTriangle = t;
+					bestNewVertices = newVertices;
+					bestDistance = distance;
+				}
+			}
+		
+			if (bestTriangle == UINT32_MAX)
+			{
+				// nothing adjacent fits, continue with the next triangle in input order
+				while (emitted[scanCursor])
+					scanCursor++;
+			
+				if (meshletVertices.size() + newVertexCount(static_cast<uint32>(scanCursor)) > maxMeshletVertices)
+					flushMeshlet();
+				bestTriangle = static_cast<uint32>(scanCursor);
+			}
+
+			uint32 const* tri = &mesh.indices[bestTriangle * 3];
+			emitted[bestTriangle] = true;
+			for (uint32 k = 0; k < 3; k++)
+			{
+				uint32 const v = tri[k];
+				reordered.push_back(v);
+				if (localIndex[v] != notInMeshlet)
+					continue;
+
+				localIndex[v] = static_cast<uint8>(meshletVertices.size());
+				meshletVertices.push_back(v);
+				positionSum += mesh.vertices[v].pos;
+
+				uint32 const begin = adjacencyOffsets[v];
+				uint32 const end = std::min(adjacencyOffsets[v + 1], begin + maxCandidatesPerVertex);
+				for (uint32 i = begin; i < end; i++)
+				{
+					uint32 const t = adjacency[i];
+					if (!emitted[t] && t >= firstTriangle && t < lastTriangle)
+						candidates.push_back(t);
+				}
+			}
+
+			if (reordered.size() - meshletBegin == maxMeshletTriangles * 3)
+				flushMeshlet();
+		}
+
+		if (reordered.size() > meshletBegin)
+			flushMeshlet();
+	}
+
+	// levels of detail built before are left as is
+	reordered.insert(reordered.end(), mesh.indices.begin() + reordered.size(), mesh.indices.end());
+	mesh.indices = std::move(reordered);
+}
+
+std::span<Meshlet const> getSubmeshMeshlets(std::span<Meshlet const> meshlets, Submesh const& submesh)
+{
+	// meshlets are sorted by firstIndex and never cross submeshes
+	auto const byFirstIndex = [](Meshlet const& meshlet, uint32 index) { return meshlet.firstIndex < index; };
+	auto const begin = std::lower_bound(meshlets.begin(), meshlets.end(), submesh.firstIndex, byFirstIndex);
+	auto const end = std::lower_bound(begin, meshlets.end(), submesh.firstIndex + submesh.indexCount, byFirstIndex);
+	return { begin, end };
+}
+
+Frustum::Frustum(glm::mat4 const& m)
+{
+	// Gribb & Hartmann, rows of the clip matrix
+	glm::vec4 const row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+	glm::vec4 const row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+	glm::vec4 const row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+	glm::vec4 const row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+	planes[0] = row3 + row0;
+	planes[1] = row3 - row0;
+	planes[2] = row3 + row1;
+	planes[3] = row3 - row1;
+	planes[4] = row3 + row2;
+	planes[5] = row3 - row2;
+
+	for (auto& plane : planes)
+		plane /= glm::length(glm::vec3(plane));
+}
+
+bool Frustum::intersectsSphere(glm::vec3 center, float radius) const noexcept
+{
+	for (auto const& plane : planes)
+	{
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -radius)
+			return false;
+	}
+	return true;
+}
+
+MeshletCullStats cullMeshlets(std::span<Meshlet const> meshlets, Frustum const& frustum, glm::vec3 eye, std::vector<IndexRange>& visibleRanges)
+{
+	MeshletCullStats stats;
+	
+	for (auto const& meshlet : meshlets)
+	{
+		if (!frustum.intersectsSphere(meshlet.center, meshlet.radius))
+		{
+			stats.frustumCulled++;
+			continue;
+		}
+
+		glm::vec3 const toCenter = meshlet.center - eye;
+		if (glm::dot(toCenter, meshlet.coneAxis) >= meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius)
+		{
+			stats.coneCulled++;
+			continue;
+		}
+
+		stats.visible++;
+		if (!visibleRanges.empty() && visibleRanges.back().firstIndex + visibleRanges.back().indexCount == meshlet.firstIndex)
+			visibleRanges.back().indexCount += meshlet.indexCount;
+		else
+			visibleRanges.push_back({ meshlet.firstIndex, meshlet.indexCount, 0 });
+	}
+	
+	return stats;
+}
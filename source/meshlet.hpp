@@ -0,0 +1,41 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "ice.hpp"
+#include "mesh.hpp"
+
+uint32 constexpr maxMeshletVertices = 64;
+uint32 constexpr maxMeshletTriangles = 124;
+
+// Split the mesh in meshlets of at most maxMeshletVertices vertices and maxMeshletTriangles triangles
+// Triangles are greedily grown from adjacent ones adding the fewest new vertices, mesh.indices is reordered
+// so each meshlet is a contiguous range, vertices are left untouched. Must be called before generateLods.
+void buildMeshlets(LoadedMesh& mesh);
+
+// Meshlets of a first level submesh
+std::span<Meshlet const> getSubmeshMeshlets(std::span<Meshlet const> meshlets, Submesh const& submesh);
+
+// Frustum planes extracted from a clip matrix, normals point inward
+// With proj * view * model the planes are in mesh space, near is the OpenGL one so it is conservative for [0, 1] depth
+struct Frustum
+{
+	explicit Frustum(glm::mat4 const& viewProj);
+
+	[[nodiscard]] bool intersectsSphere(glm::vec3 center, float radius) const noexcept;
+	
+	glm::vec4 planes[6];
+};
+
+struct MeshletCullStats
+{
+	uint32 frustumCulled = 0;
+	uint32 coneCulled = 0;
+	uint32 visible = 0;
+};
+
+// Append the index ranges of the meshlets visible from eye, consecutive visible meshlets are merged in a single range
+// frustum and eye must be in mesh space, both tests are exact under any affine model matrix this way
+MeshletCullStats cullMeshlets(std::span<Meshlet const> meshlets, Frustum const& frustum, glm::vec3 eye, std::vector<IndexRange>& visibleRanges);
@@ -0,0 +1,195 @@
+#include "mipGenerator.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "utility.hpp"
+#include "vkhUtility.hpp"
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define ICE_MIPS_SSE 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	// rows of a level filtered by a single task
+	uint32 constexpr rowsPerTask = 32;
+
+	struct TexelLayout
+	{
+		// 8 bit channels, 0 for unsupported formats
+		uint32 channels = 0;
+		// the first srgbChannels channels are sRGB encoded, alpha never is
+		uint32 srgbChannels = 0;
+	};
+
+	TexelLayout getTexelLayout(vk::Format format) noexcept
+	{
+		switch (format)
+		{
+		case vk::Format::eR8Unorm:
+		case vk::Format::eR8Uint:
+			return { 1, 0 };
+		case vk::Format::eR8Srgb:
+			return { 1, 1 };
+		case vk::Format::eR8G8Unorm:
+		case vk::Format::eR8G8Uint:
+			return { 2, 0 };
+		case vk::Format::eR8G8Srgb:
+			return { 2, 2 };
+		case vk::Format::eR8G8B8Unorm:
+		case vk::Format::eR8G8B8Uint:
+		case vk::Format::eB8G8R8Unorm:
+		case vk::Format::eB8G8R8Uint:
+			return { 3, 0 };
+		case vk::Format::eR8G8B8Srgb:
+		case vk::Format::eB8G8R8Srgb:
+			return { 3, 3 };
+		case vk::Format::eR8G8B8A8Unorm:
+		case vk::Format::eR8G8B8A8Uint:
+		case vk::Format::eB8G8R8A8Unorm:
+		case vk::Format::eB8G8R8A8Uint:
+			return { 4, 0 };
+		case vk::Format::eR8G8B8A8Srgb:
+		case vk::Format::eB8G8R8A8Srgb:
+			return { 4, 3 };
+		default:
+			return {};
+		}
+	}
+
+	struct SrgbTables
+	{
+		std::array<float, 256> toLinear;
+		// indexed by linear values quantized to 12 bits
+		std::array<uint8, 4096> fromLinear;
+
+		SrgbTables()
+		{
+			for (uint32 i = 0; i < toLinear.size(); i++)
+			{
+				float const c = i / 255.0f;
+				toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+			}
+			for (uint32 i = 0; i < fromLinear.size(); i++)
+			{
+				float const l = i / 4095.0f;
+				float const c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+				fromLinear[i] = static_cast<uint8>(std::clamp(c * 255.0f + 0.5f, 0.0f, 255.0f));
+			}
+		}
+	};
+
+	SrgbTables const& getSrgbTables()
+	{
+		static SrgbTables const tables;
+		return tables;
+	}
+
+	// filter rows [rowBegin, rowEnd) of dst from the level above it
+	void downsampleRows(uint8 const* src, uint32 srcWidth, uint32 srcHeight, uint8* dst, uint32 dstWidth, uint32 rowBegin, uint32 rowEnd, TexelLayout layout)
+	{
+		uint32 const channels = layout.channels;
+		size_t const srcPitch = size_t(srcWidth) * channels;
+		size_t const dstPitch = size_t(dstWidth) * channels;
+		SrgbTables const* const srgb = layout.srgbChannels > 0 ? &getSrgbTables() : nullptr;
+
+		for (uint32 y = rowBegin; y < rowEnd; y++)
+		{
+			uint8 const* const row0 = src + std::min(2 * y, srcHeight - 1) * srcPitch;
+			uint8 const* const row1 = src + std::min(2 * y + 1, srcHeight - 1) * srcPitch;
+			uint8* const out = dst + y * dstPitch;
+
+			uint32 x = 0;
+#if ICE_MIPS_SSE
+			if (channels == 4 && !srgb)
+			{
+				// 4 texels of both rows give 2 destination texels
+				__m128i const zero = _mm_setzero_si128();
+				__m128i const rounding = _mm_set1_epi16(2);
+				for (; 2 * x + 4 <= srcWidth && x + 2 <= dstWidth; x += 2)
+				{
+					__m128i const a = _mm_loadu_si128(reinterpret_cast<__m128i const*>(row0 + 8 * x));
+					__m128i const b = _mm_loadu_si128(reinterpret_cast<__m128i const*>(row1 + 8 * x));
+					// columns summed in 16 bit lanes, lo holds texels 0 and 1, hi texels 2 and 3
+					__m128i const lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+					__m128i const hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+					// texels 0 + 1 and 2 + 3
+					__m128i const sum = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+					__m128i const avg = _mm_srli_epi16(_mm_add_epi16(sum, rounding), 2);
+					_mm_storel_epi64(reinterpret_cast<__m128i*>(out + 4 * x), _mm_packus_epi16(avg, zero));
+				}
+			}
+#endif
+			for (; x < dstWidth; x++)
+			{
+				size_t const x0 = size_t(std::min(2 * x, srcWidth - 1)) * channels;
+				size_t const x1 = size_t(std::min(2 * x + 1, srcWidth - 1)) * channels;
+				for (uint32 c = 0; c < channels; c++)
+				{
+					uint8 const t0 = row0[x0 + c], t1 = row0[x1 + c], t2 = row1[x0 + c], t3 = row1[x1 + c];
+					if (c < layout.srgbChannels)
+					{
+						float const linear = (srgb->toLinear[t0] + srgb->toLinear[t1] + srgb->toLinear[t2] + srgb->toLinear[t3]) * 0.25f;
+						out[x * channels + c] = srgb->fromLinear[static_cast<uint32>(linear * 4095.0f + 0.5f)];
+					}
+					else
+					{
+						out[x * channels + c] = static_cast<uint8>((t0 + t1 + t2 + t3 + 2) >> 2);
+					}
+				}
+			}
+		}
+	}
+}
+
+bool canGenerateMipsOnCpu(vk::Format format) noexcept
+{
+	return getTexelLayout(format).channels > 0;
+}
+
+std::vector<uint8> generateMipChain(std::span<uint8 const> level0, uint32 width, uint32 height, vk::Format format, uint32 levelCount)
+{
+	TexelLayout const layout = getTexelLayout(format);
+	if (layout.channels == 0)
+		throw std::runtime_error("unsupported format for CPU mip generation");
+
+	vk::Extent3D const extent{ width, height, 1 };
+	assert(levelCount > 0 && levelCount <= vkh::getMipLevelCount(width, height));
+	assert(level0.size_bytes() >= vkh::getMipLevelSize(format, extent, 0));
+
+	std::vector<size_t> offsets(levelCount);
+	size_t size = 0;
+	for (uint32 level = 0; level < levelCount; level++)
+	{
+		offsets[level] = size;
+		size += vkh::getMipLevelSize(format, extent, level);
+	}
+
+	std::vector<uint8> chain(size);
+	memcpy(chain.data(), level0.data(), vkh::getMipLevelSize(format, extent, 0));
+
+	// each level is read from the previous one, rows of a level are independent
+	for (uint32 level = 1; level < levelCount; level++)
+	{
+		vk::Extent3D const srcExtent = vkh::getMipExtent(extent, level - 1);
+		vk::Extent3D const dstExtent = vkh::getMipExtent(extent, level);
+		uint8 const* const src = chain.data() + offsets[level - 1];
+		uint8* const dst = chain.data() + offsets[level];
+
+		uint32 const taskCount = (dstExtent.height + rowsPerTask - 1) / rowsPerTask;
+		parallelFor(taskCount, [&](size_t task)
+		{
+			uint32 const rowBegin = static_cast<uint32>(task) * rowsPerTask;
+			uint32 const rowEnd = std::min(rowBegin + rowsPerTask, dstExtent.height);
+			downsampleRows(src, srcExtent.width, srcExtent.height, dst, dstExtent.width, rowBegin, rowEnd, layout);
+		});
+	}
+
+	return chain;
+}
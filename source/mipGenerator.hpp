@@ -0,0 +1,16 @@
+#pragma once
+
+#include <span>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "ice.hpp"
+
+// CPU mip chain generation, used for formats the GPU cannot blit with a linear filter
+// 2x2 box filter on 8 bit unorm, uint and sRGB channels, sRGB color channels are averaged in linear space.
+// Odd sizes clamp the last row and column.
+
+[[nodiscard]] bool canGenerateMipsOnCpu(vk::Format format) noexcept;
+
+// return levelCount tightly packed levels, the first one being level0, throw on unsupported formats
+std::vector<uint8> generateMipChain(std::span<uint8 const> level0, uint32 width, uint32 height, vk::Format format, uint32 levelCount);
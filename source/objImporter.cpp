@@ -0,0 +1,502 @@
+#include "objImporter.hpp"
+
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <string_view>
+#include <tiny/tiny_obj_loader.h>
+
+#include "meshBounds.hpp"
+#include "utility.hpp"
+
+namespace
+{
+	size_t constexpr minChunkSize = 1 << 20;
+	int32 constexpr noIndex = std::numeric_limits<int32>::min();
+	// faces before the first usemtl of a chunk use the material the previous chunk ended with
+	uint32 constexpr inheritedMaterial = UINT32_MAX;
+
+	enum RelativeBits : uint8
+	{
+		RelativePosition = 1 << 0,
+		RelativeUv = 1 << 1,
+		RelativeNormal = 1 << 2,
+	};
+
+	// Face corner as written in the file, indices are 0 based and absolute unless their relative bit is set.
+	// Relative indices are resolved against the chunk element count and fixed up once chunk offsets are known.
+	struct Corner
+	{
+		int32 position = noIndex;
+		int32 uv = noIndex;
+		int32 normal = noIndex;
+		uint8 relative = 0;
+	};
+
+	struct Chunk
+	{
+		std::span<char const> text;
+
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec3> colors;
+		std::vector<glm::vec3> normals;
+		std::vector<glm::vec2> uvs;
+		std::vector<Corner> corners;
+		std::vector<uint32> faceSizes;
+		// index in usedMaterials or inheritedMaterial
+		std::vector<uint32> faceMaterials;
+		std::vector<std::string_view> usedMaterials;
+		std::vector<std::string_view> materialLibraries;
+
+		// material ids of usedMaterials and material in use when the chunk starts
+		std::vector<uint32> materialIds;
+		uint32 startMaterial = Submesh::noMaterial;
+
+		// where this chunk's attributes start in the merged attribute arrays
+		size_t positionOffset = 0;
+		size_t normalOffset = 0;
+		size_t uvOffset = 0;
+
+		// chunk local deduplicated geometry
+		std::vector<LoadedMesh::Vertex> vertices;
+		std::vector<uint32> indices;
+		std::vector<uint32> triangleMaterials;
+	};
+
+	struct Attributes
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<glm::vec3> colors;
+		std::vector<glm::vec3> normals;
+		std::vector<glm::vec2> uvs;
+	};
+}
+
+static bool isBlank(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r';
+}
+
+static char const* skipBlanks(char const* it, char const* end)
+{
+	while (it != end && isBlank(*it))
+		it++;
+	return it;
+}
+
+static std::string_view parseToken(char const*& it, char const* end)
+{
+	it = skipBlanks(it, end);
+	char const* const begin = it;
+	while (it != end && !isBlank(*it))
+		it++;
+	return { begin, static_cast<size_t>(it - begin) };
+}
+
+static bool parseFloat(char const*& it, char const* end, float& value)
+{
+	it = skipBlanks(it, end);
+	// from_chars does not accept an explicit plus sign
+	if (it != end && *it == '+')
+		it++;
+
+	auto const [ptr, ec] = std::from_chars(it, end, value);
+	if (ec != std::errc())
+		return false;
+	it = ptr;
+	return true;
+}
+
+static bool parseIndex(char const*& it, char const* end, size_t elementCount, uint8 relativeBit, int32& index, uint8& relative)
+{
+	int32 value;
+	auto const [ptr, ec] = std::from_chars(it, end, value);
+	if (ec != std::errc() || value == 0)
+		return false;
+	it = ptr;
+
+	if (value > 0)
+	{
+		index = value - 1;
+	}
+	else
+	{
+		// negative indices are relative to the elements read so far, may land in a previous chunk
+		index = static_cast<int32>(elementCount) + value;
+		relative |= relativeBit;
+	}
+	return true;
+}
+
+// v, v/vt, v//vn, v/vt/vn
+static bool parseCorner(char const*& it, char const* end, Chunk const& chunk, Corner& corner)
+{
+	if (!parseIndex(it, end, chunk.positions.size(), RelativePosition, corner.position, corner.relative))
+		return false;
+
+	if (it == end || *it != '/')
+		return true;
+	it++;
+
+	if (it != end && *it != '/')
+	{
+		if (!parseIndex(it, end, chunk.uvs.size(), RelativeUv, corner.uv, corner.relative))
+			return false;
+	}
+
+	if (it == end || *it != '/')
+		return true;
+	it++;
+
+	return parseIndex(it, end, chunk.normals.size(), RelativeNormal, corner.normal, corner.relative);
+}
+
+static void parseLine(Chunk& chunk, char const* it, char const* end)
+{
+	size_t const length = end - it;
+	if (length < 2)
+		return;
+
+	if (it[0] == 'v' && isBlank(it[1]))
+	{
+		it += 2;
+		glm::vec3 pos(0.0f);
+		parseFloat(it, end, pos.x);
+		parseFloat(it, end, pos.y);
+		parseFloat(it, end, pos.z);
+
+		// vertex color extension, white when absent like tinyobj
+		glm::vec3 color;
+		if (!(parseFloat(it, end, color.r) && parseFloat(it, end, color.g) && parseFloat(it, end, color.b)))
+			color = glm::vec3(1.0f);
+
+		chunk.positions.push_back(pos);
+		chunk.colors.push_back(color);
+	}
+	else if (length > 2 && it[0] == 'v' && it[1] == 'n' && isBlank(it[2]))
+	{
+		it += 3;
+		glm::vec3 normal(0.0f);
+		parseFloat(it, end, normal.x);
+		parseFloat(it, end, normal.y);
+		parseFloat(it, end, normal.z);
+		chunk.normals.push_back(normal);
+	}
+	else if (length > 2 && it[0] == 'v' && it[1] == 't' && isBlank(it[2]))
+	{
+		it += 3;
+		glm::vec2 uv(0.0f);
+		parseFloat(it, end, uv.x);
+		parseFloat(it, end, uv.y);
+		chunk.uvs.push_back(uv);
+	}
+	else if (it[0] == 'f' && isBlank(it[1]))
+	{
+		it += 2;
+		size_t const firstCorner = chunk.corners.size();
+		for (it = skipBlanks(it, end); it != end && *it != '#'; it = skipBlanks(it, end))
+		{
+			Corner corner;
+			if (!parseCorner(it, end, chunk, corner))
+				break;
+			chunk.corners.push_back(corner);
+		}
+
+		size_t const faceSize = chunk.corners.size() - firstCorner;
+		// degenerated faces are dropped
+		if (faceSize < 3)
+		{
+			chunk.corners.resize(firstCorner);
+		}
+		else
+		{
+			chunk.faceSizes.push_back(static_cast<uint32>(faceSize));
+			chunk.faceMaterials.push_back(chunk.usedMaterials.empty() ? inheritedMaterial : static_cast<uint32>(chunk.usedMaterials.size() - 1));
+		}
+	}
+	else if (length > 6 && memcmp(it, "usemtl", 6) == 0 && isBlank(it[6]))
+	{
+		it += 7;
+		chunk.usedMaterials.push_back(parseToken(it, end));
+	}
+	else if (length > 6 && memcmp(it, "mtllib", 6) == 0 && isBlank(it[6]))
+	{
+		chunk.materialLibraries.push_back({ it + 7, static_cast<size_t>(end - it - 7) });
+	}
+}
+
+static void parseChunk(Chunk& chunk)
+{
+	char const* it = chunk.text.data();
+	char const* const end = it + chunk.text.size();
+
+	while (it != end)
+	{
+		char const* lineEnd = static_cast<char const*>(memchr(it, '\n', end - it));
+		if (!lineEnd)
+			lineEnd = end;
+
+		parseLine(chunk, skipBlanks(it, lineEnd), lineEnd);
+		it = lineEnd == end ? end : lineEnd + 1;
+	}
+}
+
+static LoadedMesh::Vertex makeVertex(Corner const& corner, Chunk const& chunk, Attributes const& attrib)
+{
+	auto const resolve = [&corner](int32 index, uint8 bit, size_t chunkOffset) -> size_t
+	{
+		return (corner.relative & bit) ? chunkOffset + index : static_cast<size_t>(index);
+	};
+
+	LoadedMesh::Vertex vertex{};
+
+	size_t const p = resolve(corner.position, RelativePosition, chunk.positionOffset);
+	if (p >= attrib.positions.size())
+		throw std::runtime_error("obj face references an invalid vertex");
+	vertex.pos = attrib.positions[p];
+	vertex.color = attrib.colors[p];
+
+	if (corner.normal != noIndex)
+	{
+		size_t const n = resolve(corner.normal, RelativeNormal, chunk.normalOffset);
+		if (n >= attrib.normals.size())
+			throw std::runtime_error("obj face references an invalid normal");
+		vertex.normal = attrib.normals[n];
+	}
+
+	if (corner.uv != noIndex)
+	{
+		size_t const t = resolve(corner.uv, RelativeUv, chunk.uvOffset);
+		if (t >= attrib.uvs.size())
+			throw std::runtime_error("obj face references an invalid texcoord");
+		vertex.uv = attrib.uvs[t];
+	}
+
+	return vertex;
+}
+
+// Triangulate the chunk faces and deduplicate its vertices, same triangulation as tinyobj for triangles and quads,
+// larger polygons are fan triangulated
+static void buildChunkGeometry(Chunk& chunk, Attributes const& attrib)
+{
+	size_t indexCount = 0;
+	for (uint32 const faceSize : chunk.faceSizes)
+		indexCount += (faceSize - 2) * 3;
+	
+	chunk.indices.reserve(indexCount);
+	VertexDedupTable uniqueVertices(chunk.vertices, indexCount);
+
+	auto const emit = [&](Corner const& corner)
+	{
+		chunk.indices.push_back(uniqueVertices.insert(makeVertex(corner, chunk, attrib)));
+	};
+
+	chunk.triangleMaterials.reserve(indexCount / 3);
+
+	Corner const* face = chunk.corners.data();
+	for (size_t f = 0; f < chunk.faceSizes.size(); f++)
+	{
+		uint32 const faceSize = chunk.faceSizes[f];
+		uint32 const material = chunk.faceMaterials[f] == inheritedMaterial ? chunk.startMaterial : chunk.materialIds[chunk.faceMaterials[f]];
+		chunk.triangleMaterials.insert(chunk.triangleMaterials.end(), faceSize == 4 ? 2 : faceSize - 2, material);
+		
+		if (faceSize == 4)
+		{
+			// split along the shortest diagonal
+			glm::vec3 const p0 = makeVertex(face[0], chunk, attrib).pos;
+			glm::vec3 const p1 = makeVertex(face[1], chunk, attrib).pos;
+			glm::vec3 const p2 = makeVertex(face[2], chunk, attrib).pos;
+			glm::vec3 const p3 = makeVertex(face[3], chunk, attrib).pos;
+			glm::vec3 const e02 = p2 - p0;
+			glm::vec3 const e13 = p3 - p1;
+
+			if (glm::dot(e02, e02) < glm::dot(e13, e13))
+			{
+				emit(face[0]); emit(face[1]); emit(face[2]);
+				emit(face[0]); emit(face[2]); emit(face[3]);
+			}
+			else
+			{
+				emit(face[0]); emit(face[1]); emit(face[3]);
+				emit(face[1]); emit(face[2]); emit(face[3]);
+			}
+		}
+		else
+		{
+			for (uint32 v = 2; v < faceSize; v++)
+			{
+				emit(face[0]); emit(face[v - 1]); emit(face[v]);
+			}
+		}
+		face += faceSize;
+	}
+
+	// raw face data is not needed anymore
+	chunk.corners = {};
+	chunk.faceSizes = {};
+	chunk.faceMaterials = {};
+}
+
+static std::vector<Chunk> splitChunks(std::span<char const> text, size_t chunkCount)
+{
+	std::vector<Chunk> chunks;
+	chunks.reserve(chunkCount);
+
+	size_t const chunkSize = text.size() / chunkCount;
+	size_t begin = 0;
+	while (begin < text.size())
+	{
+		size_t end = std::min(begin + chunkSize, text.size());
+		// move the chunk end after the next line break so a line is never split
+		while (end < text.size() && text[end - 1] != '\n')
+			end++;
+
+		Chunk& chunk = chunks.emplace_back();
+		chunk.text = text.subspan(begin, end - begin);
+		begin = end;
+	}
+	return chunks;
+}
+
+// Same lookup as tinyobj: the first library of a mtllib line that can be opened is loaded, unknown materials get no material
+static void resolveMaterials(std::vector<Chunk>& chunks, std::filesystem::path const& directory)
+{
+	std::map<std::string, int> materialMap;
+	std::vector<tinyobj::material_t> materials;
+	
+	for (auto const& chunk : chunks)
+	{
+		for (std::string_view const line : chunk.materialLibraries)
+		{
+			char const* it = line.data();
+			char const* const end = it + line.size();
+			for (std::string_view name = parseToken(it, end); !name.empty(); name = parseToken(it, end))
+			{
+				std::ifstream stream(directory / name);
+				if (!stream.is_open())
+					continue;
+
+				std::string warning, error;
+				tinyobj::LoadMtl(&materialMap, &materials, &stream, &warning, &error);
+				break;
+			}
+		}
+	}
+
+	uint32 currentMaterial = Submesh::noMaterial;
+	for (auto& chunk : chunks)
+	{
+		chunk.startMaterial = currentMaterial;
+		for (std::string_view const name : chunk.usedMaterials)
+		{
+			auto const it = materialMap.find(std::string(name));
+			chunk.materialIds.push_back(it == materialMap.end() ? Submesh::noMaterial : static_cast<uint32>(it->second));
+		}
+		
+		if (!chunk.materialIds.empty())
+			currentMaterial = chunk.materialIds.back();
+	}
+}
+
+template<typename T>
+static void gatherAttribute(std::vector<Chunk>& chunks, std::vector<T> Chunk::* member, std::vector<T>& merged)
+{
+	size_t total = 0;
+	for (auto const& chunk : chunks)
+		total += (chunk.*member).size();
+	merged.resize(total);
+
+	std::vector<size_t> offsets(chunks.size());
+	for (size_t i = 0, offset = 0; i < chunks.size(); i++)
+	{
+		offsets[i] = offset;
+		offset += (chunks[i].*member).size();
+	}
+
+	parallelFor(chunks.size(), [&](size_t i)
+	{
+		auto& data = chunks[i].*member;
+		std::copy(data.begin(), data.end(), merged.begin() + offsets[i]);
+		data = {};
+	});
+}
+
+LoadedMesh loadObjParallel(std::filesystem::path const& objPath, uint32 threadCount)
+{
+	MappedFile file;
+	file.open(objPath);
+
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+	// a few chunks per thread to balance uneven lines
+	size_t const chunkCount = std::clamp<size_t>(file.size() / minChunkSize, 1, threadCount * 4);
+	std::vector<Chunk> chunks = splitChunks(file.data(), chunkCount);
+
+	parallelFor(chunks.size(), [&](size_t i)
+	{
+		parseChunk(chunks[i]);
+	}, threadCount);
+
+	for (size_t i = 1; i < chunks.size(); i++)
+	{
+		chunks[i].positionOffset = chunks[i - 1].positionOffset + chunks[i - 1].positions.size();
+		chunks[i].normalOffset = chunks[i - 1].normalOffset + chunks[i - 1].normals.size();
+		chunks[i].uvOffset = chunks[i - 1].uvOffset + chunks[i - 1].uvs.size();
+	}
+
+	resolveMaterials(chunks, objPath.parent_path());
+
+	Attributes attrib;
+	gatherAttribute(chunks, &Chunk::positions, attrib.positions);
+	gatherAttribute(chunks, &Chunk::colors, attrib.colors);
+	gatherAttribute(chunks, &Chunk::normals, attrib.normals);
+	gatherAttribute(chunks, &Chunk::uvs, attrib.uvs);
+
+	parallelFor(chunks.size(), [&](size_t i)
+	{
+		buildChunkGeometry(chunks[i], attrib);
+	}, threadCount);
+
+	// merge chunks in file order, vertices keep their first seen order so the result match loadObj
+	size_t chunkVertexCount = 0;
+	for (auto const& chunk : chunks)
+		chunkVertexCount += chunk.vertices.size();
+	
+	LoadedMesh loadedMesh;
+	VertexDedupTable uniqueVertices(loadedMesh.vertices, chunkVertexCount);
+	std::vector<std::vector<uint32>> remaps(chunks.size());
+	std::vector<size_t> indexOffsets(chunks.size());
+	size_t indexCount = 0;
+
+	for (size_t i = 0; i < chunks.size(); i++)
+	{
+		auto& remap = remaps[i];
+		remap.reserve(chunks[i].vertices.size());
+		for (auto const& vertex : chunks[i].vertices)
+			remap.push_back(uniqueVertices.insert(vertex));
+		chunks[i].vertices = {};
+
+		indexOffsets[i] = indexCount;
+		indexCount += chunks[i].indices.size();
+	}
+
+	loadedMesh.indices.resize(indexCount);
+	std::vector<uint32> triangleMaterials(indexCount / 3);
+	parallelFor(chunks.size(), [&](size_t i)
+	{
+		auto const& remap = remaps[i];
+		uint32* dst = loadedMesh.indices.data() + indexOffsets[i];
+		for (uint32 const index : chunks[i].indices)
+			*dst++ = remap[index];
+		
+		std::copy(chunks[i].triangleMaterials.begin(), chunks[i].triangleMaterials.end(), triangleMaterials.begin() + indexOffsets[i] / 3);
+	}, threadCount);
+
+	sortByMaterial(loadedMesh, triangleMaterials);
+	computeMeshBounds(loadedMesh);
+	return loadedMesh;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include <filesystem>
+
+#include "mesh.hpp"
+
+// Multithreaded OBJ importer
+// The file is memory mapped and split in chunks at line boundaries, chunks are parsed and deduplicated in parallel
+// then merged in file order, the resulting LoadedMesh is the same as the one produced by loadObj.
+// threadCount = 0 uses all hardware threads
+LoadedMesh loadObjParallel(std::filesystem::path const& objPath, uint32 threadCount = 0);
@@ -0,0 +1,458 @@
+#include "textureFile.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <stb/stb_image.h>
+
+#include "bcEncoder.hpp"
+#include "meshCache.hpp"
+#include "mipGenerator.hpp"
+#include "utility.hpp"
+#include "vkhUtility.hpp"
+
+namespace
+{
+	// larger than any device limit, keeps the level sizes far from overflowing
+	constexpr uint32 maxTextureExtent = 1 << 16;
+
+	struct Ktx2Header
+	{
+		static constexpr uint8 identifierValue[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+		uint8 identifier[12];
+		uint32 vkFormat;
+		uint32 typeSize;
+		uint32 pixelWidth;
+		uint32 pixelHeight;
+		uint32 pixelDepth;
+		uint32 layerCount;
+		uint32 faceCount;
+		uint32 levelCount;
+		uint32 supercompressionScheme;
+		uint32 dfdByteOffset;
+		uint32 dfdByteLength;
+		uint32 kvdByteOffset;
+		uint32 kvdByteLength;
+		uint64 sgdByteOffset;
+		uint64 sgdByteLength;
+	};
+	static_assert(sizeof(Ktx2Header) == 80);
+
+	// follows the header, level 0 first
+	struct Ktx2Level
+	{
+		uint64 byteOffset;
+		uint64 byteLength;
+		uint64 uncompressedByteLength;
+	};
+
+	struct DdsPixelFormat
+	{
+		uint32 size;
+		uint32 flags;
+		uint32 fourCC;
+		uint32 rgbBitCount;
+		uint32 rMask;
+		uint32 gMask;
+		uint32 bMask;
+		uint32 aMask;
+	};
+
+	// follows the "DDS " magic
+	struct DdsHeader
+	{
+		uint32 size;
+		uint32 flags;
+		uint32 height;
+		uint32 width;
+		uint32 pitchOrLinearSize;
+		uint32 depth;
+		uint32 mipMapCount;
+		uint32 reserved1[11];
+		DdsPixelFormat pixelFormat;
+		uint32 caps;
+		uint32 caps2;
+		uint32 caps3;
+		uint32 caps4;
+		uint32 reserved2;
+	};
+	static_assert(sizeof(DdsHeader) == 124);
+
+	// follows the header when the four CC is DX10
+	struct DdsHeaderDx10
+	{
+		uint32 dxgiFormat;
+		uint32 resourceDimension;
+		uint32 miscFlag;
+		uint32 arraySize;
+		uint32 miscFlags2;
+	};
+
+	uint32 constexpr ddsMagic = 0x20534444;
+	uint32 constexpr ddsFlagsRequired = 0x1 | 0x2 | 0x4 | 0x1000;
+	uint32 constexpr ddsFlagMipMapCount = 0x20000;
+	uint32 constexpr ddsFlagLinearSize = 0x80000;
+	uint32 constexpr ddsPixelFourCC = 0x4;
+	uint32 constexpr ddsPixelRgb = 0x40;
+	uint32 constexpr ddsCapsTexture = 0x1000;
+	uint32 constexpr ddsCapsComplex = 0x8;
+	uint32 constexpr ddsCapsMipMap = 0x400000;
+	uint32 constexpr ddsCaps2CubeOrVolume = 0x200 | 0x200000;
+	uint32 constexpr dx10Texture2D = 3;
+	uint32 constexpr dx10MiscCube = 0x4;
+	// reserved1 words holding the source hash of cached imports
+	uint32 constexpr ddsHashWord = 0;
+
+	uint32 constexpr makeFourCC(char a, char b, char c, char d)
+	{
+		return uint32(uint8(a)) | uint32(uint8(b)) << 8 | uint32(uint8(c)) << 16 | uint32(uint8(d)) << 24;
+	}
+
+	struct DxgiFormat
+	{
+		uint32 dxgi;
+		vk::Format format;
+	};
+
+	DxgiFormat constexpr dxgiFormats[] = {
+		{ 2, vk::Format::eR32G32B32A32Sfloat },
+		{ 10, vk::Format::eR16G16B16A16Sfloat },
+		{ 28, vk::Format::eR8G8B8A8Unorm },
+		{ 29, vk::Format::eR8G8B8A8Srgb },
+		{ 49, vk::Format::eR8G8Unorm },
+		{ 61, vk::Format::eR8Unorm },
+		{ 71, vk::Format::eBc1RgbaUnormBlock },
+		{ 72, vk::Format::eBc1RgbaSrgbBlock },
+		{ 74, vk::Format::eBc2UnormBlock },
+		{ 75, vk::Format::eBc2SrgbBlock },
+		{ 77, vk::Format::eBc3UnormBlock },
+		{ 78, vk::Format::eBc3SrgbBlock },
+		{ 80, vk::Format::eBc4UnormBlock },
+		{ 81, vk::Format::eBc4SnormBlock },
+		{ 83, vk::Format::eBc5UnormBlock },
+		{ 84, vk::Format::eBc5SnormBlock },
+		{ 87, vk::Format::eB8G8R8A8Unorm },
+		{ 91, vk::Format::eB8G8R8A8Srgb },
+		{ 95, vk::Format::eBc6HUfloatBlock },
+		{ 96, vk::Format::eBc6HSfloatBlock },
+		{ 98, vk::Format::eBc7UnormBlock },
+		{ 99, vk::Format::eBc7SrgbBlock },
+	};
+
+	vk::Format fromDxgi(uint32 dxgi)
+	{
+		for (auto const& entry : dxgiFormats)
+		{
+			if (entry.dxgi == dxgi)
+				return entry.format;
+		}
+		throw std::runtime_error("unsupported DDS DXGI format " + std::to_string(dxgi));
+	}
+
+	uint32 toDxgi(vk::Format format)
+	{
+		for (auto const& entry : dxgiFormats)
+		{
+			if (entry.format == format)
+				return entry.dxgi;
+		}
+		// BC1 without alpha shares the DXGI format of BC1 with alpha
+		if (format == vk::Format::eBc1RgbUnormBlock)
+			return 71;
+		if (format == vk::Format::eBc1RgbSrgbBlock)
+			return 72;
+		throw std::runtime_error("format has no DXGI equivalent");
+	}
+
+	vk::Format fromLegacyPixelFormat(DdsPixelFormat const& pf)
+	{
+		if (pf.flags & ddsPixelFourCC)
+		{
+			switch (pf.fourCC)
+			{
+			case makeFourCC('D', 'X', 'T', '1'): return vk::Format::eBc1RgbaUnormBlock;
+			case makeFourCC('D', 'X', 'T', '2'):
+			case makeFourCC('D', 'X', 'T', '3'): return vk::Format::eBc2UnormBlock;
+			case makeFourCC('D', 'X', 'T', '4'):
+			case makeFourCC('D', 'X', 'T', '5'): return vk::Format::eBc3UnormBlock;
+			case makeFourCC('A', 'T', 'I', '1'):
+			case makeFourCC('B', 'C', '4', 'U'): return vk::Format::eBc4UnormBlock;
+			case makeFourCC('A', 'T', 'I', '2'):
+			case makeFourCC('B', 'C', '5', 'U'): return vk::Format::eBc5UnormBlock;
+			default: break;
+			}
+		}
+		else if ((pf.flags & ddsPixelRgb) && pf.rgbBitCount == 32)
+		{
+			if (pf.rMask == 0x000000FF && pf.gMask == 0x0000FF00 && pf.bMask == 0x00FF0000)
+				return vk::Format::eR8G8B8A8Unorm;
+			if (pf.rMask == 0x00FF0000 && pf.gMask == 0x0000FF00 && pf.bMask == 0x000000FF)
+				return vk::Format::eB8G8R8A8Unorm;
+		}
+		throw std::runtime_error("unsupported DDS pixel format");
+	}
+
+	TextureFile readDds(std::filesystem::path const& path, uint32 firstLevel, uint64* sourceHash)
+	{
+		MappedFile file;
+		file.open(path);
+		std::span<char const> const bytes = file.data();
+		auto fail = [&path](char const* reason) { return std::runtime_error("invalid DDS file " + path.string() + ": " + reason); };
+
+		uint32 magic;
+		DdsHeader header;
+		if (bytes.size() < sizeof(magic) + sizeof(header))
+			throw fail("truncated header");
+		memcpy(&magic, bytes.data(), sizeof(magic));
+		memcpy(&header, bytes.data() + sizeof(magic), sizeof(header));
+		// writers are lax with the required flags, they are not checked
+		if (magic != ddsMagic || header.size != sizeof(DdsHeader))
+			throw fail("bad header");
+		if (header.caps2 & ddsCaps2CubeOrVolume)
+			throw fail("only 2D textures are supported");
+
+		size_t offset = sizeof(magic) + sizeof(header);
+		TextureFile texture;
+		if ((header.pixelFormat.flags & ddsPixelFourCC) && header.pixelFormat.fourCC == makeFourCC('D', 'X', '1', '0'))
+		{
+			DdsHeaderDx10 dx10;
+			if (bytes.size() < offset + sizeof(dx10))
+				throw fail("truncated DX10 header");
+			memcpy(&dx10, bytes.data() + offset, sizeof(dx10));
+			offset += sizeof(dx10);
+			if (dx10.resourceDimension != dx10Texture2D || dx10.arraySize > 1 || (dx10.miscFlag & dx10MiscCube))
+				throw fail("only 2D textures are supported");
+			texture.format = fromDxgi(dx10.dxgiFormat);
+		}
+		else
+		{
+			texture.format = fromLegacyPixelFormat(header.pixelFormat);
+		}
+
+		texture.width = header.width;
+		texture.height = header.height;
+		texture.mipLevels = (header.flags & ddsFlagMipMapCount) ? std::max(header.mipMapCount, 1u) : 1;
+		if (texture.width == 0 || texture.height == 0 || texture.width > maxTextureExtent || texture.height > maxTextureExtent
+			|| texture.mipLevels > vkh::getMipLevelCount(texture.width, texture.height))
+			throw fail("bad extent");
+
+		vk::DeviceSize const size = vkh::getMipChainSize(texture.format, { texture.width, texture.height, 1 }, 0, texture.mipLevels);
+		if (bytes.size() < offset + size)
+			throw fail("truncated data");
+
+		// levels are stored tightly packed from the largest one
+		texture.firstLevel = std::min(firstLevel, texture.mipLevels);
+		size_t const skipped = vkh::getMipChainSize(texture.format, { texture.width, texture.height, 1 }, 0, texture.firstLevel);
+		texture.data.assign(bytes.data() + offset + skipped, bytes.data() + offset + size);
+		if (sourceHash)
+			memcpy(sourceHash, &header.reserved1[ddsHashWord], sizeof(uint64));
+		return texture;
+	}
+
+	bool isSrgb(vk::Format format) noexcept
+	{
+		switch (format)
+		{
+		case vk::Format::eBc1RgbSrgbBlock:
+		case vk::Format::eBc1RgbaSrgbBlock:
+		case vk::Format::eBc2SrgbBlock:
+		case vk::Format::eBc3SrgbBlock:
+		case vk::Format::eBc7SrgbBlock:
+			return true;
+		default:
+			return false;
+		}
+	}
+}
+
+TextureFile loadKtx2(std::filesystem::path const& path, uint32 firstLevel)
+{
+	MappedFile file;
+	file.open(path);
+	std::span<char const> const bytes = file.data();
+	auto fail = [&path](char const* reason) { return std::runtime_error("invalid KTX2 file " + path.string() + ": " + reason); };
+
+	Ktx2Header header;
+	if (bytes.size() < sizeof(header))
+		throw fail("truncated header");
+	memcpy(&header, bytes.data(), sizeof(header));
+	if (memcmp(header.identifier, Ktx2Header::identifierValue, sizeof(header.identifier)) != 0)
+		throw fail("bad identifier");
+	if (header.supercompressionScheme != 0)
+		throw fail("supercompression is not supported");
+	if (header.pixelDepth > 1 || header.layerCount > 1 || header.faceCount != 1)
+		throw fail("only 2D textures are supported");
+	if (header.vkFormat == VK_FORMAT_UNDEFINED)
+		throw fail("basis universal textures are not supported");
+
+	TextureFile texture;
+	texture.format = static_cast<vk::Format>(header.vkFormat);
+	texture.width = header.pixelWidth;
+	texture.height = header.pixelHeight;
+	// 0 asks the loader to generate the levels
+	texture.mipLevels = std::max(header.levelCount, 1u);
+	if (texture.width == 0 || texture.height == 0 || texture.width > maxTextureExtent || texture.height > maxTextureExtent
+		|| texture.mipLevels > vkh::getMipLevelCount(texture.width, texture.height))
+		throw fail("bad extent");
+
+	std::vector<Ktx2Level> levels(texture.mipLevels);
+	if (bytes.size() < sizeof(header) + levels.size() * sizeof(Ktx2Level))
+		throw fail("truncated level index");
+	memcpy(levels.data(), bytes.data() + sizeof(header), levels.size() * sizeof(Ktx2Level));
+
+	texture.firstLevel = std::min(firstLevel, texture.mipLevels);
+	vk::DeviceSize const skipped = vkh::getMipChainSize(texture.format, { texture.width, texture.height, 1 }, 0, texture.firstLevel);
+	texture.data.resize(vkh::getMipChainSize(texture.format, { texture.width, texture.height, 1 }, 0, texture.mipLevels) - skipped);
+	// the file stores the smallest level first, the index is ordered from level 0
+	size_t offset = 0;
+	for (uint32 level = texture.firstLevel; level < texture.mipLevels; level++)
+	{
+		vk::DeviceSize const levelSize = vkh::getMipLevelSize(texture.format, { texture.width, texture.height, 1 }, level);
+		if (levels[level].byteLength != levelSize || levels[level].byteOffset > bytes.size() || levelSize > bytes.size() - levels[level].byteOffset)
+			throw fail("bad level size");
+		memcpy(texture.data.data() + offset, bytes.data() + levels[level].byteOffset, levelSize);
+		offset += levelSize;
+	}
+
+	return texture;
+}
+
+TextureFile loadDds(std::filesystem::path const& path, uint32 firstLevel)
+{
+	return readDds(path, firstLevel, nullptr);
+}
+
+bool isTextureContainer(std::filesystem::path const& path)
+{
+	std::filesystem::path const extension = path.extension();
+	return extension == ".ktx2" || extension == ".dds";
+}
+
+TextureFile loadTextureFile(std::filesystem::path const& path, uint32 firstLevel)
+{
+	std::filesystem::path const extension = path.extension();
+	if (extension == ".ktx2")
+		return loadKtx2(path, firstLevel);
+	if (extension == ".dds")
+		return loadDds(path, firstLevel);
+	throw std::runtime_error("unknown texture container " + path.string());
+}
+
+void writeDds(std::filesystem::path const& path, TextureFile const& texture, uint64 sourceHash)
+{
+	assert(texture.firstLevel == 0);
+	bool const compressed = vkh::isBlockCompressed(texture.format);
+
+	DdsHeader header{};
+	header.size = sizeof(DdsHeader);
+	header.flags = ddsFlagsRequired | ddsFlagMipMapCount | (compressed ? ddsFlagLinearSize : 0);
+	header.height = texture.height;
+	header.width = texture.width;
+	header.pitchOrLinearSize = static_cast<uint32>(vkh::getMipLevelSize(texture.format, { texture.width, texture.height, 1 }, 0));
+	header.depth = 1;
+	header.mipMapCount = texture.mipLevels;
+	memcpy(&header.reserved1[ddsHashWord], &sourceHash, sizeof(sourceHash));
+	header.pixelFormat.size = sizeof(DdsPixelFormat);
+	header.pixelFormat.flags = ddsPixelFourCC;
+	header.pixelFormat.fourCC = makeFourCC('D', 'X', '1', '0');
+	header.caps = ddsCapsTexture | (texture.mipLevels > 1 ? ddsCapsComplex | ddsCapsMipMap : 0);
+
+	DdsHeaderDx10 dx10{};
+	dx10.dxgiFormat = toDxgi(texture.format);
+	dx10.resourceDimension = dx10Texture2D;
+	dx10.arraySize = 1;
+
+	// write to a temporary file first so a crash never leaves a truncated file behind,
+	// named after the thread so concurrent writers of the same file do not share it
+	std::filesystem::path tmpPath = path;
+	tmpPath += "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id())) + ".tmp";
+	{
+		std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+		if (!out.is_open())
+			throw std::runtime_error("failed to open file " + tmpPath.string());
+
+		out.write(reinterpret_cast<char const*>(&ddsMagic), sizeof(ddsMagic));
+		out.write(reinterpret_cast<char const*>(&header), sizeof(header));
+		out.write(reinterpret_cast<char const*>(&dx10), sizeof(dx10));
+		out.write(reinterpret_cast<char const*>(texture.data.data()), static_cast<std::streamsize>(texture.data.size()));
+
+		if (!out)
+			throw std::runtime_error("failed to write DDS file " + tmpPath.string());
+	}
+	std::error_code error;
+	std::filesystem::rename(tmpPath, path, error);
+	if (error)
+	{
+		std::filesystem::remove(tmpPath, error);
+		throw std::runtime_error("failed to replace DDS file " + path.string());
+	}
+}
+
+TextureFile importTextureCached(std::filesystem::path const& imagePath, vk::Format bcFormat, uint32 firstLevel)
+{
+	if (!canEncodeBc(bcFormat))
+		throw std::runtime_error("unsupported block compression format");
+
+	std::filesystem::path const cachePath = getImportCachePath(imagePath);
+	uint64 const sourceHash = hashFileContent(imagePath, static_cast<uint64>(bcFormat) | static_cast<uint64>(bcEncoderVersion) << 32);
+
+	if (std::filesystem::exists(cachePath))
+	{
+		try
+		{
+			uint64 cachedHash = 0;
+			TextureFile cached = readDds(cachePath, firstLevel, &cachedHash);
+			if (cachedHash == sourceHash && cached.format == bcFormat)
+				return cached;
+		}
+		catch (std::exception const&)
+		{
+			// rebuilt below
+		}
+	}
+
+	int width, height, channels;
+	std::unique_ptr<stbi_uc, decltype(&stbi_image_free)> const pixels(stbi_load(imagePath.string().c_str(), &width, &height, &channels, STBI_rgb_alpha), stbi_image_free);
+	if (!pixels)
+		throw std::runtime_error("failed to load texture image " + imagePath.string());
+	if (static_cast<uint32>(width) > maxTextureExtent || static_cast<uint32>(height) > maxTextureExtent)
+		throw std::runtime_error("texture image too large " + imagePath.string());
+
+	TextureFile texture;
+	texture.format = bcFormat;
+	texture.width = static_cast<uint32>(width);
+	texture.height = static_cast<uint32>(height);
+	texture.mipLevels = vkh::getMipLevelCount(texture.width, texture.height);
+
+	// levels are filtered before compression, in linear space for sRGB formats
+	vk::Format const rgbaFormat = isSrgb(bcFormat) ? vk::Format::eR8G8B8A8Srgb : vk::Format::eR8G8B8A8Unorm;
+	std::vector<uint8> const chain = generateMipChain({ pixels.get(), static_cast<size_t>(width) * height * 4 }, texture.width, texture.height, rgbaFormat, texture.mipLevels);
+
+	texture.data = encodeBcMipChain(chain, texture.width, texture.height, texture.mipLevels, bcFormat);
+	try
+	{
+		writeDds(cachePath, texture, sourceHash);
+	}
+	catch (std::exception const&)
+	{
+		// the cache only saves time, another import of the same image may be reading it
+	}
+
+	texture.firstLevel = std::min(firstLevel, texture.mipLevels);
+	vk::DeviceSize const skipped = vkh::getMipChainSize(texture.format, { texture.width, texture.height, 1 }, 0, texture.firstLevel);
+	texture.data.erase(texture.data.begin(), texture.data.begin() + static_cast<ptrdiff_t>(skipped));
+	return texture;
+}
+
+std::filesystem::path getImportCachePath(std::filesystem::path const& imagePath)
+{
+	std::filesystem::path cachePath = imagePath;
+	cachePath += ".dds";
+	return cachePath;
+}
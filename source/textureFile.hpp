@@ -0,0 +1,38 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "ice.hpp"
+
+// 2D texture and its mip levels, tightly packed from the largest one (see vkh::getMipLevelSize)
+struct TextureFile
+{
+	vk::Format format = vk::Format::eUndefined;
+	// extent and levels of the whole texture, whatever the levels held by data
+	uint32 width = 0;
+	uint32 height = 0;
+	uint32 mipLevels = 0;
+	// first level held by data
+	uint32 firstLevel = 0;
+	std::vector<uint8> data;
+};
+
+// Containers of a single 2D image, cube maps, arrays, volumes and supercompressed KTX2 files are rejected
+// Only the levels from firstLevel are read, a firstLevel past the last level reads the header alone.
+TextureFile loadKtx2(std::filesystem::path const& path, uint32 firstLevel = 0);
+TextureFile loadDds(std::filesystem::path const& path, uint32 firstLevel = 0);
+[[nodiscard]] bool isTextureContainer(std::filesystem::path const& path);
+// loadKtx2 or loadDds depending on the extension
+TextureFile loadTextureFile(std::filesystem::path const& path, uint32 firstLevel = 0);
+
+// DX10 DDS of every level, sourceHash is kept in the reserved words of the header where other readers ignore it
+void writeDds(std::filesystem::path const& path, TextureFile const& texture, uint64 sourceHash = 0);
+
+// Decode imagePath, generate its mip chain and compress it to bcFormat (see bcEncoder.hpp)
+// The result is cached next to the image in a .dds file, rebuilt when the image, the format or bcEncoderVersion changes.
+// Only the levels from firstLevel are returned, see loadTextureFile.
+TextureFile importTextureCached(std::filesystem::path const& imagePath, vk::Format bcFormat, uint32 firstLevel = 0);
+// .dds file of importTextureCached, can be loaded directly once the import is done
+[[nodiscard]] std::filesystem::path getImportCachePath(std::filesystem::path const& imagePath);
@@ -0,0 +1,203 @@
+#include "textureResidency.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#include "vkhUtility.hpp"
+
+void TextureResidency::create(CreateInfo const& info)
+{
+	budget = info.budget;
+	tailSize = info.tailSize;
+	maxPendingChanges = std::max(info.maxPendingChanges, 1u);
+	clear();
+}
+
+void TextureResidency::clear()
+{
+	entries.clear();
+	frame = 0;
+	committedBytes = 0;
+	releasingBytes = 0;
+	pendingChanges = 0;
+}
+
+uint32 TextureResidency::getTailLevel(uint32 width, uint32 height, uint32 mipLevels) const noexcept
+{
+	uint32 level = 0;
+	while (level + 1 < mipLevels && std::max(width >> level, height >> level) > tailSize)
+		level++;
+	return level;
+}
+
+uint32 TextureResidency::add(vk::Format format, uint32 width, uint32 height, uint32 mipLevels)
+{
+	assert(mipLevels > 0);
+
+	Entry& entry = entries.emplace_back();
+	entry.chainSizes.resize(mipLevels + 1, 0);
+	for (uint32 level = mipLevels; level-- > 0;)
+		entry.chainSizes[level] = entry.chainSizes[level + 1] + vkh::getMipLevelSize(format, { width, height, 1 }, level);
+
+	entry.tailLevel = getTailLevel(width, height, mipLevels);
+	entry.residentLevel = entry.tailLevel;
+	entry.targetLevel = entry.tailLevel;
+	entry.neededLevel = entry.tailLevel;
+	entry.lastNeededFrame = frame;
+
+	committedBytes += entry.chainSizes[entry.tailLevel];
+	return static_cast<uint32>(entries.size() - 1);
+}
+
+void TextureResidency::request(uint32 texture, uint32 level)
+{
+	Entry& entry = entries[texture];
+	entry.requestedLevel = std::min(entry.requestedLevel, level);
+}
+
+std::vector<TextureResidency::Change> TextureResidency::update()
+{
+	frame++;
+	for (auto& entry : entries)
+	{
+		if (entry.requestedLevel == noRequest)
+			continue;
+		entry.neededLevel = std::min(entry.requestedLevel, entry.tailLevel);
+		entry.lastNeededFrame = frame;
+		entry.requestedLevel = noRequest;
+	}
+
+	std::vector<Change> changes;
+	if (pendingChanges >= maxPendingChanges)
+		return changes;
+
+	// textures missing detail this frame, the largest gaps first
+	std::vector<uint32> loads;
+	for (uint32 i = 0; i < entries.size(); i++)
+	{
+		Entry const& entry = entries[i];
+		if (entry.targetLevel == entry.residentLevel && entry.lastNeededFrame == frame && entry.neededLevel < entry.residentLevel)
+			loads.push_back(i);
+	}
+	std::sort(loads.begin(), loads.end(), [this](uint32 a, uint32 b)
+	{
+		return entries[a].residentLevel - entries[a].neededLevel > entries[b].residentLevel - entries[b].neededLevel;
+	});
+
+	for (uint32 const texture : loads)
+	{
+		if (pendingChanges >= maxPendingChanges)
+			break;
+
+		// the resident levels stay alive until the load is applied, the room freed by pending changes only once they are
+		Entry const& entry = entries[texture];
+		vk::DeviceSize const neededSize = entry.chainSizes[entry.neededLevel];
+		vk::DeviceSize const settledBytes = committedBytes - releasingBytes;
+		if (settledBytes + neededSize > budget)
+			makeRoom(settledBytes + neededSize - budget, texture, changes);
+		// wait for the room rather than loading coarser levels now
+		if (releasingBytes > 0 && committedBytes + neededSize > budget)
+			continue;
+
+		// coarser than needed when other textures could not make enough room
+		uint32 level = entry.neededLevel;
+		while (level < entry.residentLevel && committedBytes + entry.chainSizes[level] > budget)
+			level++;
+		if (level < entry.residentLevel)
+			addChange(texture, level, changes);
+	}
+
+	return changes;
+}
+
+void TextureResidency::onResident(uint32 texture)
+{
+	Entry& entry = entries[texture];
+	assert(entry.targetLevel != entry.residentLevel);
+	committedBytes -= entry.chainSizes[entry.residentLevel];
+	releasingBytes -= entry.chainSizes[entry.residentLevel];
+	entry.residentLevel = entry.targetLevel;
+	pendingChanges--;
+}
+
+void TextureResidency::onChangeFailed(uint32 texture)
+{
+	Entry& entry = entries[texture];
+	assert(entry.targetLevel != entry.residentLevel);
+	committedBytes -= entry.chainSizes[entry.targetLevel];
+	releasingBytes -= entry.chainSizes[entry.residentLevel];
+	entry.targetLevel = entry.residentLevel;
+	pendingChanges--;
+}
+
+uint32 TextureResidency::getResidentLevel(uint32 texture) const
+{
+	return entries[texture].residentLevel;
+}
+
+vk::DeviceSize TextureResidency::getCommittedBytes() const noexcept
+{
+	return committedBytes;
+}
+
+uint32 TextureResidency::getWantedLevel(Entry const& entry) const noexcept
+{
+	return entry.lastNeededFrame == frame ? entry.neededLevel : entry.tailLevel;
+}
+
+vk::DeviceSize TextureResidency::makeRoom(vk::DeviceSize bytes, uint32 loading, std::vector<Change>& changes)
+{
+	// textures resident finer than they need, least recently needed first, textures needed this frame keep what they need
+	std::vector<uint32> victims;
+	for (uint32 i = 0; i < entries.size(); i++)
+	{
+		Entry const& entry = entries[i];
+		if (i != loading && entry.targetLevel == entry.residentLevel && entry.residentLevel < getWantedLevel(entry))
+			victims.push_back(i);
+	}
+	std::sort(victims.begin(), victims.end(), [this](uint32 a, uint32 b)
+	{
+		return entries[a].lastNeededFrame < entries[b].lastNeededFrame;
+	});
+
+	vk::DeviceSize freed = 0;
+	for (uint32 const victim : victims)
+	{
+		// the load itself needs a pending change
+		if (freed >= bytes || pendingChanges + 1 >= maxPendingChanges)
+			break;
+
+		Entry const& entry = entries[victim];
+		uint32 const level = getWantedLevel(entry);
+		freed += entry.chainSizes[entry.residentLevel] - entry.chainSizes[level];
+		addChange(victim, level, changes);
+	}
+	return freed;
+}
+
+void TextureResidency::addChange(uint32 texture, uint32 firstLevel, std::vector<Change>& changes)
+{
+	Entry& entry = entries[texture];
+	assert(entry.targetLevel == entry.residentLevel && firstLevel != entry.residentLevel);
+	// the new levels are allocated while the resident ones are still alive
+	committedBytes += entry.chainSizes[firstLevel];
+	releasingBytes += entry.chainSizes[entry.residentLevel];
+	entry.targetLevel = firstLevel;
+	pendingChanges++;
+	changes.push_back({ texture, firstLevel });
+}
+
+uint32 computeMipLevel(uint32 width, uint32 height, float uvWorldSize, float distance, float projectionScale)
+{
+	// texels of level 0 covered by a pixel
+	float const pixelsPerUnit = projectionScale / std::max(distance, std::numeric_limits<float>::epsilon());
+	float const texelsPerUnit = static_cast<float>(std::max(width, height)) / std::max(uvWorldSize, std::numeric_limits<float>::epsilon());
+	float const texelsPerPixel = texelsPerUnit / pixelsPerUnit;
+	if (texelsPerPixel <= 1.0f)
+		return 0;
+
+	uint32 const maxLevel = vkh::getMipLevelCount(width, height) - 1;
+	return std::min(static_cast<uint32>(std::floor(std::log2(texelsPerPixel))), maxLevel);
+}
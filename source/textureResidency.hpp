@@ -0,0 +1,93 @@
+#pragma once
+
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "ice.hpp"
+
+// Mip residency of streamed textures under a memory budget, bookkeeping only: the owner loads the levels and swaps the images
+// A texture is resident from a first level down to its smallest one, its tail (the levels whose largest side fits in tailSize)
+// always is. Every frame uses request the finest level they need, update then plans loads for the textures needed this frame.
+// When a load does not fit in the budget, textures resident finer than they need are reduced first, least recently needed first.
+// Not thread safe, meant to be used by the render thread.
+class TextureResidency
+{
+public:
+	struct CreateInfo
+	{
+		// bytes of every resident level, tails included
+		vk::DeviceSize budget = 256 << 20;
+		// largest side of the levels always resident
+		uint32 tailSize = 128;
+		// changes waiting for onResident, no other change is planned until some complete
+		uint32 maxPendingChanges = 4;
+	};
+
+	// the texture becomes resident from firstLevel, finer or coarser than it is now
+	struct Change
+	{
+		uint32 texture;
+		uint32 firstLevel;
+	};
+
+	void create(CreateInfo const& info);
+	void clear();
+
+	// first level of the tail of a texture
+	[[nodiscard]] uint32 getTailLevel(uint32 width, uint32 height, uint32 mipLevels) const noexcept;
+	// register a texture with its tail resident, return its id
+	uint32 add(vk::Format format, uint32 width, uint32 height, uint32 mipLevels);
+
+	// level is the finest one needed by a use of texture this frame, e.g. from computeMipLevel or GPU feedback
+	void request(uint32 texture, uint32 level);
+	// end the frame and return the changes to apply, a texture has a single pending change
+	[[nodiscard]] std::vector<Change> update();
+	// the pending change of texture was applied
+	void onResident(uint32 texture);
+	// the pending change of texture could not be applied, it stays as it is
+	void onChangeFailed(uint32 texture);
+
+	[[nodiscard]] uint32 getResidentLevel(uint32 texture) const;
+	// bytes of every texture, both the resident and the new levels of a pending change are counted until it is applied
+	[[nodiscard]] vk::DeviceSize getCommittedBytes() const noexcept;
+
+private:
+	static uint32 constexpr noRequest = UINT32_MAX;
+
+	struct Entry
+	{
+		// bytes from each level to the smallest one
+		std::vector<vk::DeviceSize> chainSizes;
+		uint32 tailLevel = 0;
+		uint32 residentLevel = 0;
+		// first level once the pending change is applied, residentLevel without one
+		uint32 targetLevel = 0;
+		// finest level requested during the current frame
+		uint32 requestedLevel = noRequest;
+		// finest level requested during the last frame with requests
+		uint32 neededLevel = 0;
+		uint64 lastNeededFrame = 0;
+	};
+
+	// coarsest level entry can be reduced to without losing detail it needs this frame
+	[[nodiscard]] uint32 getWantedLevel(Entry const& entry) const noexcept;
+	// plan reductions of other textures until bytes are freed, return the bytes freed
+	vk::DeviceSize makeRoom(vk::DeviceSize bytes, uint32 loading, std::vector<Change>& changes);
+	void addChange(uint32 texture, uint32 firstLevel, std::vector<Change>& changes);
+
+	vk::DeviceSize budget = 0;
+	uint32 tailSize = 0;
+	uint32 maxPendingChanges = 0;
+
+	std::vector<Entry> entries;
+	uint64 frame = 0;
+	vk::DeviceSize committedBytes = 0;
+	// resident levels of the pending changes, freed once they are applied
+	vk::DeviceSize releasingBytes = 0;
+	uint32 pendingChanges = 0;
+};
+
+// Finest mip level sampled on a surface facing the camera at distance, the texture repeating every uvWorldSize units
+// projectionScale is proj[1][1] * viewportHeight / 2 as in selectLod. Oblique surfaces sample coarser levels, except with
+// anisotropic filtering which is why the level is rounded down.
+uint32 computeMipLevel(uint32 width, uint32 height, float uvWorldSize, float distance, float projectionScale);
@@ -1,7 +1,19 @@
 #include "utility.hpp"
 
+#include <cstring>
 #include <fstream>
 
+#ifdef _WIN32
+	#define WIN32_LEAN_AND_MEAN
+	#define NOMINMAX
+	#include <Windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
 std::vector<char> readBinFile(std::filesystem::path const& filePath)
 {
 	std::ifstream file(filePath, std::ios::ate | std::ios::binary);
@@ -16,4 +28,203 @@ std::vector<char> readBinFile(std::filesystem::path const& filePath)
 	file.read(buffer.data(), fileSize);
 	file.close();
 	return buffer;
-}
\ No newline at end of file
+}
+
+static uint64 rotl64(uint64 x, int r) noexcept
+{
+	return (x << r) | (x >> (64 - r));
+}
+
+static uint64 readU64(uint8 const* p) noexcept
+{
+	uint64 v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+static uint32 readU32(uint8 const* p) noexcept
+{
+	uint32 v;
+	memcpy(&v, p, sizeof(v));
+	return v;
+}
+
+// https://github.com/Cyan4973/xxHash/blob/dev/doc/xxhash_spec.md
+uint64 hashBytes(void const* data, size_t size, uint64 seed) noexcept
+{
+	uint64 constexpr prime1 = 0x9E3779B185EBCA87ull;
+	uint64 constexpr prime2 = 0xC2B2AE3D27D4EB4Full;
+	uint64 constexpr prime3 = 0x165667B19E3779F9ull;
+	uint64 constexpr prime4 = 0x85EBCA77C2B2AE63ull;
+	uint64 constexpr prime5 = 0x27D4EB2F165667C5ull;
+
+	auto const round = [](uint64 acc, uint64 input)
+	{
+		acc += input * prime2;
+		acc = rotl64(acc, 31);
+		return acc * prime1;
+	};
+
+	auto const mergeRound = [&round](uint64 acc, uint64 val)
+	{
+		acc ^= round(0, val);
+		return acc * prime1 + prime4;
+	};
+
+	uint8 const* p = static_cast<uint8 const*>(data);
+	uint8 const* const end = p + size;
+	uint64 h;
+
+	if (size >= 32)
+	{
+		uint64 v1 = seed + prime1 + prime2;
+		uint64 v2 = seed + prime2;
+		uint64 v3 = seed;
+		uint64 v4 = seed - prime1;
+
+		do
+		{
+			v1 = round(v1, readU64(p));
+			v2 = round(v2, readU64(p + 8));
+			v3 = round(v3, readU64(p + 16));
+			v4 = round(v4, readU64(p + 24));
+			p += 32;
+		} while (end - p >= 32);
+
+		h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+		h = mergeRound(h, v1);
+		h = mergeRound(h, v2);
+		h = mergeRound(h, v3);
+		h = mergeRound(h, v4);
+	}
+	else
+	{
+		h = seed + prime5;
+	}
+
+	h += static_cast<uint64>(size);
+
+	for (; end - p >= 8; p += 8)
+		h = rotl64(h ^ round(0, readU64(p)), 27) * prime1 + prime4;
+
+	if (end - p >= 4)
+	{
+		h = rotl64(h ^ (readU32(p) * prime1), 23) * prime2 + prime3;
+		p += 4;
+	}
+
+	for (; p < end; p++)
+		h = rotl64(h ^ (*p * prime5), 11) * prime1;
+
+	h ^= h >> 33;
+	h *= prime2;
+	h ^= h >> 29;
+	h *= prime3;
+	h ^= h >> 32;
+	return h;
+}
+
+MappedFile::MappedFile(MappedFile&& rhs) noexcept
+{
+	*this = std::move(rhs);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& rhs) noexcept
+{
+	close();
+	std::swap(view, rhs.view);
+	std::swap(fileSize, rhs.fileSize);
+#ifdef _WIN32
+	std::swap(fileHandle, rhs.fileHandle);
+	std::swap(mappingHandle, rhs.mappingHandle);
+#endif
+	return *this;
+}
+
+void MappedFile::open(std::filesystem::path const& filePath)
+{
+	close();
+	
+#ifdef _WIN32
+	HANDLE const file = CreateFileW(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		throw std::runtime_error("failed to open file " + filePath.string());
+	fileHandle = file;
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(file, &size))
+	{
+		close();
+		throw std::runtime_error("failed to get size of file " + filePath.string());
+	}
+	fileSize = static_cast<size_t>(size.QuadPart);
+	
+	// an empty file cannot be mapped
+	if (fileSize == 0)
+		return;
+	
+	mappingHandle = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mappingHandle)
+	{
+		close();
+		throw std::runtime_error("failed to map file " + filePath.string());
+	}
+	
+	view = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+#else
+	int const fd = ::open(filePath.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw std::runtime_error("failed to open file " + filePath.string());
+
+	struct stat st;
+	if (fstat(fd, &st) != 0)
+	{
+		::close(fd);
+		throw std::runtime_error("failed to get size of file " + filePath.string());
+	}
+	fileSize = static_cast<size_t>(st.st_size);
+
+	if (fileSize == 0)
+	{
+		::close(fd);
+		return;
+	}
+	
+	view = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);
+	if (view == MAP_FAILED)
+		view = nullptr;
+	else
+		madvise(view, fileSize, MADV_SEQUENTIAL);
+#endif
+
+	if (!view)
+	{
+		close();
+		throw std::runtime_error("failed to map file " + filePath.string());
+	}
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (view)
+		UnmapViewOfFile(view);
+	if (mappingHandle)
+		CloseHandle(mappingHandle);
+	if (fileHandle)
+		CloseHandle(fileHandle);
+	mappingHandle = nullptr;
+	fileHandle = nullptr;
+#else
+	if (view)
+		munmap(view, fileSize);
+#endif
+	view = nullptr;
+	fileSize = 0;
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
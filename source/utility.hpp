@@ -4,21 +4,120 @@
 #include <algorithm>
 #include <filesystem>
 #include <span>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <exception>
+
+#include "ice.hpp"
 
 std::vector<char> readBinFile(std::filesystem::path const& filePath);
 
+// 64 bit non cryptographic hash (xxHash64 algorithm) of raw bytes
+uint64 hashBytes(void const* data, size_t size, uint64 seed = 0) noexcept;
+
+// Read only memory mapping of a whole file, the view stay valid until close() or destruction
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	MappedFile(MappedFile&&) noexcept;
+	MappedFile& operator=(MappedFile&&) noexcept;
+
+	MappedFile(MappedFile const&) = delete;
+	MappedFile& operator=(MappedFile const&) = delete;
+
+	void open(std::filesystem::path const& filePath);
+	void close();
+
+	[[nodiscard]] std::span<char const> data() const noexcept
+	{
+		return { static_cast<char const*>(view), fileSize };
+	}
+
+	[[nodiscard]] size_t size() const noexcept
+	{
+		return fileSize;
+	}
+
+	~MappedFile();
+
+private:
+	void* view = nullptr;
+	size_t fileSize = 0;
+#ifdef _WIN32
+	void* fileHandle = nullptr;
+	void* mappingHandle = nullptr;
+#endif
+};
+
 template<typename To, typename From>
 std::span<To> toSpan(std::vector<From> const& vec)
 {
 	return std::span((To*)vec.data(), vec.size() * sizeof(vec[0]));
 }
 
+template<typename T>
+std::span<uint8 const> toByteSpan(std::span<T const> span)
+{
+	return { reinterpret_cast<uint8 const*>(span.data()), span.size_bytes() };
+}
+
 template<typename T>
 void mergeVectors(std::vector<T>& a, std::vector<T> const& b)
 {
 	a.insert(a.end(), b.begin(), b.end());
 }
 
+// Call func(i) for every i in [0, count) on threadCount workers (0 = hardware concurrency),
+// indices are handed out one by one so tasks of uneven cost are balanced
+template<typename F>
+void parallelFor(size_t count, F&& func, unsigned threadCount = 0)
+{
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	threadCount = static_cast<unsigned>(std::min<size_t>(threadCount, count));
+
+	if (threadCount <= 1)
+	{
+		for (size_t i = 0; i < count; i++)
+			func(i);
+		return;
+	}
+	
+	std::atomic<size_t> next = 0;
+	std::exception_ptr error;
+	std::mutex errorMutex;
+	
+	auto worker = [&]()
+	{
+		try
+		{
+			for (size_t i = next++; i < count; i = next++)
+				func(i);
+		}
+		catch (...)
+		{
+			// stop handing out work and rethrow the first error on the calling thread
+			next = count;
+			std::scoped_lock lock(errorMutex);
+			if (!error)
+				error = std::current_exception();
+		}
+	};
+
+	{
+		std::vector<std::jthread> workers;
+		workers.reserve(threadCount - 1);
+		for (unsigned t = 1; t < threadCount; t++)
+			workers.emplace_back(worker);
+		worker();
+	}
+
+	if (error)
+		std::rethrow_exception(error);
+}
+
 template<class... Ts> struct overloaded : Ts... { using Ts::operator()...; };
 template<class... Ts> overloaded(Ts...)->overloaded<Ts...>;
 
@@ -27,4 +126,4 @@ void insertUnique(C& cont, E&& e)
 {
 	if (std::find(cont.begin(), cont.end(), e) == cont.end())
 		cont.insert(cont.end(), std::forward<E>(e));
-}
\ No newline at end of file
+}
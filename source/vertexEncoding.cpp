@@ -0,0 +1,116 @@
+#include "vertexEncoding.hpp"
+
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <glm/gtc/packing.hpp>
+
+#include "mesh.hpp"
+#include "meshBounds.hpp"
+#include "utility.hpp"
+
+namespace
+{
+	struct QuantizedVertex
+	{
+		// 4 components, uint64 would pad the struct to 24 bytes
+		uint16 position[4];
+		uint32 normal;
+		uint32 color;
+		uint32 uv;
+	};
+
+	static_assert(sizeof(QuantizedVertex) == 20);
+}
+
+std::array<vk::Format, vertexAttributeCount> getVertexAttributeFormats(VertexEncoding encoding)
+{
+	switch (encoding)
+	{
+	case VertexEncoding::Float32:
+		return { vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32B32Sfloat, vk::Format::eR32G32Sfloat };
+	case VertexEncoding::QuantizedHalf:
+		// 3 components 16 bit formats are rarely supported as vertex input, w is padding
+		return { vk::Format::eR16G16B16A16Sfloat, vk::Format::eR16G16Snorm, vk::Format::eR8G8B8A8Unorm, vk::Format::eR16G16Sfloat };
+	case VertexEncoding::QuantizedSnorm16:
+		return { vk::Format::eR16G16B16A16Snorm, vk::Format::eR16G16Snorm, vk::Format::eR8G8B8A8Unorm, vk::Format::eR16G16Sfloat };
+	default:
+		throw std::runtime_error("unsuported vertex encoding");
+	}
+}
+
+uint32 getVertexStride(VertexEncoding encoding)
+{
+	return encoding == VertexEncoding::Float32 ? sizeof(LoadedMesh::Vertex) : sizeof(QuantizedVertex);
+}
+
+glm::vec2 octahedralEncode(glm::vec3 n)
+{
+	float const l1 = glm::abs(n.x) + glm::abs(n.y) + glm::abs(n.z);
+	// missing normals decode to +Z
+	if (l1 == 0.0f)
+		return glm::vec2(0.0f);
+	
+	n /= l1;
+	glm::vec2 e(n.x, n.y);
+	if (n.z < 0.0f)
+	{
+		glm::vec2 const signNotZero(e.x >= 0.0f ? 1.0f : -1.0f, e.y >= 0.0f ? 1.0f : -1.0f);
+		e = (1.0f - glm::abs(glm::vec2(e.y, e.x))) * signNotZero;
+	}
+	return e;
+}
+
+glm::vec3 octahedralDecode(glm::vec2 e)
+{
+	glm::vec3 v(e.x, e.y, 1.0f - glm::abs(e.x) - glm::abs(e.y));
+	float const t = glm::max(-v.z, 0.0f);
+	v.x += v.x >= 0.0f ? -t : t;
+	v.y += v.y >= 0.0f ? -t : t;
+	return glm::normalize(v);
+}
+
+EncodedVertices encodeVertices(std::span<LoadedMesh::Vertex const> vertices, VertexEncoding encoding)
+{
+	EncodedVertices encoded;
+	encoded.encoding = encoding;
+
+	if (encoding == VertexEncoding::Float32)
+	{
+		auto const bytes = toByteSpan(vertices);
+		encoded.data.assign(bytes.begin(), bytes.end());
+		return encoded;
+	}
+	
+	Bounds const bounds = computeBounds(vertices);
+	glm::vec3 const center = (bounds.aabbMin + bounds.aabbMax) * 0.5f;
+	glm::vec3 extent = (bounds.aabbMax - bounds.aabbMin) * 0.5f;
+	// flat meshes, avoid dividing by 0
+	extent = glm::max(extent, glm::vec3(std::numeric_limits<float>::min()));
+
+	// decoded = center + q * scale
+	glm::vec3 const scale = encoding == VertexEncoding::QuantizedSnorm16 ? extent : glm::vec3(1.0f);
+	encoded.dequantization = glm::scale(glm::translate(glm::mat4(1.0f), center), scale);
+	
+	encoded.data.resize(vertices.size() * sizeof(QuantizedVertex));
+	uint8* dst = encoded.data.data();
+	
+	for (auto const& vertex : vertices)
+	{
+		glm::vec3 const local = (vertex.pos - center) / scale;
+		
+		QuantizedVertex q;
+		uint64 const position = encoding == VertexEncoding::QuantizedSnorm16
+			? glm::packSnorm4x16(glm::vec4(local, 0.0f))
+			: glm::packHalf4x16(glm::vec4(local, 0.0f));
+		memcpy(q.position, &position, sizeof(position));
+		q.normal = glm::packSnorm2x16(octahedralEncode(vertex.normal));
+		q.color = glm::packUnorm4x8(glm::vec4(glm::clamp(vertex.color, 0.0f, 1.0f), 1.0f));
+		q.uv = glm::packHalf2x16(vertex.uv);
+
+		memcpy(dst, &q, sizeof(q));
+		dst += sizeof(q);
+	}
+	
+	return encoded;
+}
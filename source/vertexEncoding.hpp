@@ -0,0 +1,41 @@
+#pragma once
+
+#include <array>
+#include <span>
+#include <vector>
+#include <glm/glm.hpp>
+#include <vulkan/vulkan.hpp>
+
+#include "ice.hpp"
+
+// Vertex stream encodings, attributes always follow the shader locations: 0 position, 1 normal, 2 color, 3 uv
+enum class VertexEncoding : uint8
+{
+	// LoadedMesh::Vertex as is, 44 bytes
+	Float32,
+	// half float positions relative to the bounds center, 20 bytes
+	QuantizedHalf,
+	// snorm16 positions normalized to the bounds, 20 bytes
+	QuantizedSnorm16,
+};
+// Quantized encodings store octahedral snorm16 normals, unorm8 colors and half float uvs,
+// the normal must be decoded by the vertex shader (see shaders/baseQuantized.vert)
+
+uint32 constexpr vertexAttributeCount = 4;
+
+// Vertex input formats by location, to be used in place of the reflected ones
+std::array<vk::Format, vertexAttributeCount> getVertexAttributeFormats(VertexEncoding encoding);
+uint32 getVertexStride(VertexEncoding encoding);
+
+// see encodeVertices in mesh.hpp
+struct EncodedVertices
+{
+	std::vector<uint8> data;
+	VertexEncoding encoding = VertexEncoding::Float32;
+	// bring decoded positions back to mesh space, must be applied before the model matrix
+	glm::mat4 dequantization = glm::mat4(1.0f);
+};
+
+// unit vector to [-1, 1]^2 octahedral mapping
+glm::vec2 octahedralEncode(glm::vec3 n);
+glm::vec3 octahedralDecode(glm::vec2 e);
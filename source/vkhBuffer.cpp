@@ -2,12 +2,16 @@
 #include "vkhImage.hpp"
 
 #include "vkhCommandBuffers.hpp"
+#include "vkhDeviceContext.hpp"
+#include "vkhUploadManager.hpp"
+#include "vkhUtility.hpp"
 
 using namespace vkh;
 
 Buffer::Buffer(Buffer&& rhs) noexcept :
-	buffer(rhs.buffer)
+	buffer(rhs.buffer), allocation(rhs.allocation), deviceContext(rhs.deviceContext), size(rhs.size), location(rhs.location), mapped(rhs.mapped)
 {
+	rhs.mapped = nullptr;
 	rhs.buffer = vk::Buffer();
 }
 
@@ -15,21 +19,60 @@ Buffer& Buffer::operator=(Buffer&& rhs) noexcept
 {
 	destroy();
 	buffer = rhs.buffer;
+	allocation = rhs.allocation;
+	deviceContext = rhs.deviceContext;
+	size = rhs.size;
+	location = rhs.location;
+	mapped = rhs.mapped;
 	rhs.buffer = vk::Buffer();
+	rhs.mapped = nullptr;
 	return *this;
 }
 
-// @TODO handle buffer creation with staging buffer
 void Buffer::create(vkh::DeviceContext& ctx, vk::BufferCreateInfo const& bufferInfo, vma::AllocationCreateInfo const& allocInfo)
+{
+	if (tryCreate(ctx, bufferInfo, allocInfo) != vk::Result::eSuccess)
+	{
+		throw std::runtime_error("failed to create buffer");
+	}
+}
+
+vk::Result Buffer::tryCreate(vkh::DeviceContext& ctx, vk::BufferCreateInfo const& bufferInfo, vma::AllocationCreateInfo const& allocInfo)
 {
 	deviceContext = &ctx;
 	
-	vk::Result res = ctx.gpuAllocator.createBuffer(&bufferInfo, &allocInfo, &buffer, &allocation, nullptr);
+	vma::AllocationInfo allocationInfo;
+	vk::Result res = ctx.gpuAllocator.createBuffer(&bufferInfo, &allocInfo, &buffer, &allocation, &allocationInfo);
 	size = bufferInfo.size;
 	if (res != vk::Result::eSuccess)
 	{
-		throw std::runtime_error("failed to create buffer");
+		return res;
+	}
+	mapped = allocationInfo.pMappedData;
+	location = allocInfo.usage == vma::MemoryUsage::eGpuOnly ? BufferLocation::DeviceLocal : mapped ? BufferLocation::HostMapped : BufferLocation::HostVisible;
+	return res;
+}
+
+void Buffer::create(vkh::DeviceContext& ctx, vk::BufferCreateInfo bufferInfo, BufferLocation location_, std::span<uint8 const> initialData)
+{
+	vma::AllocationCreateInfo allocInfo;
+	if (location_ == BufferLocation::DeviceLocal)
+	{
+		bufferInfo.usage |= vk::BufferUsageFlagBits::eTransferDst;
+		allocInfo.usage = vma::MemoryUsage::eGpuOnly;
 	}
+	else
+	{
+		allocInfo.usage = vma::MemoryUsage::eCpuToGpu;
+		if (location_ == BufferLocation::HostMapped)
+			allocInfo.flags = vma::AllocationCreateFlagBits::eMapped;
+	}
+
+	create(ctx, bufferInfo, allocInfo);
+	location = location_;
+	
+	if (!initialData.empty())
+		upload(initialData);
 }
 
 void Buffer::destroy()
@@ -38,47 +81,132 @@ void Buffer::destroy()
 	{
 		deviceContext->gpuAllocator.destroyBuffer(buffer, allocation);
 		buffer = vk::Buffer();
+		mapped = nullptr;
 	}
 }
 
-	// @Review persistent mapped memory ?
 void* Buffer::map()
 {
+	if (mapped)
+		return mapped;
 	return deviceContext->gpuAllocator.mapMemory(allocation);
 }
 
 void Buffer::unmap()
 {
-	deviceContext->gpuAllocator.unmapMemory(allocation);
+	if (!mapped)
+		deviceContext->gpuAllocator.unmapMemory(allocation);
 }
 
-void Buffer::writeData(std::span<uint8> data)
+void Buffer::flush(vk::DeviceSize offset, vk::DeviceSize range)
 {
-	assert(data.size_bytes() <= size);
+	deviceContext->gpuAllocator.flushAllocation(allocation, offset, range);
+}
 
-	void* mapped = map();
-		memcpy(mapped, data.data(), data.size_bytes());
+void Buffer::writeData(std::span<uint8 const> data, vk::DeviceSize offset)
+{
+	assert(offset + data.size_bytes() <= size);
+
+	uint8* dst = static_cast<uint8*>(map());
+		memcpy(dst + offset, data.data(), data.size_bytes());
+		flush(offset, data.size_bytes());
 	unmap();
 }
 
+void Buffer::upload(std::span<uint8 const> data, vk::DeviceSize offset)
+{
+	assert(offset + data.size_bytes() <= size);
+	
+	// the location is trusted over the memory type, GpuOnly memory can be host visible on integrated GPUs
+	if (location != BufferLocation::DeviceLocal)
+	{
+		writeData(data, offset);
+		return;
+	}
+
+	if (deviceContext->uploadManager)
+	{
+		deviceContext->uploadManager->uploadBuffer(*this, data, offset);
+		return;
+	}
+
+	vk::BufferCreateInfo stagingBufferInfo;
+	stagingBufferInfo.usage = vk::BufferUsageFlagBits::eTransferSrc;
+	stagingBufferInfo.size = data.size_bytes();
+	stagingBufferInfo.sharingMode = vk::SharingMode::eExclusive;
+
+	vma::AllocationCreateInfo stagingAllocInfo;
+	stagingAllocInfo.usage = vma::MemoryUsage::eCpuOnly;
+
+	vkh::Buffer stagingBuffer;
+	stagingBuffer.create(*deviceContext, stagingBufferInfo, stagingAllocInfo);
+	stagingBuffer.writeData(data);
+	
+	{
+		vkh::SingleTimeCommandBuffer cmd(*deviceContext);
+		vk::BufferCopy region{ 0, offset, data.size_bytes() };
+		cmd->copyBuffer(stagingBuffer.buffer, buffer, { region });
+
+		// make the copy visible to the draws of later frames instead of waiting for it
+		vk::BufferMemoryBarrier barrier;
+		barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+		barrier.dstAccessMask = vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eIndexRead | vk::AccessFlagBits::eUniformRead | vk::AccessFlagBits::eShaderRead;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer = buffer;
+		barrier.offset = offset;
+		barrier.size = data.size_bytes();
+		cmd->pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+			vk::PipelineStageFlagBits::eVertexInput | vk::PipelineStageFlagBits::eVertexShader | vk::PipelineStageFlagBits::eFragmentShader,
+			vk::DependencyFlags(), 0, nullptr, 1, &barrier, 0, nullptr);
+
+		// the staging buffer is released once the copy is done
+		std::vector<vkh::Buffer> keepAlive;
+		keepAlive.push_back(std::move(stagingBuffer));
+		cmd.endAsync(std::move(keepAlive));
+	}
+	deviceContext->stagedBytes += data.size_bytes();
+}
+
 void Buffer::copyToImage(vkh::Image& img)
 {
 	vkh::SingleTimeCommandBuffer cmd(*deviceContext);
 
-	vk::BufferImageCopy region{};
-	region.bufferOffset = 0;
-	region.bufferRowLength = 0;
-	region.bufferImageHeight = 0;
+	// every tightly packed level the buffer holds
+	std::vector<vk::BufferImageCopy> regions;
+	vk::DeviceSize bufferOffset = 0;
+	for (uint32 level = 0; level < img.imageInfo.mipLevels; level++)
+	{
+		vk::DeviceSize const levelSize = vkh::getMipLevelSize(img.imageInfo.format, img.imageInfo.extent, level) * img.imageInfo.arrayLayers;
+		if (bufferOffset + levelSize > size)
+			break;
+
+		vk::BufferImageCopy& region = regions.emplace_back();
+		region.bufferOffset = bufferOffset;
+		region.bufferRowLength = 0;
+		region.bufferImageHeight = 0;
+
+		region.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+		region.imageSubresource.mipLevel = level;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = img.imageInfo.arrayLayers;
+
+		region.imageOffset = vk::Offset3D{ 0, 0, 0 };
+		region.imageExtent = vkh::getMipExtent(img.imageInfo.extent, level);
+		bufferOffset += levelSize;
+	}
 
-	region.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-	region.imageSubresource.mipLevel = 0;
-	region.imageSubresource.baseArrayLayer = 0;
-	region.imageSubresource.layerCount = img.imageInfo.arrayLayers;
+	cmd->copyBufferToImage(buffer, img.handle, vk::ImageLayout::eTransferDstOptimal, regions);
+}
 
-	region.imageOffset = vk::Offset3D{ 0, 0, 0 };
-	region.imageExtent = img.imageInfo.extent;
+uint32 Buffer::getMemoryTypeIndex() const
+{
+	return deviceContext->gpuAllocator.getAllocationInfo(allocation).memoryType;
+}
 
-	cmd->copyBufferToImage(buffer, img.handle, vk::ImageLayout::eTransferDstOptimal, { region });
+vk::MemoryPropertyFlags Buffer::getMemoryProperties() const
+{
+	return deviceContext->gpuAllocator.getMemoryTypeProperties(getMemoryTypeIndex());
 }
 
 Buffer::~Buffer()
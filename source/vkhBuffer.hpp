@@ -2,6 +2,7 @@
 
 #include <vulkan/vulkan.hpp>
 #include <vma/vk_mem_alloc.hpp>
+#include <cassert>
 #include <span>
 
 #include "ice.hpp"
@@ -11,6 +12,16 @@ namespace vkh
 	struct DeviceContext;
 	struct Image;
 
+	enum class BufferLocation
+	{
+		// GpuOnly memory filled through a staging buffer, for static data
+		DeviceLocal,
+		// CpuToGpu memory written directly, for data updated by the CPU
+		HostVisible,
+		// HostVisible mapped once for the buffer lifetime, for data updated every frame or from worker threads
+		HostMapped,
+	};
+
 	class Buffer
 	{
 		
@@ -23,14 +34,38 @@ namespace vkh
 		
 		ICE_NON_COPYABLE_CLASS(Buffer)
 		
+		// allocations created with AllocationCreateFlagBits::eMapped stay mapped, see getMapped
 		void create(vkh::DeviceContext& ctx, vk::BufferCreateInfo const& bufferInfo, vma::AllocationCreateInfo const& allocInfo);
+		// create without throwing, e.g. to fall back on another allocation when a pool is full
+		[[nodiscard]] vk::Result tryCreate(vkh::DeviceContext& ctx, vk::BufferCreateInfo const& bufferInfo, vma::AllocationCreateInfo const& allocInfo);
+		// device local buffers get eTransferDst added to their usage, initialData is uploaded when not empty
+		void create(vkh::DeviceContext& ctx, vk::BufferCreateInfo bufferInfo, BufferLocation location, std::span<uint8 const> initialData = {});
 		
 		void destroy();
 
+		// return the persistent mapping when there is one, unmap is a no-op then
 		[[nodiscard]] void* map();
 		void unmap();
+
+		[[nodiscard]] bool isMapped() const noexcept
+		{
+			return mapped != nullptr;
+		}
 		
-		void writeData(std::span<uint8> data);
+		template<typename T = uint8>
+		[[nodiscard]] T* getMapped(vk::DeviceSize offset = 0) const noexcept
+		{
+			assert(mapped && offset < size);
+			return reinterpret_cast<T*>(static_cast<uint8*>(mapped) + offset);
+		}
+
+		// make CPU writes visible to the device, no-op on host coherent memory
+		void flush(vk::DeviceSize offset = 0, vk::DeviceSize range = VK_WHOLE_SIZE);
+		
+		void writeData(std::span<uint8 const> data, vk::DeviceSize offset = 0);
+		// writeData for host visible buffers, otherwise batched in the upload manager of the device context when it has one,
+		// or copied from a staging buffer with an asynchronous one time submission
+		void upload(std::span<uint8 const> data, vk::DeviceSize offset = 0);
 
 		template<typename T>
 		void writeStruct(T&& struct_)
@@ -38,7 +73,11 @@ namespace vkh
 			writeData({ reinterpret_cast<uint8*>(&struct_), sizeof(T) });
 		}
 
+		// copy the tightly packed mip levels held by the buffer, the image must be in eTransferDstOptimal
 		void copyToImage(vkh::Image& img);
+
+		[[nodiscard]] uint32 getMemoryTypeIndex() const;
+		[[nodiscard]] vk::MemoryPropertyFlags getMemoryProperties() const;
 		
 		~Buffer();
 		
@@ -46,5 +85,7 @@ namespace vkh
 		vma::Allocation allocation;
 		vkh::DeviceContext* deviceContext;
 		vk::DeviceSize size;
+		BufferLocation location = BufferLocation::HostVisible;
+		void* mapped = nullptr;
 	};
 }
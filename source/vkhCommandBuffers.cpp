@@ -25,30 +25,107 @@ void CommandBuffers::destroy()
 	commandBuffers.clear();
 }
 
-SingleTimeCommandBuffer::SingleTimeCommandBuffer(vkh::DeviceContext& ctx) : deviceContext(ctx)
+void OneTimeCommandPool::create(vkh::DeviceContext& ctx, uint32 queueFamilyIndex, vkh::QueueTimeline& timeline_)
 {
-	vk::CommandBufferAllocateInfo allocInfo;
-	allocInfo.commandPool = ctx.commandPool;
-	allocInfo.commandBufferCount = 1;
-	allocInfo.level = vk::CommandBufferLevel::ePrimary;
-	cmdBuffer = std::move(ctx.device.allocateCommandBuffersUnique(allocInfo)[0]);
+	deviceContext = &ctx;
+	timeline = &timeline_;
+
+	vk::CommandPoolCreateInfo poolCreateInfo{};
+	poolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+	poolCreateInfo.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer | vk::CommandPoolCreateFlagBits::eTransient;
+	commandPool = ctx.device.createCommandPoolUnique(poolCreateInfo, ctx.allocationCallbacks);
+}
+
+void OneTimeCommandPool::destroy()
+{
+	if (!deviceContext)
+		return;
+
+	if (!pending.empty())
+		wait(pending.back().token);
+	freeCommandBuffers.clear();
+	commandPool.reset();
+	deviceContext = nullptr;
+}
+
+vk::CommandBuffer OneTimeCommandPool::begin()
+{
+	vk::CommandBuffer cmdBuffer;
+	if (!freeCommandBuffers.empty())
+	{
+		cmdBuffer = freeCommandBuffers.back();
+		freeCommandBuffers.pop_back();
+	}
+	else
+	{
+		vk::CommandBufferAllocateInfo allocInfo;
+		allocInfo.commandPool = *commandPool;
+		allocInfo.commandBufferCount = 1;
+		allocInfo.level = vk::CommandBufferLevel::ePrimary;
+		cmdBuffer = deviceContext->device.allocateCommandBuffers(allocInfo)[0];
+	}
 
 	vk::CommandBufferBeginInfo beginInfo;
 	beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
-	cmdBuffer->begin(beginInfo);
+	cmdBuffer.begin(beginInfo);
+	return cmdBuffer;
+}
+
+OneTimeCommandPool::Token OneTimeCommandPool::submit(vk::CommandBuffer cmdBuffer, std::vector<vkh::Buffer> keepAlive, std::span<vkh::SemaphoreWait const> waits)
+{
+	cmdBuffer.end();
+
+	Submission submission;
+	submission.token = timeline->submit({ &cmdBuffer, 1 }, waits);
+	submission.cmdBuffer = cmdBuffer;
+	submission.keepAlive = std::move(keepAlive);
+
+	pending.push_back(std::move(submission));
+	return pending.back().token;
+}
+
+void OneTimeCommandPool::update()
+{
+	uint64 const completed = timeline->getCompleted();
+	while (!pending.empty() && pending.front().token <= completed)
+	{
+		pending.front().cmdBuffer.reset();
+		freeCommandBuffers.push_back(pending.front().cmdBuffer);
+		pending.pop_front();
+	}
+}
+
+bool OneTimeCommandPool::isComplete(Token token)
+{
+	update();
+	return timeline->isComplete(token);
+}
+
+void OneTimeCommandPool::wait(Token token)
+{
+	timeline->wait(token);
+	update();
+}
+
+SingleTimeCommandBuffer::SingleTimeCommandBuffer(vkh::DeviceContext& ctx) : deviceContext(ctx), cmdBuffer(ctx.oneTimeCommands.begin())
+{
 }
 
 SingleTimeCommandBuffer::~SingleTimeCommandBuffer()
 {
-	end();
+	if (cmdBuffer)
+		end();
 }
 
 void SingleTimeCommandBuffer::end()
 {
-	cmdBuffer->end();
-	vk::SubmitInfo submitInfo;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &cmdBuffer.get();
-	deviceContext.graphicsQueue.submit(submitInfo, vk::Fence{});
-	deviceContext.graphicsQueue.waitIdle();
+	deviceContext.oneTimeCommands.wait(endAsync());
+}
+
+OneTimeCommandPool::Token SingleTimeCommandBuffer::endAsync(std::vector<vkh::Buffer> keepAlive)
+{
+	assert(cmdBuffer);
+	OneTimeCommandPool::Token const token = deviceContext.oneTimeCommands.submit(cmdBuffer, std::move(keepAlive));
+	cmdBuffer = vk::CommandBuffer();
+	return token;
 }
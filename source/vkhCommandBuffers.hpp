@@ -1,7 +1,13 @@
 #pragma once
 
+#include <deque>
+#include <span>
+#include <vector>
 #include <vulkan/vulkan.hpp>
+
 #include "ice.hpp"
+#include "vkhBuffer.hpp"
+#include "vkhQueueTimeline.hpp"
 
 namespace vkh
 {
@@ -19,6 +25,50 @@ namespace vkh
 		std::vector<vk::UniqueCommandBuffer> commandBuffers;
 	};
 
+	// Recycled command buffers for one time submissions on a single queue
+	// Submissions return the value they signal on the queue timeline instead of waiting for the queue to be idle.
+	// Submissions of a pool run in order on its queue, so dependent work only needs pipeline barriers, not a CPU wait.
+	// Not thread safe, meant to be used by the render thread.
+	class OneTimeCommandPool
+	{
+	public:
+		// timeline value of a submission
+		using Token = uint64;
+
+		OneTimeCommandPool() = default;
+		ICE_NON_DISPATCHABLE_CLASS(OneTimeCommandPool)
+
+		void create(vkh::DeviceContext& ctx, uint32 queueFamilyIndex, vkh::QueueTimeline& timeline);
+		// wait for every pending submission
+		void destroy();
+
+		// begun with eOneTimeSubmit
+		[[nodiscard]] vk::CommandBuffer begin();
+		// end and submit, keepAlive is destroyed once the command buffer completed, e.g. staging buffers read by the commands
+		Token submit(vk::CommandBuffer cmdBuffer, std::vector<vkh::Buffer> keepAlive = {}, std::span<vkh::SemaphoreWait const> waits = {});
+
+		// recycle the command buffers of completed submissions
+		void update();
+		[[nodiscard]] bool isComplete(Token token);
+		void wait(Token token);
+
+	private:
+		struct Submission
+		{
+			Token token;
+			vk::CommandBuffer cmdBuffer;
+			std::vector<vkh::Buffer> keepAlive;
+		};
+
+		vkh::DeviceContext* deviceContext = nullptr;
+		vkh::QueueTimeline* timeline = nullptr;
+		vk::UniqueCommandPool commandPool;
+
+		std::deque<Submission> pending;
+		std::vector<vk::CommandBuffer> freeCommandBuffers;
+	};
+
+	// Command buffer of DeviceContext::oneTimeCommands, submitted when destroyed if not already
 	struct SingleTimeCommandBuffer
 	{
 		SingleTimeCommandBuffer(vkh::DeviceContext& ctx);
@@ -26,23 +76,26 @@ namespace vkh
 		
 		operator vk::CommandBuffer()
 		{
-			return *cmdBuffer;
+			return cmdBuffer;
 		}
 
 		operator VkCommandBuffer()
 		{
-			return (VkCommandBuffer)*cmdBuffer;
+			return (VkCommandBuffer)cmdBuffer;
 		}
 
 		vk::CommandBuffer* operator->()
 		{
-			return &*cmdBuffer;
+			return &cmdBuffer;
 		}
 		
+		// submit and wait for this command buffer only
 		void end();
+		// submit without waiting, later one time submissions and frames are ordered after it on the graphics queue
+		OneTimeCommandPool::Token endAsync(std::vector<vkh::Buffer> keepAlive = {});
 		
 	private:
 		vkh::DeviceContext& deviceContext;
-		vk::UniqueCommandBuffer cmdBuffer;
+		vk::CommandBuffer cmdBuffer;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,47 @@
+#include "vkhDeletionQueue.hpp"
+
+#include <algorithm>
+
+#include "vkhQueueTimeline.hpp"
+
+using namespace vkh;
+
+void DeletionQueue::create(vkh::QueueTimeline& timeline_)
+{
+	timeline = &timeline_;
+}
+
+void DeletionQueue::destroy()
+{
+	for (auto& entry : entries)
+		entry.resource.reset();
+	entries.clear();
+	for (auto& resource : pending)
+		resource.reset();
+	pending.clear();
+	timeline = nullptr;
+}
+
+void DeletionQueue::seal(uint64 value)
+{
+	for (auto& resource : pending)
+		insert(value, std::move(resource));
+	pending.clear();
+}
+
+void DeletionQueue::update()
+{
+	uint64 const completed = timeline->getCompleted();
+	// in push order for a value, views must go before the images or swapchains they were created from
+	while (!entries.empty() && entries.front().value <= completed)
+	{
+		entries.front().resource.reset();
+		entries.pop_front();
+	}
+}
+
+void DeletionQueue::insert(uint64 value, std::shared_ptr<void> resource)
+{
+	auto const it = std::upper_bound(entries.begin(), entries.end(), value, [](uint64 v, Entry const& entry) { return v < entry.value; });
+	entries.insert(it, { value, std::move(resource) });
+}
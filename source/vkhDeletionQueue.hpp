@@ -0,0 +1,64 @@
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "ice.hpp"
+
+namespace vkh
+{
+	class QueueTimeline;
+
+	// Resources destroyed once the GPU is done with them instead of waiting for the device to be idle
+	// Anything destroying GPU objects in its destructor can be pushed: vkh::Buffer, vkh::Image, vk::Unique* or containers of them.
+	// Resources pushed without value are keyed on the next sealed submission, i.e. the next frame, since they may be used by the
+	// frame being recorded. They are destroyed in push order once their timeline value completed.
+	// Not thread safe, meant to be used by the render thread.
+	class DeletionQueue
+	{
+	public:
+		DeletionQueue() = default;
+		ICE_NON_DISPATCHABLE_CLASS(DeletionQueue)
+
+		void create(vkh::QueueTimeline& timeline);
+		// destroy everything left, the device must be idle
+		void destroy();
+
+		template<typename T>
+		void push(T&& resource)
+		{
+			static_assert(!std::is_lvalue_reference_v<T>, "resources are moved in the deletion queue");
+			pending.push_back(std::make_shared<T>(std::move(resource)));
+		}
+
+		// destroyed once value completed on the timeline, e.g. the value of a one time submission
+		template<typename T>
+		void push(T&& resource, uint64 value)
+		{
+			static_assert(!std::is_lvalue_reference_v<T>, "resources are moved in the deletion queue");
+			insert(value, std::make_shared<T>(std::move(resource)));
+		}
+
+		// key pending resources on value, after submitting the work that may use them
+		void seal(uint64 value);
+		// destroy resources whose value completed
+		void update();
+
+	private:
+		struct Entry
+		{
+			uint64 value;
+			// type erased, the deleter of make_shared destroys the resource
+			std::shared_ptr<void> resource;
+		};
+
+		// after the entries of the same or a lower value, entries stay sorted by value then push order
+		void insert(uint64 value, std::shared_ptr<void> resource);
+
+		vkh::QueueTimeline* timeline = nullptr;
+		std::vector<std::shared_ptr<void>> pending;
+		std::deque<Entry> entries;
+	};
+}
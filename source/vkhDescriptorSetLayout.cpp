@@ -1,12 +1,14 @@
 #include "vkhDescriptorSetLayout.hpp"
 
+#include <algorithm>
+
 #include "vkhDeviceContext.hpp"
 #include "vkhShader.hpp"
 #include "utility.hpp"
 
 using namespace vkh;
 
-void ShaderDescriptorLayout::create(vkh::DeviceContext& ctx, std::span<ShaderReflector const*> shadersInfos)
+void ShaderDescriptorLayout::create(vkh::DeviceContext& ctx, std::span<ShaderReflector const*> shadersInfos, std::span<DescriptorSetIndex const> dynamicUniformSets)
 {
 	deviceContext = &ctx;
 	std::vector<ShaderReflector::DescriptorSetLayoutData> dsLayoutData;
@@ -27,12 +29,16 @@ void ShaderDescriptorLayout::create(vkh::DeviceContext& ctx, std::span<ShaderRef
 	// set correct shader stages to bindings
 	for (auto& dsLayout : dsLayoutData)
 	{
+		bool const dynamicUniforms = std::find(dynamicUniformSets.begin(), dynamicUniformSets.end(), dsLayout.set_number) != dynamicUniformSets.end();
 		for(auto& binding : dsLayout.bindings)
 		{
 			for (auto const& shaderInfo : shadersInfos)
 			{
 				binding.stageFlags |= shaderInfo->getShaderStage();
 			}
+			
+			if (dynamicUniforms && binding.descriptorType == vk::DescriptorType::eUniformBuffer)
+				binding.descriptorType = vk::DescriptorType::eUniformBufferDynamic;
 		}
 	}
 	
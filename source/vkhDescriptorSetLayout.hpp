@@ -21,7 +21,8 @@ namespace vkh
 	
 	struct ShaderDescriptorLayout
 	{
-		void create(vkh::DeviceContext& ctx, std::span<ShaderReflector const*> shadersInfos);
+		// uniform buffers of dynamicUniformSets are created as eUniformBufferDynamic, see FrameRingBuffer
+		void create(vkh::DeviceContext& ctx, std::span<ShaderReflector const*> shadersInfos, std::span<DescriptorSetIndex const> dynamicUniformSets = {});
 
 		void destroy();
 
@@ -59,6 +59,14 @@ void vkh::DeviceContext::create(vkh::Instance const& instance, vk::SurfaceKHR co
 
 	checkRequiredExtensions(physicalDevice);
 
+	// every queue submission is synchronized with timeline semaphores (see QueueTimeline)
+	vk::PhysicalDeviceTimelineSemaphoreFeatures supportedTimelineFeatures = {};
+	vk::PhysicalDeviceFeatures2 supportedFeatures = {};
+	supportedFeatures.pNext = &supportedTimelineFeatures;
+	physicalDevice.getFeatures2(&supportedFeatures);
+	if (!supportedTimelineFeatures.timelineSemaphore)
+		throw std::runtime_error("the device does not support timeline semaphores");
+
 	auto const queueFamilies = physicalDevice.getQueueFamilyProperties();
 
 	// Find the graphics queue.
@@ -110,7 +118,11 @@ void vkh::DeviceContext::create(vkh::Instance const& instance, vk::SurfaceKHR co
 	deviceFeatures.fillModeNonSolid = true;
 	deviceFeatures.samplerAnisotropy = true;
 
+	vk::PhysicalDeviceTimelineSemaphoreFeatures timelineFeatures = {};
+	timelineFeatures.timelineSemaphore = true;
+
 	vk::PhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = {};
+	indexingFeatures.pNext = &timelineFeatures;
 	indexingFeatures.runtimeDescriptorArray = true;
 
 	vk::DeviceCreateInfo createInfo = {};
@@ -130,6 +142,11 @@ void vkh::DeviceContext::create(vkh::Instance const& instance, vk::SurfaceKHR co
 	presentQueue = device.getQueue(presentFamilyIndex, 0);
 	transferQueue = device.getQueue(transferFamilyIndex, 0);
 
+	graphicsTimeline.create(*this, graphicsQueue);
+	transferTimeline.create(*this, transferQueue);
+	computeTimeline.create(*this, computeQueue);
+	deletionQueue.create(graphicsTimeline);
+
 	vma::AllocatorCreateInfo allocatorInfo;
 	allocatorInfo.vulkanApiVersion = VK_API_VERSION_1_1;
 	allocatorInfo.instance = *instance.handle;
@@ -144,11 +161,18 @@ void vkh::DeviceContext::create(vkh::Instance const& instance, vk::SurfaceKHR co
 	poolCreateInfo.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
 	
 	commandPool = device.createCommandPool(poolCreateInfo, allocationCallbacks);
+
+	oneTimeCommands.create(*this, graphicsFamilyIndex, graphicsTimeline);
 }
 
 void vkh::DeviceContext::destroy()
 {
+	oneTimeCommands.destroy();
+	deletionQueue.destroy();
 	device.destroyCommandPool(commandPool, allocationCallbacks);
+	graphicsTimeline.destroy();
+	transferTimeline.destroy();
+	computeTimeline.destroy();
 	gpuAllocator.destroy();
 	device.destroy(allocationCallbacks);
 }
@@ -4,10 +4,15 @@
 #include <vma/vk_mem_alloc.hpp>
 
 #include "ice.hpp"
+#include "vkhCommandBuffers.hpp"
+#include "vkhDeletionQueue.hpp"
 #include "vkhInstance.hpp"
+#include "vkhQueueTimeline.hpp"
 
 namespace vkh
 {
+	class UploadManager;
+
 	struct DeviceContext
 	{
 		void create(vkh::Instance const& instance, vk::SurfaceKHR const& surface_, std::span<const char*> requiredExtensions_);
@@ -20,8 +25,14 @@ namespace vkh
 		std::vector<const char*> requiredExtensions;
 
 		vk::CommandPool commandPool;
+		// one time submissions on the graphics queue, see SingleTimeCommandBuffer
+		vkh::OneTimeCommandPool oneTimeCommands;
 		
 		vma::Allocator gpuAllocator;
+		// bytes copied from staging buffers to device local buffers
+		vk::DeviceSize stagedBytes = 0;
+		// set by its owner, uploads wait for a copy on the graphics queue without it
+		vkh::UploadManager* uploadManager = nullptr;
 
 		uint32 graphicsFamilyIndex;
 		uint32 computeFamilyIndex;
@@ -32,5 +43,13 @@ namespace vkh
 		vk::Queue presentQueue;
 		vk::Queue transferQueue;
 		vk::Queue computeQueue;
+
+		// every submission to a queue goes through its timeline
+		vkh::QueueTimeline graphicsTimeline;
+		vkh::QueueTimeline transferTimeline;
+		vkh::QueueTimeline computeTimeline;
+
+		// on the graphics timeline, sealed by every frame
+		vkh::DeletionQueue deletionQueue;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,61 @@
+#include "vkhFrameRingBuffer.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "vkhDeviceContext.hpp"
+
+using namespace vkh;
+
+static vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+void FrameRingBuffer::create(vkh::DeviceContext& ctx, vk::DeviceSize frameSize_, uint32 frameCount)
+{
+	vk::PhysicalDeviceLimits const limits = ctx.physicalDevice.getProperties().limits;
+	alignment = std::max(limits.minUniformBufferOffsetAlignment, limits.minStorageBufferOffsetAlignment);
+	frameSize = alignUp(frameSize_, alignment);
+	
+	vk::BufferCreateInfo bufferInfo;
+	bufferInfo.usage = vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eStorageBuffer;
+	bufferInfo.size = frameSize * frameCount;
+	bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+	buffer.create(ctx, bufferInfo, BufferLocation::HostMapped);
+
+	frameBegin = 0;
+	head = 0;
+}
+
+void FrameRingBuffer::destroy()
+{
+	buffer.destroy();
+}
+
+void FrameRingBuffer::beginFrame(uint32 frameIndex)
+{
+	frameBegin = frameIndex * frameSize;
+	head = frameBegin;
+}
+
+void FrameRingBuffer::endFrame()
+{
+	if (head > frameBegin)
+		buffer.flush(frameBegin, head - frameBegin);
+}
+
+FrameRingBuffer::Allocation FrameRingBuffer::allocate(vk::DeviceSize size)
+{
+	vk::DeviceSize const offset = alignUp(head, alignment);
+	if (offset + size > frameBegin + frameSize)
+		throw std::runtime_error("frame ring buffer is full");
+
+	head = offset + size;
+	return { static_cast<uint32>(offset), buffer.getMapped(offset) };
+}
+
+vk::DescriptorBufferInfo FrameRingBuffer::getDescriptorInfo(vk::DeviceSize range) const
+{
+	return { buffer.buffer, 0, range };
+}
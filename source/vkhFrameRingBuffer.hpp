@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstring>
+#include <vulkan/vulkan.hpp>
+
+#include "ice.hpp"
+#include "vkhBuffer.hpp"
+
+namespace vkh
+{
+	struct DeviceContext;
+
+	// Linear allocator for transient uniform and storage data, one region per frame in flight
+	// Blocks are bump allocated in the region of the current frame and bound with dynamic offsets,
+	// the region is reused once the fence of its frame signaled (see VulkanContext::startFrame).
+	class FrameRingBuffer
+	{
+	public:
+		struct Allocation
+		{
+			// dynamic offset of the block
+			uint32 offset;
+			void* data;
+		};
+
+		void create(vkh::DeviceContext& ctx, vk::DeviceSize frameSize, uint32 frameCount);
+		void destroy();
+
+		// reset the frame region, every block allocated the last time this frame was used must not be read anymore
+		void beginFrame(uint32 frameIndex);
+		// flush the blocks written this frame, before submitting the frame
+		void endFrame();
+
+		// aligned on minUniformBufferOffsetAlignment and minStorageBufferOffsetAlignment, throw if the frame region is full
+		[[nodiscard]] Allocation allocate(vk::DeviceSize size);
+		
+		template<typename T>
+		[[nodiscard]] uint32 push(T const& value)
+		{
+			Allocation const allocation = allocate(sizeof(T));
+			memcpy(allocation.data, &value, sizeof(T));
+			return allocation.offset;
+		}
+
+		// descriptor info of a block of range bytes, to be written in eUniformBufferDynamic or eStorageBufferDynamic bindings
+		[[nodiscard]] vk::DescriptorBufferInfo getDescriptorInfo(vk::DeviceSize range) const;
+
+		vkh::Buffer buffer;
+		vk::DeviceSize frameSize = 0;
+		vk::DeviceSize alignment = 0;
+
+	private:
+		vk::DeviceSize frameBegin = 0;
+		vk::DeviceSize head = 0;
+	};
+}
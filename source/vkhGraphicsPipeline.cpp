@@ -160,7 +160,7 @@ void vkh::GraphicsPipeline::create(vkh::DeviceContext& ctx, CreateInfo const& in
 
 	// @Review abstract pipeline layout + vertexInput (aka shader reflect infos) ?
 	ShaderReflector const* shadersInfos[] = { &info.vertexShader.reflector, &info.fragmentShader.reflector };
-	dsLayout.create(ctx, shadersInfos);
+	dsLayout.create(ctx, shadersInfos, info.dynamicUniformSets);
 
 	std::vector<vk::DescriptorSetLayout> descriptorSetLayouts;
 	descriptorSetLayouts.reserve(dsLayout.descriptorSetLayouts.size());
@@ -184,7 +184,7 @@ void vkh::GraphicsPipeline::create(vkh::DeviceContext& ctx, CreateInfo const& in
 	shaderStages[0] = info.vertexShader.getPipelineShaderStage();
 	shaderStages[1] = info.fragmentShader.getPipelineShaderStage();
 
-	auto [attributeDescriptions, bindingDescription] = info.vertexShader.reflector.getVertexDescriptions();
+	auto [attributeDescriptions, bindingDescription] = info.vertexShader.reflector.getVertexDescriptions(info.vertexAttributeFormats);
 
 	vk::PipelineVertexInputStateCreateInfo vertexInputInfo = {};
 	vertexInputInfo.vertexBindingDescriptionCount = 1;
@@ -20,6 +20,10 @@ namespace vkh
 			vk::RenderPass renderPass;
 			vk::Extent2D imageExtent;
 			vk::SampleCountFlagBits msaaSamples;
+			// per location vertex input formats overriding the reflected ones, empty to use the shader formats
+			std::vector<vk::Format> vertexAttributeFormats;
+			// sets whose uniform buffers are bound with dynamic offsets
+			std::vector<vkh::DescriptorSetIndex> dynamicUniformSets;
 		};
 		
 		void create(vkh::DeviceContext& ctx, CreateInfo const& createInfo);
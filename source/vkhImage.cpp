@@ -107,8 +107,10 @@ void Image::transitionLayout(vk::ImageLayout newLayout)
 		throw std::runtime_error("unsupported layout transition");
 	}
 	
+	// later one time submissions and frames are ordered after the barrier, no need to wait for it
 	vkh::SingleTimeCommandBuffer cmd(*deviceContext);
 	cmd->pipelineBarrier(sourceStage, destinationStage, vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1, &barrier);
+	cmd.endAsync();
 	// update current layout
 	imageInfo.initialLayout = newLayout;
 }
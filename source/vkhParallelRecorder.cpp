@@ -0,0 +1,158 @@
+#include "vkhParallelRecorder.hpp"
+
+#include <algorithm>
+
+#include "vkhDeviceContext.hpp"
+
+using namespace vkh;
+
+ParallelRecorder::~ParallelRecorder()
+{
+	destroy();
+}
+
+void ParallelRecorder::create(vkh::DeviceContext& ctx, CreateInfo const& info)
+{
+	deviceContext = &ctx;
+	threadCount = info.threadCount == 0 ? std::max(1u, std::thread::hardware_concurrency()) : info.threadCount;
+	minDrawsPerSlice = std::max(1u, info.minDrawsPerSlice);
+
+	slices.resize(static_cast<size_t>(info.frameCount) * threadCount);
+	for (auto& slice : slices)
+	{
+		vk::CommandPoolCreateInfo poolCreateInfo{};
+		poolCreateInfo.queueFamilyIndex = ctx.graphicsFamilyIndex;
+		poolCreateInfo.flags = vk::CommandPoolCreateFlagBits::eTransient;
+		slice.commandPool = ctx.device.createCommandPoolUnique(poolCreateInfo, ctx.allocationCallbacks);
+
+		vk::CommandBufferAllocateInfo allocInfo;
+		allocInfo.commandPool = *slice.commandPool;
+		allocInfo.commandBufferCount = 1;
+		allocInfo.level = vk::CommandBufferLevel::eSecondary;
+		slice.cmdBuffer = ctx.device.allocateCommandBuffers(allocInfo)[0];
+	}
+	secondaries.reserve(threadCount);
+
+	// the calling thread is the last worker
+	stopping = false;
+	for (uint32 i = 1; i < threadCount; i++)
+		workers.emplace_back(&ParallelRecorder::workerLoop, this);
+}
+
+void ParallelRecorder::destroy()
+{
+	{
+		std::lock_guard lock(mutex);
+		stopping = true;
+	}
+	workAvailable.notify_all();
+
+	for (auto& worker : workers)
+		worker.join();
+	workers.clear();
+	sliceTask = nullptr;
+
+	// command buffers are freed with their pool
+	slices.clear();
+	secondaries.clear();
+}
+
+void ParallelRecorder::record(vk::CommandBuffer primary, uint32 frameIndex, vk::CommandBufferInheritanceInfo const& inheritance, uint32 drawCount, RecordSlice const& recordSlice)
+{
+	if (drawCount == 0)
+		return;
+
+	uint32 const count = std::min(threadCount, (drawCount + minDrawsPerSlice - 1) / minDrawsPerSlice);
+	SliceContext* const frameSlices = &slices[static_cast<size_t>(frameIndex) * threadCount];
+
+	{
+		std::unique_lock lock(mutex);
+		// a worker woken late by the previous record may still be reading sliceTask
+		workDone.wait(lock, [this]() { return busyWorkers == 0; });
+
+		sliceTask = [&, count, frameSlices](uint32 i)
+		{
+			SliceContext& slice = frameSlices[i];
+			// resetting the pool is cheaper than resetting its command buffers one by one
+			deviceContext->device.resetCommandPool(*slice.commandPool, vk::CommandPoolResetFlags());
+
+			vk::CommandBufferBeginInfo beginInfo;
+			beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit | vk::CommandBufferUsageFlagBits::eRenderPassContinue;
+			beginInfo.pInheritanceInfo = &inheritance;
+			slice.cmdBuffer.begin(beginInfo);
+
+			// proportional bounds, every slice starts inside the draw list
+			uint32 const first = static_cast<uint32>(static_cast<uint64>(i) * drawCount / count);
+			uint32 const end = static_cast<uint32>(static_cast<uint64>(i + 1) * drawCount / count);
+			recordSlice(slice.cmdBuffer, first, end - first);
+
+			slice.cmdBuffer.end();
+		};
+		sliceCount = count;
+		nextSlice = 0;
+		recordedSlices = 0;
+		error = nullptr;
+		generation++;
+	}
+	if (count > 1)
+		workAvailable.notify_all();
+
+	uint32 const recorded = recordSlices();
+	{
+		std::unique_lock lock(mutex);
+		recordedSlices += recorded;
+		workDone.wait(lock, [this]() { return recordedSlices == sliceCount; });
+	}
+	if (error)
+		std::rethrow_exception(error);
+
+	secondaries.clear();
+	for (uint32 i = 0; i < count; i++)
+		secondaries.push_back(frameSlices[i].cmdBuffer);
+	primary.executeCommands(static_cast<uint32>(secondaries.size()), secondaries.data());
+}
+
+uint32 ParallelRecorder::recordSlices()
+{
+	uint32 recorded = 0;
+	for (uint32 i = nextSlice++; i < sliceCount; i = nextSlice++)
+	{
+		try
+		{
+			sliceTask(i);
+		}
+		catch (...)
+		{
+			// the other slices are still recorded, the first error is rethrown by record
+			std::lock_guard lock(mutex);
+			if (!error)
+				error = std::current_exception();
+		}
+		recorded++;
+	}
+	return recorded;
+}
+
+void ParallelRecorder::workerLoop()
+{
+	uint64 seenGeneration = 0;
+	while (true)
+	{
+		{
+			std::unique_lock lock(mutex);
+			workAvailable.wait(lock, [&]() { return stopping || generation != seenGeneration; });
+			if (stopping)
+				return;
+			seenGeneration = generation;
+			busyWorkers++;
+		}
+
+		uint32 const recorded = recordSlices();
+		{
+			std::lock_guard lock(mutex);
+			recordedSlices += recorded;
+			busyWorkers--;
+		}
+		workDone.notify_all();
+	}
+}
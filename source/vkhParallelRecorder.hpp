@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "ice.hpp"
+
+namespace vkh
+{
+	struct DeviceContext;
+
+	// Record the draws of a render pass on several threads into secondary command buffers
+	// The draw list is split in contiguous slices, each slice is recorded by a worker in a secondary command buffer
+	// of its own transient command pool, one set of pools per frame in flight so pools are reset without any wait.
+	// The workers are started once in create, the calling thread records slices too.
+	// The primary command buffer executes the secondaries in slice order, the draw order is kept.
+	class ParallelRecorder
+	{
+	public:
+		struct CreateInfo
+		{
+			uint32 frameCount;
+			// maximum number of slices recorded at once, 0 = hardware concurrency
+			uint32 threadCount = 0;
+			// fewer draws are not worth a thread
+			uint32 minDrawsPerSlice = 256;
+		};
+
+		// record draws [first, first + count), nothing is inherited from the primary: bind the pipeline and descriptor sets
+		using RecordSlice = std::function<void(vk::CommandBuffer cmdBuffer, uint32 first, uint32 count)>;
+
+		ParallelRecorder() = default;
+		ICE_NON_DISPATCHABLE_CLASS(ParallelRecorder)
+		~ParallelRecorder();
+
+		void create(vkh::DeviceContext& ctx, CreateInfo const& info);
+		void destroy();
+
+		// primary must be in the subpass of inheritance, begun with vk::SubpassContents::eSecondaryCommandBuffers
+		// recordSlice is called concurrently and must only record commands, the frame of frameIndex must have completed
+		void record(vk::CommandBuffer primary, uint32 frameIndex, vk::CommandBufferInheritanceInfo const& inheritance, uint32 drawCount, RecordSlice const& recordSlice);
+
+		[[nodiscard]] uint32 getThreadCount() const noexcept
+		{
+			return threadCount;
+		}
+
+	private:
+		// owned by a single slice at a time
+		struct SliceContext
+		{
+			vk::UniqueCommandPool commandPool;
+			vk::CommandBuffer cmdBuffer;
+		};
+
+		void workerLoop();
+		// record slices until none is left, return how many were recorded
+		uint32 recordSlices();
+
+		vkh::DeviceContext* deviceContext = nullptr;
+		uint32 threadCount = 0;
+		uint32 minDrawsPerSlice = 0;
+		// [frameIndex * threadCount + slice]
+		std::vector<SliceContext> slices;
+		std::vector<vk::CommandBuffer> secondaries;
+
+		std::mutex mutex;
+		std::condition_variable workAvailable;
+		std::condition_variable workDone;
+		bool stopping = false;
+		// incremented by every record, workers wake up once per generation
+		uint64 generation = 0;
+		std::function<void(uint32 slice)> sliceTask;
+		uint32 sliceCount = 0;
+		std::atomic<uint32> nextSlice = 0;
+		uint32 recordedSlices = 0;
+		// workers between their wake up and their last slice, sliceTask is not replaced until they are done
+		uint32 busyWorkers = 0;
+		std::exception_ptr error;
+		std::vector<std::thread> workers;
+	};
+}
@@ -0,0 +1,94 @@
+#include "vkhQueueTimeline.hpp"
+
+#include <cassert>
+#include <stdexcept>
+#include <vector>
+
+#include "vkhDeviceContext.hpp"
+
+using namespace vkh;
+
+void QueueTimeline::create(vkh::DeviceContext& ctx, vk::Queue queue_)
+{
+	deviceContext = &ctx;
+	queue = queue_;
+	lastSubmitted = 0;
+
+	vk::SemaphoreTypeCreateInfo typeInfo;
+	typeInfo.semaphoreType = vk::SemaphoreType::eTimeline;
+	typeInfo.initialValue = 0;
+
+	vk::SemaphoreCreateInfo semaphoreInfo;
+	semaphoreInfo.pNext = &typeInfo;
+	semaphore = ctx.device.createSemaphoreUnique(semaphoreInfo, ctx.allocationCallbacks);
+}
+
+void QueueTimeline::destroy()
+{
+	semaphore.reset();
+}
+
+uint64 QueueTimeline::submit(std::span<vk::CommandBuffer const> cmdBuffers, std::span<SemaphoreWait const> waits, std::span<vk::Semaphore const> binarySignals)
+{
+	std::vector<vk::Semaphore> waitSemaphores;
+	std::vector<uint64> waitValues;
+	std::vector<vk::PipelineStageFlags> waitStages;
+	waitSemaphores.reserve(waits.size());
+	waitValues.reserve(waits.size());
+	waitStages.reserve(waits.size());
+	for (auto const& wait : waits)
+	{
+		waitSemaphores.push_back(wait.semaphore);
+		waitValues.push_back(wait.value);
+		waitStages.push_back(wait.stage);
+	}
+
+	// the timeline comes first, values of binary semaphores are ignored
+	std::vector<vk::Semaphore> signalSemaphores{ *semaphore };
+	signalSemaphores.insert(signalSemaphores.end(), binarySignals.begin(), binarySignals.end());
+	std::vector<uint64> signalValues(signalSemaphores.size(), 0);
+	signalValues[0] = lastSubmitted + 1;
+
+	vk::TimelineSemaphoreSubmitInfo timelineInfo;
+	timelineInfo.waitSemaphoreValueCount = static_cast<uint32>(waitValues.size());
+	timelineInfo.pWaitSemaphoreValues = waitValues.data();
+	timelineInfo.signalSemaphoreValueCount = static_cast<uint32>(signalValues.size());
+	timelineInfo.pSignalSemaphoreValues = signalValues.data();
+
+	vk::SubmitInfo submitInfo;
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.waitSemaphoreCount = static_cast<uint32>(waitSemaphores.size());
+	submitInfo.pWaitSemaphores = waitSemaphores.data();
+	submitInfo.pWaitDstStageMask = waitStages.data();
+	submitInfo.commandBufferCount = static_cast<uint32>(cmdBuffers.size());
+	submitInfo.pCommandBuffers = cmdBuffers.data();
+	submitInfo.signalSemaphoreCount = static_cast<uint32>(signalSemaphores.size());
+	submitInfo.pSignalSemaphores = signalSemaphores.data();
+
+	queue.submit(submitInfo, vk::Fence{});
+	return ++lastSubmitted;
+}
+
+uint64 QueueTimeline::getCompleted() const
+{
+	return deviceContext->device.getSemaphoreCounterValue(*semaphore);
+}
+
+bool QueueTimeline::isComplete(uint64 value) const
+{
+	return value <= getCompleted();
+}
+
+void QueueTimeline::wait(uint64 value) const
+{
+	assert(value <= lastSubmitted);
+
+	vk::SemaphoreWaitInfo waitInfo;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &*semaphore;
+	waitInfo.pValues = &value;
+
+	vk::Result const res = deviceContext->device.waitSemaphores(waitInfo, UINT64_MAX);
+	if (res != vk::Result::eSuccess)
+		throw std::runtime_error("failed to wait for queue timeline");
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <span>
+#include <vulkan/vulkan.hpp>
+
+#include "ice.hpp"
+
+namespace vkh
+{
+	struct DeviceContext;
+
+	// wait of a submission, value is ignored for binary semaphores
+	struct SemaphoreWait
+	{
+		vk::Semaphore semaphore;
+		uint64 value = 0;
+		vk::PipelineStageFlags stage;
+	};
+
+	// Timeline semaphore of a queue, every submission made through it signals the next value
+	// A value is complete once every submission up to it is done, so any subsystem can poll or wait on
+	// work it submitted, or on work of other subsystems, without fences of its own.
+	// Not thread safe, submissions are made by the render thread.
+	class QueueTimeline
+	{
+	public:
+		QueueTimeline() = default;
+		ICE_NON_DISPATCHABLE_CLASS(QueueTimeline)
+
+		void create(vkh::DeviceContext& ctx, vk::Queue queue);
+		void destroy();
+
+		// submit and signal the next value, return it
+		uint64 submit(std::span<vk::CommandBuffer const> cmdBuffers, std::span<SemaphoreWait const> waits = {}, std::span<vk::Semaphore const> binarySignals = {});
+
+		// value signaled by the last submission, 0 before any
+		[[nodiscard]] uint64 getLastSubmitted() const noexcept
+		{
+			return lastSubmitted;
+		}
+		[[nodiscard]] uint64 getCompleted() const;
+		[[nodiscard]] bool isComplete(uint64 value) const;
+		void wait(uint64 value) const;
+
+		vk::Queue queue;
+		vk::UniqueSemaphore semaphore;
+
+	private:
+		vkh::DeviceContext* deviceContext = nullptr;
+		uint64 lastSubmitted = 0;
+	};
+}
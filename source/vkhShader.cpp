@@ -218,7 +218,7 @@ bool ShaderReflector::DescriptorSetLayoutData::operator==(DescriptorSetLayoutDat
 }
 
 // https://github.com/KhronosGroup/SPIRV-Reflect/blob/master/examples/main_io_variables.cpp
-ShaderReflector::VertexDescription ShaderReflector::getVertexDescriptions() const
+ShaderReflector::VertexDescription ShaderReflector::getVertexDescriptions(std::span<vk::Format const> formatOverrides) const
 {
 	// Enumerate and extract shader's input variables
 	uint32_t var_count = 0;
@@ -240,6 +240,8 @@ ShaderReflector::VertexDescription ShaderReflector::getVertexDescriptions() cons
 		vk::VertexInputAttributeDescription attributeDescription;
 		attributeDescription.location = var->location;
 		attributeDescription.format = static_cast<vk::Format>(var->format);
+		if (var->location < formatOverrides.size() && formatOverrides[var->location] != vk::Format::eUndefined)
+			attributeDescription.format = formatOverrides[var->location];
 		attributeDescription.binding = 0;
 		attributeDescriptions.push_back(attributeDescription);
 
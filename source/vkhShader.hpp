@@ -93,7 +93,8 @@ namespace vkh
 			bool operator==(DescriptorSetLayoutData const& rhs) const noexcept;
 		};
 		
-		[[nodiscard]] VertexDescription getVertexDescriptions() const; 
+		// formatOverrides[location] replaces the reflected format when not eUndefined, used by quantized vertex streams
+		[[nodiscard]] VertexDescription getVertexDescriptions(std::span<vk::Format const> formatOverrides = {}) const; 
 		[[nodiscard]] std::vector<ShaderReflector::DescriptorSetLayoutData> getDescriptorSetLayoutData() const;
 
 		std::vector<ReflectedDescriptorSet> createReflectedDescriptorSet() const;
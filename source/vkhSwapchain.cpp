@@ -98,7 +98,7 @@ static vk::Extent2D chooseSwapExtent(GLFWwindow* window, const vk::SurfaceCapabi
 	return actualExtent;
 }
 
-void Swapchain::create(vkh::DeviceContext* ctx, GLFWwindow* window, vk::SurfaceKHR surface, uint minImages, bool vsync)
+void Swapchain::create(vkh::DeviceContext* ctx, GLFWwindow* window, vk::SurfaceKHR surface, uint minImages, bool vsync, vk::SwapchainKHR oldSwapchain)
 {
 	assert(ctx);
 	deviceContext = ctx;
@@ -126,6 +126,7 @@ void Swapchain::create(vkh::DeviceContext* ctx, GLFWwindow* window, vk::SurfaceK
 	createInfo.compositeAlpha = vk::CompositeAlphaFlagBitsKHR::eOpaque;
 	createInfo.presentMode = vk::PresentModeKHR::eFifo;
 	createInfo.clipped = VK_TRUE;
+	createInfo.oldSwapchain = oldSwapchain;
 
 	if (deviceContext->graphicsFamilyIndex != deviceContext->presentFamilyIndex)
 	{
@@ -9,7 +9,8 @@ namespace vkh
 {
 	struct Swapchain
 	{
-		void create(vkh::DeviceContext* ctx, GLFWwindow* window, vk::SurfaceKHR surface, uint minImages, bool vsync);
+		// oldSwapchain is retired but not destroyed
+		void create(vkh::DeviceContext* ctx, GLFWwindow* window, vk::SurfaceKHR surface, uint minImages, bool vsync, vk::SwapchainKHR oldSwapchain = {});
 		void destroy();
 
 		~Swapchain();
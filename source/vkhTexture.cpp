@@ -1,141 +1,94 @@
 #include "vkhTexture.hpp"
+
+#include <cassert>
+#include <stdexcept>
+
+#include "mipGenerator.hpp"
 #include "vkhBuffer.hpp"
+#include "vkhUploadManager.hpp"
+#include "vkhUtility.hpp"
 
 using namespace vkh;
 
-static vk::DeviceSize vkFormatToSize(vk::Format fmt)
+// @Improve: All textures are created with a staging buffer for now since most textures do not need to be modified by the CPU after creation
+// The copy is batched in the upload manager of the device context when it has one
+void Texture::create(DeviceContext& ctx, CreateInfo const& info)
 {
-	switch (fmt)
+	// the upload manager blits the missing levels on the GPU, other levels are filtered on the CPU
+	std::span<uint8 const> data = info.data;
+	std::vector<uint8> mipChain;
+	bool const blitMips = ctx.uploadManager && vkh::supportsLinearBlit(ctx.physicalDevice, info.format);
+	bool const hasMipChain = info.data.size_bytes() > vkh::getMipLevelSize(info.format, vk::Extent3D{ info.width, info.height, 1 }, 0);
+	if (info.mipLevels > 1 && !hasMipChain && !blitMips)
 	{
-	case vk::Format::eR8Unorm:
-	case vk::Format::eR8Uint:
-	case vk::Format::eR8Sint: 
-	case vk::Format::eR8Srgb:
-		return 1;
-	case vk::Format::eR8G8Unorm: 
-	case vk::Format::eR8G8Snorm:
-	case vk::Format::eR8G8Uscaled:
-	case vk::Format::eR8G8Sscaled: 
-	case vk::Format::eR8G8Uint: 
-	case vk::Format::eR8G8Sint: 
-	case vk::Format::eR8G8Srgb:
-		return 2;
-	case vk::Format::eR8G8B8Unorm: 
-	case vk::Format::eR8G8B8Snorm:
-	case vk::Format::eR8G8B8Uscaled: 
-	case vk::Format::eR8G8B8Sscaled: 
-	case vk::Format::eR8G8B8Uint: 
-	case vk::Format::eR8G8B8Sint:
-	case vk::Format::eR8G8B8Srgb: 
-	case vk::Format::eB8G8R8Unorm: 
-	case vk::Format::eB8G8R8Snorm: 
-	case vk::Format::eB8G8R8Uscaled: 
-	case vk::Format::eB8G8R8Sscaled: 
-	case vk::Format::eB8G8R8Uint:
-	case vk::Format::eB8G8R8Sint: 
-	case vk::Format::eB8G8R8Srgb:
-		return 3;
-	case vk::Format::eR8G8B8A8Unorm:
-	case vk::Format::eR8G8B8A8Snorm:
-	case vk::Format::eR8G8B8A8Uscaled: 
-	case vk::Format::eR8G8B8A8Sscaled: 
-	case vk::Format::eR8G8B8A8Uint: 
-	case vk::Format::eR8G8B8A8Sint: 
-	case vk::Format::eR8G8B8A8Srgb: 
-	case vk::Format::eB8G8R8A8Unorm: 
-	case vk::Format::eB8G8R8A8Snorm: 
-	case vk::Format::eB8G8R8A8Uscaled: 
-	case vk::Format::eB8G8R8A8Sscaled: 
-	case vk::Format::eB8G8R8A8Uint: 
-	case vk::Format::eB8G8R8A8Sint: 
-	case vk::Format::eB8G8R8A8Srgb:
-		return 4;
-	case vk::Format::eR16Unorm:
-	case vk::Format::eR16Snorm: 
-	case vk::Format::eR16Uscaled: 
-	case vk::Format::eR16Sscaled: 
-	case vk::Format::eR16Uint:
-	case vk::Format::eR16Sint: 
-	case vk::Format::eR16Sfloat:
-		return 2;
-	case vk::Format::eR16G16Unorm: 
-	case vk::Format::eR16G16Snorm:
-	case vk::Format::eR16G16Uscaled:
-	case vk::Format::eR16G16Sscaled: 
-	case vk::Format::eR16G16Uint:
-	case vk::Format::eR16G16Sint: 
-	case vk::Format::eR16G16Sfloat:
-		return 4;
-	case vk::Format::eR16G16B16Unorm:
-	case vk::Format::eR16G16B16Snorm: 
-	case vk::Format::eR16G16B16Uscaled: 
-	case vk::Format::eR16G16B16Sscaled:
-	case vk::Format::eR16G16B16Uint:
-	case vk::Format::eR16G16B16Sint: 
-	case vk::Format::eR16G16B16Sfloat:
-		return 6;
-	case vk::Format::eR16G16B16A16Unorm: 
-	case vk::Format::eR16G16B16A16Snorm: 
-	case vk::Format::eR16G16B16A16Uscaled: 
-	case vk::Format::eR16G16B16A16Sscaled:
-	case vk::Format::eR16G16B16A16Uint:
-	case vk::Format::eR16G16B16A16Sint: 
-	case vk::Format::eR16G16B16A16Sfloat:
-		return 8;
-	case vk::Format::eR32Uint:
-	case vk::Format::eR32Sint:
-	case vk::Format::eR32Sfloat:
-		return 4;
-	case vk::Format::eR32G32Uint:
-	case vk::Format::eR32G32Sint: 
-	case vk::Format::eR32G32Sfloat: 
-		return 8;
-	case vk::Format::eR32G32B32Uint: 
-	case vk::Format::eR32G32B32Sint:
-	case vk::Format::eR32G32B32Sfloat:
-		return 12;
-	case vk::Format::eR32G32B32A32Uint:
-	case vk::Format::eR32G32B32A32Sint: 
-	case vk::Format::eR32G32B32A32Sfloat:
-		return 16;
-	case vk::Format::eR64Uint:
-	case vk::Format::eR64Sint:
-	case vk::Format::eR64Sfloat:
-		return 8;
-	case vk::Format::eR64G64Uint:
-	case vk::Format::eR64G64Sint:
-	case vk::Format::eR64G64Sfloat:
-		return 16;
-	case vk::Format::eR64G64B64Uint:
-	case vk::Format::eR64G64B64Sint:
-	case vk::Format::eR64G64B64Sfloat:
-		return 24;
-	case vk::Format::eR64G64B64A64Uint:
-	case vk::Format::eR64G64B64A64Sint:
-	case vk::Format::eR64G64B64A64Sfloat:
-		return 32;
-	default:
-		throw std::runtime_error("unsuported size format");
+		mipChain = generateMipChain(info.data, info.width, info.height, info.format, info.mipLevels);
+		data = mipChain;
 	}
-}
 
-// @Improve: All textures are created with a staging buffer for now since most textures do not need to be modified by the CPU after creation
-void Texture::create(DeviceContext& ctx, CreateInfo const& info)
-{
-	vk::DeviceSize const imageSize = info.width * info.height * vkFormatToSize(info.format);
+	if (ctx.uploadManager)
+	{
+		createImage(ctx, info);
+		ctx.uploadManager->uploadImage(image, data);
+		createView(ctx, info);
+		return;
+	}
 
 	vk::BufferCreateInfo stagingBufferInfo;
 	stagingBufferInfo.usage = vk::BufferUsageFlagBits::eTransferSrc;
-	stagingBufferInfo.size = imageSize;
+	stagingBufferInfo.size = data.size_bytes();
 	stagingBufferInfo.sharingMode = vk::SharingMode::eExclusive;
-	
+
 	vma::AllocationCreateInfo stagingBufferAllocInfo;
 	stagingBufferAllocInfo.usage = vma::MemoryUsage::eCpuToGpu;
-	
+
 	vkh::Buffer stagingBuffer;
 	stagingBuffer.create(ctx, stagingBufferInfo, stagingBufferAllocInfo);
-	stagingBuffer.writeData(info.data);
-	
+	stagingBuffer.writeData(data);
+	create(ctx, info, std::move(stagingBuffer));
+}
+
+void Texture::create(DeviceContext& ctx, CreateInfo const& info, vkh::Buffer&& staging)
+{
+	createImage(ctx, info);
+
+	if (ctx.uploadManager)
+	{
+		ctx.uploadManager->uploadImage(image, std::move(staging));
+	}
+	else
+	{
+		staging.flush();
+		image.transitionLayout(vk::ImageLayout::eTransferDstOptimal);
+		staging.copyToImage(image);
+		image.transitionLayout(vk::ImageLayout::eShaderReadOnlyOptimal);
+		staging.destroy();
+	}
+
+	createView(ctx, info);
+}
+
+void Texture::create(DeviceContext& ctx, Texture& source, uint32 firstLevel)
+{
+	vk::ImageCreateInfo const& sourceInfo = source.image.imageInfo;
+	if (!ctx.uploadManager)
+		throw std::runtime_error("copying texture levels requires an upload manager");
+	assert(firstLevel < sourceInfo.mipLevels);
+
+	vk::Extent3D const extent = vkh::getMipExtent(sourceInfo.extent, firstLevel);
+	CreateInfo info{};
+	info.width = extent.width;
+	info.height = extent.height;
+	info.format = sourceInfo.format;
+	info.tiling = sourceInfo.tiling;
+	info.mipLevels = sourceInfo.mipLevels - firstLevel;
+
+	createImage(ctx, info);
+	ctx.uploadManager->copyImageLevels(image, source.image, firstLevel);
+	createView(ctx, info);
+}
+
+void Texture::createImage(DeviceContext& ctx, CreateInfo const& info)
+{
 	vk::ImageCreateInfo imageInfo;
 	imageInfo.imageType = vk::ImageType::e2D;
 	imageInfo.usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eTransferSrc | vk::ImageUsageFlagBits::eSampled;
@@ -152,14 +105,14 @@ void Texture::create(DeviceContext& ctx, CreateInfo const& info)
 	imageAllocInfo.usage = vma::MemoryUsage::eGpuOnly;
 	
 	image.create(ctx, imageInfo, imageAllocInfo);
-	image.transitionLayout(vk::ImageLayout::eTransferDstOptimal);
+}
 
-	stagingBuffer.copyToImage(image);
-	
+void Texture::createView(DeviceContext& ctx, CreateInfo const& info)
+{
 	vk::ImageViewCreateInfo viewInfo;
 	viewInfo.image = image.handle;
 	viewInfo.viewType = vk::ImageViewType::e2D;
-	viewInfo.format = imageInfo.format;
+	viewInfo.format = info.format;
 	
 	// @Review
 	viewInfo.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
@@ -200,3 +153,17 @@ Texture::~Texture()
 {
 	destroy();
 }
+
+Texture::Texture(Texture&& rhs) noexcept :
+	image(std::move(rhs.image)), imageView(std::move(rhs.imageView)), sampler(std::move(rhs.sampler))
+{
+}
+
+Texture& Texture::operator=(Texture&& rhs) noexcept
+{
+	destroy();
+	image = std::move(rhs.image);
+	imageView = std::move(rhs.imageView);
+	sampler = std::move(rhs.sampler);
+	return *this;
+}
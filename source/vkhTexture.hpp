@@ -3,6 +3,7 @@
 #include <vulkan/vulkan.hpp>
 #include <span>
 #include <vkhImage.hpp>
+#include <vkhBuffer.hpp>
 
 namespace vkh
 {
@@ -15,19 +16,34 @@ namespace vkh
 			uint32 width, height;
 			vk::Format format;
 			vk::ImageTiling tiling;
+			// see vkh::getMipLevelCount for a full chain
 			uint32 mipLevels;
+			// tightly packed mip levels from the first one, when it is the only one the others are generated from it
+			// block compressed data cannot be filtered and must hold every level
 			std::span<uint8> data;
 		};
 		
 		Texture() = default;
 		
+		// the image ends in eShaderReadOnlyOptimal
 		void create(DeviceContext& ctx, CreateInfo const&);
+		// create from data already in a mapped staging buffer (see UploadManager::allocateStaging), info.data is ignored
+		// staging is consumed without any copy, it must hold every level that the upload manager cannot blit
+		void create(DeviceContext& ctx, CreateInfo const&, vkh::Buffer&& staging);
+		// create from the levels of source from firstLevel, copied on the GPU by the upload manager which ctx must have
+		// source must stay alive until the copy completes, e.g. in the deletion queue
+		void create(DeviceContext& ctx, Texture& source, uint32 firstLevel);
 		void destroy();
 		~Texture();
 
 		Texture(Texture&& rhs) noexcept;
 		Texture& operator=(Texture&& rhs) noexcept;
 		
+	private:
+		void createImage(DeviceContext& ctx, CreateInfo const&);
+		void createView(DeviceContext& ctx, CreateInfo const&);
+
+	public:
 		vkh::Image image;
 		vk::UniqueImageView imageView;
 		vk::UniqueSampler sampler;
@@ -0,0 +1,672 @@
+#include "vkhUploadManager.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+#include "vkhDeviceContext.hpp"
+#include "vkhImage.hpp"
+#include "vkhUtility.hpp"
+
+using namespace vkh;
+
+// stages and accesses of the graphics queue that can read uploaded data
+static vk::PipelineStageFlags constexpr readStages = vk::PipelineStageFlagBits::eVertexInput | vk::PipelineStageFlagBits::eVertexShader | vk::PipelineStageFlagBits::eFragmentShader;
+// the acquiring side also blits the mip levels that were not uploaded
+static vk::PipelineStageFlags constexpr acquireStages = readStages | vk::PipelineStageFlagBits::eTransfer;
+static vk::AccessFlags constexpr bufferReadAccess = vk::AccessFlagBits::eVertexAttributeRead | vk::AccessFlagBits::eIndexRead | vk::AccessFlagBits::eUniformRead | vk::AccessFlagBits::eShaderRead;
+static vk::DeviceSize constexpr stagingAlignment = 16;
+
+static vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment)
+{
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+UploadManager::~UploadManager()
+{
+	destroy();
+}
+
+void UploadManager::create(vkh::DeviceContext& ctx, CreateInfo const& info)
+{
+	deviceContext = &ctx;
+	ownershipTransfer = ctx.transferFamilyIndex != ctx.graphicsFamilyIndex;
+
+	vk::CommandPoolCreateInfo poolCreateInfo{};
+	poolCreateInfo.flags = vk::CommandPoolCreateFlagBits::eResetCommandBuffer | vk::CommandPoolCreateFlagBits::eTransient;
+	poolCreateInfo.queueFamilyIndex = ctx.transferFamilyIndex;
+	transferPool = ctx.device.createCommandPoolUnique(poolCreateInfo, ctx.allocationCallbacks);
+	poolCreateInfo.queueFamilyIndex = ctx.graphicsFamilyIndex;
+	acquirePool = ctx.device.createCommandPoolUnique(poolCreateInfo, ctx.allocationCallbacks);
+
+	vk::BufferCreateInfo stagingInfo;
+	stagingInfo.usage = vk::BufferUsageFlagBits::eTransferSrc;
+	stagingInfo.size = info.stagingSize;
+	stagingInfo.sharingMode = vk::SharingMode::eExclusive;
+
+	vma::AllocationCreateInfo stagingAllocInfo;
+	stagingAllocInfo.usage = vma::MemoryUsage::eCpuOnly;
+	stagingAllocInfo.flags = vma::AllocationCreateFlagBits::eMapped;
+	staging.create(ctx, stagingInfo, stagingAllocInfo);
+	stagingHead = 0;
+
+	// a single block mapped once, allocated on first use, buffers of allocateStaging only take a range of it
+	// the default algorithm since buffers are released when their batch completes, not in allocation order
+	vma::PoolCreateInfo decodePoolInfo;
+	decodePoolInfo.memoryTypeIndex = ctx.gpuAllocator.findMemoryTypeIndexForBufferInfo(stagingInfo, stagingAllocInfo);
+	decodePoolInfo.blockSize = info.decodeStagingSize;
+	decodePoolInfo.maxBlockCount = 1;
+	decodePool = ctx.gpuAllocator.createPool(decodePoolInfo);
+	decodeStagingSize = info.decodeStagingSize;
+}
+
+void UploadManager::destroy()
+{
+	if (!deviceContext)
+		return;
+
+	wait(flush());
+
+	freeBatches.clear();
+	current = {};
+	staging.destroy();
+	// every buffer of allocateStaging must be destroyed by now
+	deviceContext->gpuAllocator.destroyPool(decodePool);
+	decodePool = nullptr;
+	acquirePool.reset();
+	transferPool.reset();
+	deviceContext = nullptr;
+}
+
+UploadManager::Ticket UploadManager::uploadBuffer(vkh::Buffer& dst, std::span<uint8 const> data, vk::DeviceSize dstOffset)
+{
+	assert(dstOffset + data.size_bytes() <= dst.size);
+	// nothing to wait for, the current ticket might never be submitted
+	if (data.empty())
+		return completedTicket;
+
+	StagingSlice const slice = stage(data, stagingAlignment);
+	Batch& batch = getRecordingBatch();
+
+	vk::BufferCopy const region{ slice.offset, dstOffset, data.size_bytes() };
+	batch.transferCmd.copyBuffer(slice.buffer, dst.buffer, 1, &region);
+
+	vk::BufferMemoryBarrier barrier;
+	barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+	barrier.dstAccessMask = bufferReadAccess;
+	barrier.buffer = dst.buffer;
+	barrier.offset = dstOffset;
+	barrier.size = data.size_bytes();
+	addOwnershipTransfer(barrier);
+
+	deviceContext->stagedBytes += data.size_bytes();
+	return batch.ticket;
+}
+
+UploadManager::Ticket UploadManager::uploadImage(vkh::Image& dst, std::span<uint8 const> data, vk::ImageLayout finalLayout)
+{
+	vk::DeviceSize uploadedSize = 0;
+	uint32 const uploadedLevels = countUploadedLevels(dst, data.size_bytes(), uploadedSize);
+
+	// buffer offsets of image copies must be a multiple of the texel block size
+	vk::DeviceSize const blockSize = vkh::getFormatBlock(dst.imageInfo.format).size;
+	StagingSlice const slice = stage(data.first(uploadedSize), std::lcm(stagingAlignment, blockSize));
+	return recordImageUpload(dst, slice, uploadedLevels, finalLayout);
+}
+
+UploadManager::Ticket UploadManager::uploadImage(vkh::Image& dst, vkh::Buffer&& stagingBuffer, vk::ImageLayout finalLayout)
+{
+	vk::DeviceSize uploadedSize = 0;
+	uint32 const uploadedLevels = countUploadedLevels(dst, stagingBuffer.size, uploadedSize);
+
+	stagingBuffer.flush(0, uploadedSize);
+	StagingSlice const slice{ stagingBuffer.buffer, 0 };
+	getRecordingBatch().dedicatedStaging.push_back(std::move(stagingBuffer));
+	return recordImageUpload(dst, slice, uploadedLevels, finalLayout);
+}
+
+vkh::Buffer UploadManager::allocateStaging(vk::DeviceSize size)
+{
+	vk::BufferCreateInfo stagingInfo;
+	stagingInfo.usage = vk::BufferUsageFlagBits::eTransferSrc;
+	stagingInfo.size = size;
+	stagingInfo.sharingMode = vk::SharingMode::eExclusive;
+
+	vma::AllocationCreateInfo allocInfo;
+	allocInfo.usage = vma::MemoryUsage::eCpuOnly;
+	allocInfo.flags = vma::AllocationCreateFlagBits::eMapped;
+	allocInfo.pool = decodePool;
+
+	// the pool is full until the batches using it complete
+	vkh::Buffer buffer;
+	if (size <= decodeStagingSize && buffer.tryCreate(*deviceContext, stagingInfo, allocInfo) == vk::Result::eSuccess)
+		return buffer;
+
+	allocInfo.pool = nullptr;
+	buffer.create(*deviceContext, stagingInfo, allocInfo);
+	return buffer;
+}
+
+uint32 UploadManager::countUploadedLevels(vkh::Image const& dst, vk::DeviceSize dataSize, vk::DeviceSize& uploadedSize) const
+{
+	vk::ImageCreateInfo const& imageInfo = dst.imageInfo;
+
+	// levels held by data, the last one is the source of the generated ones
+	uint32 uploadedLevels = 0;
+	uploadedSize = 0;
+	while (uploadedLevels < imageInfo.mipLevels)
+	{
+		vk::DeviceSize const levelSize = vkh::getMipLevelSize(imageInfo.format, imageInfo.extent, uploadedLevels) * imageInfo.arrayLayers;
+		if (uploadedSize + levelSize > dataSize)
+			break;
+		uploadedSize += levelSize;
+		uploadedLevels++;
+	}
+	assert(uploadedLevels > 0);
+
+	if (uploadedLevels < imageInfo.mipLevels && !vkh::supportsLinearBlit(deviceContext->physicalDevice, imageInfo.format))
+		throw std::runtime_error("image format cannot be blitted, every mip level must be uploaded");
+	return uploadedLevels;
+}
+
+UploadManager::Ticket UploadManager::recordImageUpload(vkh::Image& dst, StagingSlice slice, uint32 uploadedLevels, vk::ImageLayout finalLayout)
+{
+	vk::ImageCreateInfo const& imageInfo = dst.imageInfo;
+	bool const generateMips = uploadedLevels < imageInfo.mipLevels;
+	Batch& batch = getRecordingBatch();
+
+	vk::ImageSubresourceRange subresourceRange;
+	subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+	subresourceRange.baseMipLevel = 0;
+	subresourceRange.levelCount = imageInfo.mipLevels;
+	subresourceRange.baseArrayLayer = 0;
+	subresourceRange.layerCount = imageInfo.arrayLayers;
+
+	vk::ImageMemoryBarrier toTransfer;
+	toTransfer.srcAccessMask = vk::AccessFlags();
+	toTransfer.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+	toTransfer.oldLayout = vk::ImageLayout::eUndefined;
+	toTransfer.newLayout = vk::ImageLayout::eTransferDstOptimal;
+	toTransfer.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	toTransfer.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	toTransfer.image = dst.handle;
+	toTransfer.subresourceRange = subresourceRange;
+	batch.transferCmd.pipelineBarrier(vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags(), 0, nullptr, 0, nullptr, 1, &toTransfer);
+
+	std::vector<vk::BufferImageCopy> regions(uploadedLevels);
+	vk::DeviceSize bufferOffset = slice.offset;
+	for (uint32 level = 0; level < uploadedLevels; level++)
+	{
+		vk::BufferImageCopy& region = regions[level];
+		region.bufferOffset = bufferOffset;
+		region.imageSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+		region.imageSubresource.mipLevel = level;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = imageInfo.arrayLayers;
+		region.imageExtent = vkh::getMipExtent(imageInfo.extent, level);
+		bufferOffset += vkh::getMipLevelSize(imageInfo.format, imageInfo.extent, level) * imageInfo.arrayLayers;
+	}
+	batch.transferCmd.copyBufferToImage(slice.buffer, dst.handle, vk::ImageLayout::eTransferDstOptimal, static_cast<uint32>(regions.size()), regions.data());
+	vk::DeviceSize const uploadedSize = bufferOffset - slice.offset;
+
+	vk::ImageMemoryBarrier barrier;
+	barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+	barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+	barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+	barrier.newLayout = finalLayout;
+	barrier.image = dst.handle;
+	barrier.subresourceRange = subresourceRange;
+
+	if (generateMips)
+	{
+		uint32 const sourceLevel = uploadedLevels - 1;
+
+		// complete levels
+		if (sourceLevel > 0)
+		{
+			barrier.subresourceRange.levelCount = sourceLevel;
+			addOwnershipTransfer(barrier);
+		}
+
+		// source of the first blit
+		barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
+		barrier.newLayout = vk::ImageLayout::eTransferSrcOptimal;
+		barrier.subresourceRange.baseMipLevel = sourceLevel;
+		barrier.subresourceRange.levelCount = 1;
+		addOwnershipTransfer(barrier);
+
+		// blit destinations, their content is undefined but they stay in eTransferDstOptimal
+		barrier.srcAccessMask = vk::AccessFlags();
+		barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+		barrier.newLayout = vk::ImageLayout::eTransferDstOptimal;
+		barrier.subresourceRange.baseMipLevel = uploadedLevels;
+		barrier.subresourceRange.levelCount = imageInfo.mipLevels - uploadedLevels;
+		addOwnershipTransfer(barrier);
+
+		batch.mipGenerations.push_back({ dst.handle, imageInfo.extent, sourceLevel, imageInfo.mipLevels, imageInfo.arrayLayers, finalLayout });
+	}
+	else
+	{
+		addOwnershipTransfer(barrier);
+	}
+
+	// layout once the batch is complete, later graphics submissions are ordered after the acquire
+	dst.imageInfo.initialLayout = finalLayout;
+
+	deviceContext->stagedBytes += uploadedSize;
+	return batch.ticket;
+}
+
+UploadManager::Ticket UploadManager::copyImageLevels(vkh::Image& dst, vkh::Image& src, uint32 srcBaseLevel, vk::ImageLayout finalLayout)
+{
+	vk::ImageCreateInfo const& imageInfo = dst.imageInfo;
+	assert(imageInfo.format == src.imageInfo.format && srcBaseLevel + imageInfo.mipLevels <= src.imageInfo.mipLevels);
+	Batch& batch = getRecordingBatch();
+
+	// src is in the layout of its last upload, or still being uploaded by an earlier batch which the graphics queue runs first
+	batch.levelCopies.push_back({ src.handle, src.imageInfo.initialLayout, srcBaseLevel, dst.handle, imageInfo.extent, imageInfo.mipLevels, imageInfo.arrayLayers, finalLayout });
+	dst.imageInfo.initialLayout = finalLayout;
+	return batch.ticket;
+}
+
+UploadManager::Ticket UploadManager::getCurrentTicket() const noexcept
+{
+	return recording ? current.ticket : nextTicket;
+}
+
+UploadManager::Ticket UploadManager::flush()
+{
+	if (!recording)
+		return nextTicket - 1;
+
+	Batch& batch = current;
+	vk::PipelineStageFlags const releaseStage = ownershipTransfer ? vk::PipelineStageFlagBits::eBottomOfPipe : acquireStages;
+	batch.transferCmd.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, releaseStage, vk::DependencyFlags(),
+		0, nullptr,
+		static_cast<uint32>(batch.transferBufferBarriers.size()), batch.transferBufferBarriers.data(),
+		static_cast<uint32>(batch.transferImageBarriers.size()), batch.transferImageBarriers.data());
+	// same family, the whole batch runs on the graphics queue
+	if (!ownershipTransfer)
+	{
+		recordMipGenerations(batch.transferCmd, batch.mipGenerations);
+		recordLevelCopies(batch.transferCmd, batch.levelCopies);
+	}
+	batch.transferCmd.end();
+
+	if (ownershipTransfer)
+	{
+		vk::CommandBufferBeginInfo beginInfo;
+		beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+		batch.acquireCmd.begin(beginInfo);
+		batch.acquireCmd.pipelineBarrier(acquireStages, acquireStages, vk::DependencyFlags(),
+			0, nullptr,
+			static_cast<uint32>(batch.acquireBufferBarriers.size()), batch.acquireBufferBarriers.data(),
+			static_cast<uint32>(batch.acquireImageBarriers.size()), batch.acquireImageBarriers.data());
+		recordMipGenerations(batch.acquireCmd, batch.mipGenerations);
+		recordLevelCopies(batch.acquireCmd, batch.levelCopies);
+		batch.acquireCmd.end();
+
+		vkh::QueueTimeline& transferTimeline = deviceContext->transferTimeline;
+		SemaphoreWait const transferDone{ *transferTimeline.semaphore, transferTimeline.submit({ &batch.transferCmd, 1 }), acquireStages };
+		batch.completionValue = deviceContext->graphicsTimeline.submit({ &batch.acquireCmd, 1 }, { &transferDone, 1 });
+	}
+	else
+	{
+		// submitted to the graphics queue itself, the transfer queue of the same family may be another queue
+		// and its submissions would not be ordered with the frames reading the uploads
+		batch.completionValue = deviceContext->graphicsTimeline.submit({ &batch.transferCmd, 1 });
+	}
+
+	Ticket const ticket = batch.ticket;
+	inFlight.push_back(std::move(current));
+	current = {};
+	recording = false;
+	return ticket;
+}
+
+void UploadManager::update()
+{
+	uint64 const completed = getCompletionTimeline().getCompleted();
+	while (!inFlight.empty() && inFlight.front().completionValue <= completed)
+	{
+		completedTicket = inFlight.front().ticket;
+		retire(inFlight.front());
+		freeBatches.push_back(std::move(inFlight.front()));
+		inFlight.pop_front();
+	}
+}
+
+bool UploadManager::isComplete(Ticket ticket)
+{
+	update();
+	return ticket <= completedTicket;
+}
+
+void UploadManager::wait(Ticket ticket)
+{
+	if (recording && ticket >= current.ticket)
+		flush();
+
+	// batches complete in order, waiting for the last one up to ticket is enough
+	uint64 completionValue = 0;
+	for (auto const& batch : inFlight)
+	{
+		if (batch.ticket > ticket)
+			break;
+		completionValue = batch.completionValue;
+	}
+	if (completionValue > 0)
+		getCompletionTimeline().wait(completionValue);
+	update();
+}
+
+UploadManager::Batch& UploadManager::getRecordingBatch()
+{
+	if (recording)
+		return current;
+
+	if (!freeBatches.empty())
+	{
+		current = std::move(freeBatches.back());
+		freeBatches.pop_back();
+	}
+	else
+	{
+		vk::Device const device = deviceContext->device;
+
+		vk::CommandBufferAllocateInfo allocInfo;
+		allocInfo.commandPool = *transferPool;
+		allocInfo.commandBufferCount = 1;
+		allocInfo.level = vk::CommandBufferLevel::ePrimary;
+		current.transferCmd = device.allocateCommandBuffers(allocInfo)[0];
+		if (ownershipTransfer)
+		{
+			allocInfo.commandPool = *acquirePool;
+			current.acquireCmd = device.allocateCommandBuffers(allocInfo)[0];
+		}
+	}
+
+	current.ticket = nextTicket++;
+	recording = true;
+
+	vk::CommandBufferBeginInfo beginInfo;
+	beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+	current.transferCmd.begin(beginInfo);
+	return current;
+}
+
+UploadManager::StagingSlice UploadManager::stage(std::span<uint8 const> data, vk::DeviceSize alignment)
+{
+	vk::DeviceSize const size = data.size_bytes();
+
+	std::optional<vk::DeviceSize> offset;
+	if (size + alignment <= staging.size)
+	{
+		update();
+		offset = tryAllocateStaging(size, alignment);
+		while (!offset)
+		{
+			// make room by submitting the current batch and waiting for the oldest one
+			if (recording)
+				flush();
+			wait(inFlight.front().ticket);
+			offset = tryAllocateStaging(size, alignment);
+		}
+	}
+
+	Batch& batch = getRecordingBatch();
+
+	if (!offset)
+	{
+		vk::BufferCreateInfo stagingInfo;
+		stagingInfo.usage = vk::BufferUsageFlagBits::eTransferSrc;
+		stagingInfo.size = size;
+		stagingInfo.sharingMode = vk::SharingMode::eExclusive;
+
+		vkh::Buffer& dedicated = batch.dedicatedStaging.emplace_back();
+		dedicated.create(*deviceContext, stagingInfo, BufferLocation::HostMapped);
+		dedicated.writeData(data);
+		return { dedicated.buffer, 0 };
+	}
+
+	if (!batch.stagingBegin)
+		batch.stagingBegin = *offset;
+	stagingHead = *offset + size;
+
+	memcpy(staging.getMapped(*offset), data.data(), size);
+	staging.flush(*offset, size);
+	return { staging.buffer, *offset };
+}
+
+std::optional<vk::DeviceSize> UploadManager::tryAllocateStaging(vk::DeviceSize size, vk::DeviceSize alignment)
+{
+	// oldest byte of the ring still in use
+	std::optional<vk::DeviceSize> tail;
+	for (auto const& batch : inFlight)
+	{
+		if (batch.stagingBegin)
+		{
+			tail = batch.stagingBegin;
+			break;
+		}
+	}
+	if (!tail && recording)
+		tail = current.stagingBegin;
+
+	if (!tail)
+		stagingHead = 0;
+
+	vk::DeviceSize const offset = alignUp(stagingHead, alignment);
+	// the head never catches up with the tail, head == tail always means empty
+	if (!tail || stagingHead > *tail)
+	{
+		if (offset + size <= staging.size)
+			return offset;
+		if (tail && size < *tail)
+			return 0;
+		return std::nullopt;
+	}
+
+	if (offset + size < *tail)
+		return offset;
+	return std::nullopt;
+}
+
+void UploadManager::addOwnershipTransfer(vk::BufferMemoryBarrier barrier)
+{
+	if (!ownershipTransfer)
+	{
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		current.transferBufferBarriers.push_back(barrier);
+		return;
+	}
+
+	barrier.srcQueueFamilyIndex = deviceContext->transferFamilyIndex;
+	barrier.dstQueueFamilyIndex = deviceContext->graphicsFamilyIndex;
+
+	vk::BufferMemoryBarrier release = barrier;
+	release.dstAccessMask = vk::AccessFlags();
+	current.transferBufferBarriers.push_back(release);
+
+	vk::BufferMemoryBarrier acquire = barrier;
+	acquire.srcAccessMask = vk::AccessFlags();
+	current.acquireBufferBarriers.push_back(acquire);
+}
+
+void UploadManager::addOwnershipTransfer(vk::ImageMemoryBarrier barrier)
+{
+	if (!ownershipTransfer)
+	{
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		current.transferImageBarriers.push_back(barrier);
+		return;
+	}
+
+	barrier.srcQueueFamilyIndex = deviceContext->transferFamilyIndex;
+	barrier.dstQueueFamilyIndex = deviceContext->graphicsFamilyIndex;
+
+	// both halves must describe the same layout transition
+	vk::ImageMemoryBarrier release = barrier;
+	release.dstAccessMask = vk::AccessFlags();
+	current.transferImageBarriers.push_back(release);
+
+	vk::ImageMemoryBarrier acquire = barrier;
+	acquire.srcAccessMask = vk::AccessFlags();
+	current.acquireImageBarriers.push_back(acquire);
+}
+
+void UploadManager::recordMipGenerations(vk::CommandBuffer cmdBuffer, std::span<MipGeneration const> generations)
+{
+	if (generations.empty())
+		return;
+
+	uint32 levelCount = 0;
+	for (auto const& generation : generations)
+		levelCount = std::max(levelCount, generation.levelCount);
+
+	// every image of the batch is blitted in lockstep, a single barrier per level
+	std::vector<vk::ImageMemoryBarrier> barriers;
+	barriers.reserve(generations.size());
+	for (uint32 level = 1; level < levelCount; level++)
+	{
+		barriers.clear();
+		for (auto const& generation : generations)
+		{
+			if (level <= generation.baseLevel || level >= generation.levelCount)
+				continue;
+
+			vk::Extent3D const srcExtent = vkh::getMipExtent(generation.extent, level - 1);
+			vk::Extent3D const dstExtent = vkh::getMipExtent(generation.extent, level);
+
+			vk::ImageBlit blit;
+			blit.srcSubresource = vk::ImageSubresourceLayers{ vk::ImageAspectFlagBits::eColor, level - 1, 0, generation.layerCount };
+			blit.srcOffsets[1] = vk::Offset3D{ static_cast<int32>(srcExtent.width), static_cast<int32>(srcExtent.height), static_cast<int32>(srcExtent.depth) };
+			blit.dstSubresource = vk::ImageSubresourceLayers{ vk::ImageAspectFlagBits::eColor, level, 0, generation.layerCount };
+			blit.dstOffsets[1] = vk::Offset3D{ static_cast<int32>(dstExtent.width), static_cast<int32>(dstExtent.height), static_cast<int32>(dstExtent.depth) };
+			cmdBuffer.blitImage(generation.image, vk::ImageLayout::eTransferSrcOptimal, generation.image, vk::ImageLayout::eTransferDstOptimal, 1, &blit, vk::Filter::eLinear);
+
+			// source of the next level
+			vk::ImageMemoryBarrier& barrier = barriers.emplace_back();
+			barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+			barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
+			barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+			barrier.newLayout = vk::ImageLayout::eTransferSrcOptimal;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = generation.image;
+			barrier.subresourceRange = vk::ImageSubresourceRange{ vk::ImageAspectFlagBits::eColor, level, 1, 0, generation.layerCount };
+		}
+		if (!barriers.empty())
+			cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags(), 0, nullptr, 0, nullptr, static_cast<uint32>(barriers.size()), barriers.data());
+	}
+
+	barriers.clear();
+	for (auto const& generation : generations)
+	{
+		vk::ImageMemoryBarrier& barrier = barriers.emplace_back();
+		barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+		barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+		barrier.oldLayout = vk::ImageLayout::eTransferSrcOptimal;
+		barrier.newLayout = generation.finalLayout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = generation.image;
+		barrier.subresourceRange = vk::ImageSubresourceRange{ vk::ImageAspectFlagBits::eColor, generation.baseLevel, generation.levelCount - generation.baseLevel, 0, generation.layerCount };
+	}
+	cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, readStages, vk::DependencyFlags(), 0, nullptr, 0, nullptr, static_cast<uint32>(barriers.size()), barriers.data());
+}
+
+void UploadManager::recordLevelCopies(vk::CommandBuffer cmdBuffer, std::span<LevelCopy const> copies)
+{
+	if (copies.empty())
+		return;
+
+	std::vector<vk::ImageMemoryBarrier> barriers;
+	barriers.reserve(copies.size() * 2);
+	for (auto const& copy : copies)
+	{
+		// sources may still be sampled by earlier frames or written by earlier uploads
+		vk::ImageMemoryBarrier& srcBarrier = barriers.emplace_back();
+		srcBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+		srcBarrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
+		srcBarrier.oldLayout = copy.srcLayout;
+		srcBarrier.newLayout = vk::ImageLayout::eTransferSrcOptimal;
+		srcBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		srcBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		srcBarrier.image = copy.src;
+		srcBarrier.subresourceRange = vk::ImageSubresourceRange{ vk::ImageAspectFlagBits::eColor, copy.srcBaseLevel, copy.levelCount, 0, copy.layerCount };
+
+		vk::ImageMemoryBarrier& dstBarrier = barriers.emplace_back();
+		dstBarrier.srcAccessMask = vk::AccessFlags();
+		dstBarrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+		dstBarrier.oldLayout = vk::ImageLayout::eUndefined;
+		dstBarrier.newLayout = vk::ImageLayout::eTransferDstOptimal;
+		dstBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		dstBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		dstBarrier.image = copy.dst;
+		dstBarrier.subresourceRange = vk::ImageSubresourceRange{ vk::ImageAspectFlagBits::eColor, 0, copy.levelCount, 0, copy.layerCount };
+	}
+	cmdBuffer.pipelineBarrier(acquireStages, vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags(), 0, nullptr, 0, nullptr, static_cast<uint32>(barriers.size()), barriers.data());
+
+	std::vector<vk::ImageCopy> regions;
+	for (auto const& copy : copies)
+	{
+		regions.clear();
+		for (uint32 level = 0; level < copy.levelCount; level++)
+		{
+			vk::ImageCopy& region = regions.emplace_back();
+			region.srcSubresource = vk::ImageSubresourceLayers{ vk::ImageAspectFlagBits::eColor, copy.srcBaseLevel + level, 0, copy.layerCount };
+			region.dstSubresource = vk::ImageSubresourceLayers{ vk::ImageAspectFlagBits::eColor, level, 0, copy.layerCount };
+			region.extent = vkh::getMipExtent(copy.dstExtent, level);
+		}
+		cmdBuffer.copyImage(copy.src, vk::ImageLayout::eTransferSrcOptimal, copy.dst, vk::ImageLayout::eTransferDstOptimal, static_cast<uint32>(regions.size()), regions.data());
+	}
+
+	barriers.clear();
+	for (auto const& copy : copies)
+	{
+		vk::ImageMemoryBarrier& srcBarrier = barriers.emplace_back();
+		srcBarrier.srcAccessMask = vk::AccessFlags();
+		srcBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+		srcBarrier.oldLayout = vk::ImageLayout::eTransferSrcOptimal;
+		srcBarrier.newLayout = copy.srcLayout;
+		srcBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		srcBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		srcBarrier.image = copy.src;
+		srcBarrier.subresourceRange = vk::ImageSubresourceRange{ vk::ImageAspectFlagBits::eColor, copy.srcBaseLevel, copy.levelCount, 0, copy.layerCount };
+
+		vk::ImageMemoryBarrier& dstBarrier = barriers.emplace_back();
+		dstBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+		dstBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+		dstBarrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+		dstBarrier.newLayout = copy.finalLayout;
+		dstBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		dstBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		dstBarrier.image = copy.dst;
+		dstBarrier.subresourceRange = vk::ImageSubresourceRange{ vk::ImageAspectFlagBits::eColor, 0, copy.levelCount, 0, copy.layerCount };
+	}
+	cmdBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer, readStages, vk::DependencyFlags(), 0, nullptr, 0, nullptr, static_cast<uint32>(barriers.size()), barriers.data());
+}
+
+vkh::QueueTimeline& UploadManager::getCompletionTimeline() const
+{
+	return deviceContext->graphicsTimeline;
+}
+
+void UploadManager::retire(Batch& batch)
+{
+	batch.transferCmd.reset();
+	if (batch.acquireCmd)
+		batch.acquireCmd.reset();
+
+	batch.stagingBegin.reset();
+	batch.dedicatedStaging.clear();
+	batch.transferBufferBarriers.clear();
+	batch.transferImageBarriers.clear();
+	batch.acquireBufferBarriers.clear();
+	batch.acquireImageBarriers.clear();
+	batch.mipGenerations.clear();
+	batch.levelCopies.clear();
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <deque>
+#include <optional>
+#include <span>
+#include <vector>
+#include <vulkan/vulkan.hpp>
+
+#include "ice.hpp"
+#include "vkhBuffer.hpp"
+
+namespace vkh
+{
+	struct DeviceContext;
+	struct Image;
+	class QueueTimeline;
+
+	// Batch buffer and image copies on the transfer queue
+	// Data is copied in a persistently mapped staging ring, copies are recorded in the current batch and submitted together by flush.
+	// Ownership of the destinations is released by the transfer queue and acquired by the graphics queue once the copies are done,
+	// so graphics work submitted after flush can use them without any CPU wait. Completion is tracked with the queue timelines.
+	// Not thread safe, meant to be used by the render thread, except allocateStaging.
+	class UploadManager
+	{
+	public:
+		// increasing id of a batch, complete once every copy of the batch is visible to the graphics queue
+		using Ticket = uint64;
+
+		struct CreateInfo
+		{
+			vk::DeviceSize stagingSize = 64 << 20;
+			// persistently mapped pool that worker threads decode into, see allocateStaging
+			// matches AssetStreamer::CreateInfo::decodedBudget so decoded textures waiting for their upload fit in it
+			vk::DeviceSize decodeStagingSize = 512 << 20;
+		};
+
+		UploadManager() = default;
+		ICE_NON_DISPATCHABLE_CLASS(UploadManager)
+		~UploadManager();
+
+		void create(vkh::DeviceContext& ctx, CreateInfo const& info = {});
+		// wait for every pending batch
+		void destroy();
+
+		// return the ticket of the batch the copy is recorded in
+		Ticket uploadBuffer(vkh::Buffer& dst, std::span<uint8 const> data, vk::DeviceSize dstOffset = 0);
+		// data holds tightly packed mip levels from the first one, the levels it does not hold are generated with linear blits
+		// on the graphics queue, previous content is discarded and the image ends in finalLayout
+		Ticket uploadImage(vkh::Image& dst, std::span<uint8 const> data, vk::ImageLayout finalLayout = vk::ImageLayout::eShaderReadOnlyOptimal);
+		// uploadImage from data already written in a buffer of allocateStaging, no copy is made
+		// the buffer is kept until the batch completes
+		Ticket uploadImage(vkh::Image& dst, vkh::Buffer&& stagingBuffer, vk::ImageLayout finalLayout = vk::ImageLayout::eShaderReadOnlyOptimal);
+
+		// copy the levels of src from srcBaseLevel to the levels of dst from the first one, e.g. to drop the finest levels of a texture
+		// on the graphics queue after the uploads of the batch, src must be complete once they are and stay alive until the batch is
+		Ticket copyImageLevels(vkh::Image& dst, vkh::Image& src, uint32 srcBaseLevel, vk::ImageLayout finalLayout = vk::ImageLayout::eShaderReadOnlyOptimal);
+
+		// mapped staging buffer to write upload data in place, can be called from any thread
+		// sub-allocated from the decode pool, a dedicated allocation is made when the pool is full
+		[[nodiscard]] vkh::Buffer allocateStaging(vk::DeviceSize size);
+
+		// ticket of the batch recording the next copies
+		[[nodiscard]] Ticket getCurrentTicket() const noexcept;
+		// submit the recorded copies, before the graphics submission using them, return the ticket of the submitted batch
+		Ticket flush();
+		// release the staging memory of completed batches
+		void update();
+
+		[[nodiscard]] bool isComplete(Ticket ticket);
+		// submit the batch of ticket if needed and wait for it
+		void wait(Ticket ticket);
+
+	private:
+		// levels (baseLevel, levelCount) blitted from baseLevel, every level from baseLevel is in eTransferSrcOptimal once done
+		struct MipGeneration
+		{
+			vk::Image image;
+			vk::Extent3D extent;
+			uint32 baseLevel;
+			uint32 levelCount;
+			uint32 layerCount;
+			vk::ImageLayout finalLayout;
+		};
+
+		// levels (srcBaseLevel, levelCount) of src copied to the levels (0, levelCount) of dst, src is back in srcLayout once done
+		struct LevelCopy
+		{
+			vk::Image src;
+			vk::ImageLayout srcLayout;
+			uint32 srcBaseLevel;
+			vk::Image dst;
+			vk::Extent3D dstExtent;
+			uint32 levelCount;
+			uint32 layerCount;
+			vk::ImageLayout finalLayout;
+		};
+
+		struct Batch
+		{
+			Ticket ticket = 0;
+			vk::CommandBuffer transferCmd;
+			// ownership acquire on the graphics queue, unused when both queues are of the same family
+			vk::CommandBuffer acquireCmd;
+			// value of the completion timeline signaled once the data is available to the graphics queue
+			uint64 completionValue = 0;
+
+			// first byte of the staging ring used by the batch, it is released when the batch completes
+			std::optional<vk::DeviceSize> stagingBegin;
+			// uploads larger than the ring
+			std::vector<vkh::Buffer> dedicatedStaging;
+
+			// recorded after the copies, releases when the queue families differ
+			std::vector<vk::BufferMemoryBarrier> transferBufferBarriers;
+			std::vector<vk::ImageMemoryBarrier> transferImageBarriers;
+			std::vector<vk::BufferMemoryBarrier> acquireBufferBarriers;
+			std::vector<vk::ImageMemoryBarrier> acquireImageBarriers;
+			// recorded on the graphics queue after the ownership transfers
+			std::vector<MipGeneration> mipGenerations;
+			// recorded on the graphics queue after the mip generations
+			std::vector<LevelCopy> levelCopies;
+		};
+
+		struct StagingSlice
+		{
+			vk::Buffer buffer;
+			vk::DeviceSize offset;
+		};
+
+		Batch& getRecordingBatch();
+		[[nodiscard]] StagingSlice stage(std::span<uint8 const> data, vk::DeviceSize alignment);
+		[[nodiscard]] std::optional<vk::DeviceSize> tryAllocateStaging(vk::DeviceSize size, vk::DeviceSize alignment);
+		// number of leading levels of dst held by dataSize bytes and their size
+		[[nodiscard]] uint32 countUploadedLevels(vkh::Image const& dst, vk::DeviceSize dataSize, vk::DeviceSize& uploadedSize) const;
+		// record the copy of uploadedLevels levels from slice, and the generation of the others
+		Ticket recordImageUpload(vkh::Image& dst, StagingSlice slice, uint32 uploadedLevels, vk::ImageLayout finalLayout);
+		// add the release and acquire barriers of a destination written by the current batch
+		void addOwnershipTransfer(vk::BufferMemoryBarrier barrier);
+		void addOwnershipTransfer(vk::ImageMemoryBarrier barrier);
+		// blit the missing levels of every image level by level, then move them to their final layout
+		static void recordMipGenerations(vk::CommandBuffer cmdBuffer, std::span<MipGeneration const> generations);
+		static void recordLevelCopies(vk::CommandBuffer cmdBuffer, std::span<LevelCopy const> copies);
+		// every batch completes on the graphics queue, with the ownership acquire or the whole batch
+		[[nodiscard]] vkh::QueueTimeline& getCompletionTimeline() const;
+		void retire(Batch& batch);
+
+		vkh::DeviceContext* deviceContext = nullptr;
+		bool ownershipTransfer = false;
+
+		vk::UniqueCommandPool transferPool;
+		vk::UniqueCommandPool acquirePool;
+
+		vkh::Buffer staging;
+		vk::DeviceSize stagingHead = 0;
+
+		// pool of a single block, see allocateStaging
+		vma::Pool decodePool;
+		vk::DeviceSize decodeStagingSize = 0;
+
+		Batch current;
+		bool recording = false;
+		// submitted batches, in submission order
+		std::deque<Batch> inFlight;
+		std::vector<Batch> freeBatches;
+		Ticket nextTicket = 1;
+		Ticket completedTicket = 0;
+	};
+}
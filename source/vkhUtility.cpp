@@ -1,5 +1,8 @@
 #include "vkhUtility.hpp"
 
+#include <algorithm>
+#include <bit>
+
 vk::Format vkh::findSupportedFormat(vk::PhysicalDevice physicalDevice, const std::vector<vk::Format>& candidates, const vk::ImageTiling tiling, const vk::FormatFeatureFlags features)
 {
 	for (auto format : candidates)
@@ -50,3 +53,183 @@ vk::SampleCountFlagBits vkh::getMaxUsableSampleCount(vk::PhysicalDevice physical
 	return vk::SampleCountFlagBits::e1;
 }
 
+vk::DeviceSize vkh::getFormatSize(vk::Format fmt)
+{
+	switch (fmt)
+	{
+	case vk::Format::eR8Unorm:
+	case vk::Format::eR8Uint:
+	case vk::Format::eR8Sint: 
+	case vk::Format::eR8Srgb:
+		return 1;
+	case vk::Format::eR8G8Unorm: 
+	case vk::Format::eR8G8Snorm:
+	case vk::Format::eR8G8Uscaled:
+	case vk::Format::eR8G8Sscaled: 
+	case vk::Format::eR8G8Uint: 
+	case vk::Format::eR8G8Sint: 
+	case vk::Format::eR8G8Srgb:
+		return 2;
+	case vk::Format::eR8G8B8Unorm: 
+	case vk::Format::eR8G8B8Snorm:
+	case vk::Format::eR8G8B8Uscaled: 
+	case vk::Format::eR8G8B8Sscaled: 
+	case vk::Format::eR8G8B8Uint: 
+	case vk::Format::eR8G8B8Sint:
+	case vk::Format::eR8G8B8Srgb: 
+	case vk::Format::eB8G8R8Unorm: 
+	case vk::Format::eB8G8R8Snorm: 
+	case vk::Format::eB8G8R8Uscaled: 
+	case vk::Format::eB8G8R8Sscaled: 
+	case vk::Format::eB8G8R8Uint:
+	case vk::Format::eB8G8R8Sint: 
+	case vk::Format::eB8G8R8Srgb:
+		return 3;
+	case vk::Format::eR8G8B8A8Unorm:
+	case vk::Format::eR8G8B8A8Snorm:
+	case vk::Format::eR8G8B8A8Uscaled: 
+	case vk::Format::eR8G8B8A8Sscaled: 
+	case vk::Format::eR8G8B8A8Uint: 
+	case vk::Format::eR8G8B8A8Sint: 
+	case vk::Format::eR8G8B8A8Srgb: 
+	case vk::Format::eB8G8R8A8Unorm: 
+	case vk::Format::eB8G8R8A8Snorm: 
+	case vk::Format::eB8G8R8A8Uscaled: 
+	case vk::Format::eB8G8R8A8Sscaled: 
+	case vk::Format::eB8G8R8A8Uint: 
+	case vk::Format::eB8G8R8A8Sint: 
+	case vk::Format::eB8G8R8A8Srgb:
+		return 4;
+	case vk::Format::eR16Unorm:
+	case vk::Format::eR16Snorm: 
+	case vk::Format::eR16Uscaled: 
+	case vk::Format::eR16Sscaled: 
+	case vk::Format::eR16Uint:
+	case vk::Format::eR16Sint: 
+	case vk::Format::eR16Sfloat:
+		return 2;
+	case vk::Format::eR16G16Unorm: 
+	case vk::Format::eR16G16Snorm:
+	case vk::Format::eR16G16Uscaled:
+	case vk::Format::eR16G16Sscaled: 
+	case vk::Format::eR16G16Uint:
+	case vk::Format::eR16G16Sint: 
+	case vk::Format::eR16G16Sfloat:
+		return 4;
+	case vk::Format::eR16G16B16Unorm:
+	case vk::Format::eR16G16B16Snorm: 
+	case vk::Format::eR16G16B16Uscaled: 
+	case vk::Format::eR16G16B16Sscaled:
+	case vk::Format::eR16G16B16Uint:
+	case vk::Format::eR16G16B16Sint: 
+	case vk::Format::eR16G16B16Sfloat:
+		return 6;
+	case vk::Format::eR16G16B16A16Unorm: 
+	case vk::Format::eR16G16B16A16Snorm: 
+	case vk::Format::eR16G16B16A16Uscaled: 
+	case vk::Format::eR16G16B16A16Sscaled:
+	case vk::Format::eR16G16B16A16Uint:
+	case vk::Format::eR16G16B16A16Sint: 
+	case vk::Format::eR16G16B16A16Sfloat:
+		return 8;
+	case vk::Format::eR32Uint:
+	case vk::Format::eR32Sint:
+	case vk::Format::eR32Sfloat:
+		return 4;
+	case vk::Format::eR32G32Uint:
+	case vk::Format::eR32G32Sint: 
+	case vk::Format::eR32G32Sfloat: 
+		return 8;
+	case vk::Format::eR32G32B32Uint: 
+	case vk::Format::eR32G32B32Sint:
+	case vk::Format::eR32G32B32Sfloat:
+		return 12;
+	case vk::Format::eR32G32B32A32Uint:
+	case vk::Format::eR32G32B32A32Sint: 
+	case vk::Format::eR32G32B32A32Sfloat:
+		return 16;
+	case vk::Format::eR64Uint:
+	case vk::Format::eR64Sint:
+	case vk::Format::eR64Sfloat:
+		return 8;
+	case vk::Format::eR64G64Uint:
+	case vk::Format::eR64G64Sint:
+	case vk::Format::eR64G64Sfloat:
+		return 16;
+	case vk::Format::eR64G64B64Uint:
+	case vk::Format::eR64G64B64Sint:
+	case vk::Format::eR64G64B64Sfloat:
+		return 24;
+	case vk::Format::eR64G64B64A64Uint:
+	case vk::Format::eR64G64B64A64Sint:
+	case vk::Format::eR64G64B64A64Sfloat:
+		return 32;
+	default:
+		throw std::runtime_error("unsuported size format");
+	}
+}
+
+vkh::FormatBlock vkh::getFormatBlock(vk::Format format)
+{
+	switch (format)
+	{
+	case vk::Format::eBc1RgbUnormBlock:
+	case vk::Format::eBc1RgbSrgbBlock:
+	case vk::Format::eBc1RgbaUnormBlock:
+	case vk::Format::eBc1RgbaSrgbBlock:
+	case vk::Format::eBc4UnormBlock:
+	case vk::Format::eBc4SnormBlock:
+		return { 4, 4, 8 };
+	case vk::Format::eBc2UnormBlock:
+	case vk::Format::eBc2SrgbBlock:
+	case vk::Format::eBc3UnormBlock:
+	case vk::Format::eBc3SrgbBlock:
+	case vk::Format::eBc5UnormBlock:
+	case vk::Format::eBc5SnormBlock:
+	case vk::Format::eBc6HUfloatBlock:
+	case vk::Format::eBc6HSfloatBlock:
+	case vk::Format::eBc7UnormBlock:
+	case vk::Format::eBc7SrgbBlock:
+		return { 4, 4, 16 };
+	default:
+		return { 1, 1, getFormatSize(format) };
+	}
+}
+
+bool vkh::isBlockCompressed(vk::Format format) noexcept
+{
+	return format >= vk::Format::eBc1RgbUnormBlock && format <= vk::Format::eBc7SrgbBlock;
+}
+
+uint32_t vkh::getMipLevelCount(uint32_t width, uint32_t height) noexcept
+{
+	return std::bit_width(std::max({ width, height, 1u }));
+}
+
+vk::Extent3D vkh::getMipExtent(vk::Extent3D extent, uint32_t level) noexcept
+{
+	return { std::max(extent.width >> level, 1u), std::max(extent.height >> level, 1u), std::max(extent.depth >> level, 1u) };
+}
+
+vk::DeviceSize vkh::getMipLevelSize(vk::Format format, vk::Extent3D extent, uint32_t level)
+{
+	vk::Extent3D const mipExtent = getMipExtent(extent, level);
+	FormatBlock const block = getFormatBlock(format);
+	vk::DeviceSize const blocksX = (mipExtent.width + block.width - 1) / block.width;
+	vk::DeviceSize const blocksY = (mipExtent.height + block.height - 1) / block.height;
+	return blocksX * blocksY * mipExtent.depth * block.size;
+}
+
+vk::DeviceSize vkh::getMipChainSize(vk::Format format, vk::Extent3D extent, uint32_t firstLevel, uint32_t endLevel)
+{
+	vk::DeviceSize size = 0;
+	for (uint32_t level = firstLevel; level < endLevel; level++)
+		size += getMipLevelSize(format, extent, level);
+	return size;
+}
+
+bool vkh::supportsLinearBlit(vk::PhysicalDevice physicalDevice, vk::Format format)
+{
+	vk::FormatFeatureFlags const required = vk::FormatFeatureFlagBits::eBlitSrc | vk::FormatFeatureFlagBits::eBlitDst | vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+	return (physicalDevice.getFormatProperties(format).optimalTilingFeatures & required) == required;
+}
@@ -10,5 +10,31 @@ namespace vkh
 	bool hasStencilComponent(vk::Format format) noexcept;
 
 	vk::SampleCountFlagBits getMaxUsableSampleCount(vk::PhysicalDevice physicalDevice);
+
+	// bytes per texel of uncompressed formats, throw on other formats
+	vk::DeviceSize getFormatSize(vk::Format format);
+
+	// texel block of a format, 1x1 texel for uncompressed formats
+	struct FormatBlock
+	{
+		uint32_t width;
+		uint32_t height;
+		vk::DeviceSize size;
+	};
+
+	// BC1 to BC7 are the only compressed formats supported, throw on others
+	FormatBlock getFormatBlock(vk::Format format);
+	bool isBlockCompressed(vk::Format format) noexcept;
+
+	// number of levels of a full mip chain
+	uint32_t getMipLevelCount(uint32_t width, uint32_t height) noexcept;
+	vk::Extent3D getMipExtent(vk::Extent3D extent, uint32_t level) noexcept;
+	// bytes of a tightly packed mip level of a single layer, partial blocks count as whole
+	vk::DeviceSize getMipLevelSize(vk::Format format, vk::Extent3D extent, uint32_t level);
+	// bytes of the tightly packed levels [firstLevel, endLevel)
+	vk::DeviceSize getMipChainSize(vk::Format format, vk::Extent3D extent, uint32_t firstLevel, uint32_t endLevel);
+
+	// mip levels of format can be generated with linear blits on optimal tiling images
+	bool supportsLinearBlit(vk::PhysicalDevice physicalDevice, vk::Format format);
 	
 }
@@ -14,6 +14,8 @@ VulkanContext::VulkanContext(GLFWwindow* win) : window(win)
 	instance.create("ice renderer", "iceEngine", validationLayers, nullptr);
 	createSurface();
 	deviceContext.create(instance, surface, extensions);
+	uploadManager.create(deviceContext);
+	deviceContext.uploadManager = &uploadManager;
 	swapchain.create(&deviceContext, window, surface, maxFramesInFlight, vsync);
 
 	std::system("cd .\\shaders && shadercompile.bat");
@@ -35,14 +37,17 @@ VulkanContext::VulkanContext(GLFWwindow* win) : window(win)
 		.fragmentShader = std::move(fragmentShader),
 		.renderPass = *defaultRenderPass,
 		.imageExtent = { (uint32)width, (uint32)height},
-		.msaaSamples = msaaSamples
+		.msaaSamples = msaaSamples,
+		.dynamicUniformSets = { vkh::PipelineConstants, vkh::Material, vkh::DrawCall }
 	};
 	
 	defaultPipeline.create(deviceContext, pipelineInfo);
+	frameRingBuffer.create(deviceContext, frameRingBufferSize, maxFramesInFlight);
 	createMsResources();
 	createDepthResources();
 	createFramebuffers();
 	commandBuffers.create(deviceContext, maxFramesInFlight);
+	parallelRecorder.create(deviceContext, { .frameCount = maxFramesInFlight });
 	createSyncResources();
 	createDescriptorPool();
 }
@@ -51,14 +56,21 @@ VulkanContext::~VulkanContext()
 {
 	deviceContext.device.waitIdle();
 	
+	deviceContext.uploadManager = nullptr;
+	uploadManager.destroy();
 	descriptorPool.reset();
+	frameRingBuffer.destroy();
 	renderFinishedSemaphores.clear();
 	imageAvailableSemaphores.clear();
-	inFlightFences.clear();
+	frameTimelineValues.clear();
+	parallelRecorder.destroy();
 	commandBuffers.destroy();
-	destroyDepthResources();
-	destroyMsResources();
-	destroyFrameBuffers();
+	// the device is idle and the deletion queue is not sealed anymore, destroyed directly
+	framebuffers.clear();
+	depthImageView.reset();
+	depthImage.destroy();
+	msImageView.reset();
+	msImage.destroy();
 	defaultPipeline.destroy();
 	defaultRenderPass.reset();
 	swapchain.destroy();
@@ -170,27 +182,27 @@ void VulkanContext::createSyncResources()
 {
 	imageAvailableSemaphores.reserve(maxFramesInFlight);
 	renderFinishedSemaphores.reserve(maxFramesInFlight);
-	inFlightFences.reserve(maxFramesInFlight);
 
 	for (int i = 0; i < maxFramesInFlight; i++)
 	{
 		vk::SemaphoreCreateInfo semaphoreCreateInfo{};
 		imageAvailableSemaphores.push_back(deviceContext.device.createSemaphoreUnique(semaphoreCreateInfo, deviceContext.allocationCallbacks));
 		renderFinishedSemaphores.push_back(deviceContext.device.createSemaphoreUnique(semaphoreCreateInfo, deviceContext.allocationCallbacks));
-
-		vk::FenceCreateInfo fenceCreateInfo{};
-		fenceCreateInfo.flags = vk::FenceCreateFlagBits::eSignaled;
-		inFlightFences.push_back(deviceContext.device.createFenceUnique(fenceCreateInfo, deviceContext.allocationCallbacks));
 	}
+
+	// 0 is complete from the start
+	frameTimelineValues.assign(maxFramesInFlight, 0);
 }
 
 void VulkanContext::createDescriptorPool()
 {
-	vk::DescriptorPoolSize poolSize[2];
+	vk::DescriptorPoolSize poolSize[3];
 	poolSize[0].type = vk::DescriptorType::eUniformBuffer;
 	poolSize[0].descriptorCount = swapchain.images.size() * 100;
 	poolSize[1].type = vk::DescriptorType::eCombinedImageSampler;
 	poolSize[1].descriptorCount = swapchain.images.size() * 100;
+	poolSize[2].type = vk::DescriptorType::eUniformBufferDynamic;
+	poolSize[2].descriptorCount = swapchain.images.size() * 100;
 
 	vk::DescriptorPoolCreateInfo poolInfo{};
 	poolInfo.poolSizeCount = std::size(poolSize);
@@ -202,18 +214,19 @@ void VulkanContext::createDescriptorPool()
 
 void VulkanContext::destroyDepthResources()
 {
-	depthImage.destroy();
-	depthImageView.reset();
+	deviceContext.deletionQueue.push(std::move(depthImageView));
+	deviceContext.deletionQueue.push(std::move(depthImage));
 }
 
 void VulkanContext::destroyMsResources()
 {
-	msImage.destroy();
-	msImageView.reset();
+	deviceContext.deletionQueue.push(std::move(msImageView));
+	deviceContext.deletionQueue.push(std::move(msImage));
 }
 
 void VulkanContext::destroyFrameBuffers()
 {
+	deviceContext.deletionQueue.push(std::move(framebuffers));
 	framebuffers.clear();
 }
 
@@ -225,13 +238,19 @@ void VulkanContext::recreateSwapchain()
 		glfwWaitEvents();
 	} while (width == 0 || height == 0);
 
-	deviceContext.device.waitIdle();
-	
-	swapchain.destroy();
-	swapchain.create(&deviceContext, window, surface, maxFramesInFlight, vsync);
+	// the frames in flight keep using the old resources, they go through the deletion queue instead of waiting for the device
+	vkh::DeletionQueue& deletionQueue = deviceContext.deletionQueue;
+
+	vk::UniqueSwapchainKHR oldSwapchain = std::move(swapchain.swapchain);
+	deletionQueue.push(std::move(swapchain.imageViews));
+	swapchain.imageViews.clear();
+	swapchain.create(&deviceContext, window, surface, maxFramesInFlight, vsync, *oldSwapchain);
+	deletionQueue.push(std::move(oldSwapchain));
 
 	vk::Format const colorFormat = swapchain.format;
+	deletionQueue.push(std::move(defaultRenderPass));
 	defaultRenderPass = vkh::createDefaultRenderPassMSAA(deviceContext, colorFormat, msaaSamples);
+	deletionQueue.push(std::move(defaultPipeline));
 	defaultPipeline.destroy();
 
 	auto const fragSpv = readBinFile("shaders/frag.spv");
@@ -247,7 +266,8 @@ void VulkanContext::recreateSwapchain()
 		.fragmentShader = std::move(fragmentShader),
 		.renderPass = *defaultRenderPass,
 		.imageExtent = {(uint32)width, (uint32)height},
-		.msaaSamples = msaaSamples
+		.msaaSamples = msaaSamples,
+		.dynamicUniformSets = { vkh::PipelineConstants, vkh::Material, vkh::DrawCall }
 	};
 
 	defaultPipeline.create(deviceContext, pipelineInfo);
@@ -260,9 +280,6 @@ void VulkanContext::recreateSwapchain()
 
 	destroyFrameBuffers();
 	createFramebuffers();
-
-	commandBuffers.destroy();
-	commandBuffers.create(deviceContext, maxFramesInFlight);
 	
 	onSwapchainRecreate();
 }
@@ -271,9 +288,13 @@ void VulkanContext::recreateSwapchain()
 // @Review CommandBuffer management
 bool VulkanContext::startFrame()
 {
-	deviceContext.device.waitForFences(1, &inFlightFences[currentFrame].get(), true, UINT64_MAX);
+	deviceContext.graphicsTimeline.wait(frameTimelineValues[currentFrame]);
+	// the GPU is done with the transient data of this frame
+	frameRingBuffer.beginFrame(currentFrame);
+	uploadManager.update();
+	deviceContext.oneTimeCommands.update();
+	deviceContext.deletionQueue.update();
 	
-	// @TODO check: https://www.khronos.org/blog/vulkan-timeline-semaphores
 	vk::ResultValue<uint32_t> const nextImageResult = deviceContext.device.acquireNextImageKHR(*swapchain.swapchain, UINT64_MAX, *imageAvailableSemaphores[currentFrame], vk::Fence{});
 
 	if (nextImageResult.result == vk::Result::eErrorOutOfDateKHR || resized)
@@ -294,23 +315,18 @@ bool VulkanContext::startFrame()
 
 void VulkanContext::endFrame()
 {
-	vk::SubmitInfo submitInfo{};
-	vk::Semaphore waitSemaphores[] = { *imageAvailableSemaphores[currentFrame] };
-	vk::PipelineStageFlags waitStages[] = { vk::PipelineStageFlagBits::eColorAttachmentOutput };
-	submitInfo.waitSemaphoreCount = std::size(waitSemaphores);
-	submitInfo.pWaitSemaphores = waitSemaphores;
-	submitInfo.pWaitDstStageMask = waitStages;
+	frameRingBuffer.endFrame();
+	// copies recorded during the frame are acquired by the graphics queue before the frame commands run
+	uploadManager.flush();
 	
-	submitInfo.commandBufferCount = 1;
-
-	submitInfo.pCommandBuffers = &commandBuffers.commandBuffers[imageIndex].get();
-
+	// the swapchain only works with binary semaphores
+	vkh::SemaphoreWait const imageAvailable{ *imageAvailableSemaphores[currentFrame], 0, vk::PipelineStageFlagBits::eColorAttachmentOutput };
 	vk::Semaphore signalSemaphores[] = { *renderFinishedSemaphores[currentFrame] };
-	submitInfo.signalSemaphoreCount = std::size(signalSemaphores);
-	submitInfo.pSignalSemaphores = signalSemaphores;
+	vk::CommandBuffer const cmdBuffer = *commandBuffers.commandBuffers[currentFrame];
 
-	deviceContext.device.resetFences(1, &inFlightFences[currentFrame].get());
-	deviceContext.graphicsQueue.submit(1, &submitInfo, inFlightFences[currentFrame].get());
+	frameTimelineValues[currentFrame] = deviceContext.graphicsTimeline.submit({ &cmdBuffer, 1 }, { &imageAvailable, 1 }, signalSemaphores);
+	// resources released while recording are destroyed once this frame completed
+	deviceContext.deletionQueue.seal(frameTimelineValues[currentFrame]);
 
 	vk::PresentInfoKHR presentInfo{};
 
@@ -324,4 +340,23 @@ void VulkanContext::endFrame()
 
 	deviceContext.presentQueue.presentKHR(presentInfo);
 	currentFrame = (currentFrame + 1) % maxFramesInFlight;
+	frameNumber++;
+}
+
+bool VulkanContext::isFrameComplete(uint64 frame) const
+{
+	if (frame >= frameNumber)
+		return false;
+	// the value of its slot was overwritten by a frame submitted after waiting for it
+	if (frame + maxFramesInFlight < frameNumber)
+		return true;
+	return deviceContext.graphicsTimeline.isComplete(frameTimelineValues[frame % maxFramesInFlight]);
+}
+
+void VulkanContext::waitFrame(uint64 frame) const
+{
+	assert(frame < frameNumber);
+	if (frame + maxFramesInFlight < frameNumber)
+		return;
+	deviceContext.graphicsTimeline.wait(frameTimelineValues[frame % maxFramesInFlight]);
 }
@@ -8,7 +8,10 @@
 #include "vkhCommandBuffers.hpp"
 #include "vkhInstance.hpp"
 #include "vkhDeviceContext.hpp"
+#include "vkhFrameRingBuffer.hpp"
+#include "vkhParallelRecorder.hpp"
 #include "vkhSwapchain.hpp"
+#include "vkhUploadManager.hpp"
 #include "vkhGraphicsPipeline.hpp"
 
 struct GLFWwindow;
@@ -44,28 +47,42 @@ struct VulkanContext
 
 	void endFrame();
 
+	// frames are numbered by frameNumber, frames older than the ones in flight are always complete
+	[[nodiscard]] bool isFrameComplete(uint64 frame) const;
+	void waitFrame(uint64 frame) const;
+
 	std::function<void()> onSwapchainRecreate;
 	
 	vk::SampleCountFlagBits const msaaSamples = vk::SampleCountFlagBits::e4;
 	uint const maxFramesInFlight = 2;
+	// per frame bytes of transient uniform data
+	vk::DeviceSize const frameRingBufferSize = 4 << 20;
 	uint currentFrame = 0;
+	// number of the frame being recorded, incremented when it is submitted
+	uint64 frameNumber = 0;
 	uint32 imageIndex = 0;
 	bool vsync = false;
 	bool resized = false;
 
 	vkh::DeviceContext deviceContext;
+	// flushed every frame before the graphics submission
+	vkh::UploadManager uploadManager;
 	vkh::Instance instance;
 	vkh::Swapchain swapchain;
 	vk::UniqueRenderPass defaultRenderPass;
 	std::vector<vk::UniqueFramebuffer> framebuffers;
 	vkh::GraphicsPipeline defaultPipeline;
 	vkh::CommandBuffers commandBuffers;
+	// secondary command buffers of the scene pass, recorded on worker threads
+	vkh::ParallelRecorder parallelRecorder;
 	vk::UniqueDescriptorPool descriptorPool;
+	vkh::FrameRingBuffer frameRingBuffer;
 	
 	std::vector<vk::UniqueSemaphore> imageAvailableSemaphores;
 	std::vector<vk::UniqueSemaphore> renderFinishedSemaphores;
 
-	std::vector<vk::UniqueFence> inFlightFences;
+	// graphics timeline value signaled by the last frame submitted in each slot
+	std::vector<uint64> frameTimelineValues;
 	
 	vkh::Image msImage;
 	vk::UniqueImageView msImageView;